@@ -0,0 +1,119 @@
+#include "AnomalyDetector.h"
+#include <LittleFS.h>
+#include "Metrics.h"
+#include "TimeSync.h"
+
+namespace {
+    const char* STATE_PATH = "/anomaly.bin";
+
+    portMUX_TYPE stateMux = portMUX_INITIALIZER_UNLOCKED;
+    AnomalyState state;
+    AnomalyEvent recent[AnomalyDetector::RECENT_EVENTS];
+    uint8_t recentCount = 0;
+    uint8_t recentNext = 0;
+
+    bool load() {
+        File f = LittleFS.open(STATE_PATH, "r");
+        if (!f) return false;
+        bool ok = f.read((uint8_t*)&state, sizeof(state)) == sizeof(state) && AnomalyLogic::isValid(state);
+        f.close();
+        return ok;
+    }
+
+    void save(const AnomalyState& snapshot) {
+        File f = LittleFS.open(STATE_PATH, "w");
+        if (!f) {
+            Serial.println("[ANOMALY] Failed to write " + String(STATE_PATH));
+            return;
+        }
+        f.write((const uint8_t*)&snapshot, sizeof(snapshot));
+        f.close();
+    }
+
+    String statJson(const WelfordStat& stat) {
+        return "{\"count\":" + String(stat.count) + ",\"mean\":" + String(stat.mean, 2) +
+               ",\"stddev\":" + String(AnomalyLogic::stddev(stat), 2) + "}";
+    }
+}
+
+void AnomalyDetector::begin() {
+    if (load()) {
+        Serial.printf("[ANOMALY] Baselines restored, %u days of minimum flow\n", state.minimumFlow.count);
+    } else {
+        AnomalyLogic::reset(state);
+        Serial.println("[ANOMALY] No baselines yet, learning");
+    }
+}
+
+bool AnomalyDetector::feed(uint32_t timestamp, float percent, float sigma, AnomalyEvent& event) {
+    if (!TimeSync::isSynced()) return false; // hour-of-day means nothing on the fallback clock
+
+    portENTER_CRITICAL(&stateMux);
+    uint32_t hour = state.currentHour;
+    bool raised = AnomalyLogic::feed(state, timestamp, percent, sigma, event);
+    if (raised) {
+        recent[recentNext] = event;
+        recentNext = (recentNext + 1) % RECENT_EVENTS;
+        if (recentCount < RECENT_EVENTS) recentCount++;
+    }
+    bool hourClosed = state.currentHour != hour;
+    AnomalyState snapshot = state;
+    portEXIT_CRITICAL(&stateMux);
+
+    if (hourClosed) save(snapshot);
+    if (raised) {
+        Metrics::increment("anomaly_events");
+        Serial.println("[ANOMALY] " + eventJson(event));
+    }
+    return raised;
+}
+
+void AnomalyDetector::clear() {
+    portENTER_CRITICAL(&stateMux);
+    AnomalyLogic::reset(state);
+    recentCount = 0;
+    recentNext = 0;
+    portEXIT_CRITICAL(&stateMux);
+    LittleFS.remove(STATE_PATH);
+}
+
+String AnomalyDetector::eventJson(const AnomalyEvent& event) {
+    String json = "{\"type\":\"" + String(AnomalyLogic::typeName(event.type)) + "\"";
+    json += ",\"timestamp\":" + String(event.timestamp);
+    if (event.type != AnomalyType::MINIMUM_FLOW) json += ",\"hour\":" + String(event.hour);
+    json += ",\"consumption\":" + String(event.value, 2);
+    json += ",\"mean\":" + String(event.mean, 2);
+    json += ",\"sigma\":" + String(event.deviation, 1);
+    json += "}";
+    return json;
+}
+
+String AnomalyDetector::toJson() {
+    AnomalyState snapshot;
+    AnomalyEvent events[RECENT_EVENTS];
+    uint8_t count;
+    uint8_t next;
+    portENTER_CRITICAL(&stateMux);
+    snapshot = state;
+    memcpy(events, recent, sizeof(events));
+    count = recentCount;
+    next = recentNext;
+    portEXIT_CRITICAL(&stateMux);
+
+    String json = "{\"synced\":" + String(TimeSync::isSynced() ? "true" : "false");
+    json += ",\"current_hour_consumption\":" + String(snapshot.hourConsumption, 2);
+    json += ",\"minimum_flow\":" + statJson(snapshot.minimumFlow);
+    json += ",\"hourly\":[";
+    for (uint8_t i = 0; i < ANOMALY_HOURS; ++i) {
+        if (i > 0) json += ",";
+        json += statJson(snapshot.hourly[i]);
+    }
+    json += "],\"events\":[";
+    // Newest first
+    for (uint8_t i = 0; i < count; ++i) {
+        if (i > 0) json += ",";
+        json += eventJson(events[(next + RECENT_EVENTS - 1 - i) % RECENT_EVENTS]);
+    }
+    json += "]}";
+    return json;
+}
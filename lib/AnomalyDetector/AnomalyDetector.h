@@ -0,0 +1,22 @@
+#pragma once
+#include <Arduino.h>
+#include "AnomalyLogic.h"
+
+// Leak and usage-anomaly detection for the primary tank. Fed once a minute from
+// the level log; the baselines (see AnomalyLogic) live in a ~280 byte state
+// that is written to /anomaly.bin each time an hour closes, so they survive
+// reboots. The most recent events are kept in RAM for the web API.
+class AnomalyDetector {
+public:
+    static const uint8_t RECENT_EVENTS = 8;
+
+    static void begin();
+    // Returns true and fills `event` when the sample closed an anomalous hour or day.
+    // Needs wall-clock time: samples before the first SNTP sync are ignored.
+    static bool feed(uint32_t timestamp, float percent, float sigma, AnomalyEvent& event);
+    static void clear();
+
+    static String eventJson(const AnomalyEvent& event);
+    // Hour-of-day baselines, the minimum-flow baseline and the recent events
+    static String toJson();
+};
@@ -0,0 +1,126 @@
+#include "AnomalyLogic.h"
+#include <math.h>
+
+namespace {
+    const uint32_t STATE_MAGIC = 0x414E4F4D; // "ANOM"
+    const float NOISE_PERCENT = 0.5f;
+    // Floor on the spread, so a baseline of near-identical hours does not flag tiny changes
+    const float MIN_STDDEV = 0.5f;
+
+    bool test(const WelfordStat& stat, float value, float sigma, AnomalyEvent& event) {
+        if (sigma <= 0 || stat.count < ANOMALY_MIN_COUNT) return false;
+        float spread = AnomalyLogic::stddev(stat);
+        if (spread < MIN_STDDEV) spread = MIN_STDDEV;
+        float deviation = (value - stat.mean) / spread;
+        if (fabsf(deviation) < sigma) return false;
+        event.value = value;
+        event.mean = stat.mean;
+        event.deviation = deviation;
+        return true;
+    }
+
+    void closeDay(AnomalyState& state, uint32_t timestamp, float sigma, AnomalyEvent& event, bool& raised) {
+        if (state.dayHours >= ANOMALY_MIN_DAY_HOURS) {
+            AnomalyEvent dayEvent;
+            // Only a raised minimum is suspicious; a quieter night is not. It takes
+            // precedence over an hourly event closed on the same sample.
+            if (test(state.minimumFlow, state.dayMinimum, sigma, dayEvent) && dayEvent.deviation > 0) {
+                event = dayEvent;
+                event.type = AnomalyType::MINIMUM_FLOW;
+                event.timestamp = timestamp;
+                raised = true;
+            }
+            AnomalyLogic::add(state.minimumFlow, state.dayMinimum);
+        }
+        state.dayMinimum = 0.0f;
+        state.dayHours = 0;
+    }
+
+    void closeHour(AnomalyState& state, uint32_t timestamp, float sigma, AnomalyEvent& event, bool& raised) {
+        if (state.hourSamples < ANOMALY_MIN_HOUR_SAMPLES) return;
+        uint8_t hour = state.currentHour % ANOMALY_HOURS;
+        WelfordStat& stat = state.hourly[hour];
+        AnomalyEvent hourEvent;
+        if (test(stat, state.hourConsumption, sigma, hourEvent)) {
+            event = hourEvent;
+            event.type = hourEvent.deviation > 0 ? AnomalyType::HIGH_CONSUMPTION : AnomalyType::LOW_CONSUMPTION;
+            event.hour = hour;
+            event.timestamp = timestamp;
+            raised = true;
+        }
+        AnomalyLogic::add(stat, state.hourConsumption);
+        if (state.dayHours == 0 || state.hourConsumption < state.dayMinimum) state.dayMinimum = state.hourConsumption;
+        state.dayHours++;
+    }
+}
+
+namespace AnomalyLogic {
+
+void reset(AnomalyState& state) {
+    state.magic = STATE_MAGIC;
+    for (uint8_t i = 0; i < ANOMALY_HOURS; ++i) state.hourly[i] = WelfordStat{0, 0.0f, 0.0f};
+    state.minimumFlow = WelfordStat{0, 0.0f, 0.0f};
+    state.currentHour = 0;
+    state.hourConsumption = 0.0f;
+    state.hourSamples = 0;
+    state.dayMinimum = 0.0f;
+    state.dayHours = 0;
+    state.anchor = 0.0f;
+    state.anchored = 0;
+}
+
+bool isValid(const AnomalyState& state) {
+    return state.magic == STATE_MAGIC && state.dayHours <= ANOMALY_HOURS;
+}
+
+// Welford's update; once the count saturates, each new value carries a fixed weight
+void add(WelfordStat& stat, float value) {
+    if (stat.count < ANOMALY_MAX_COUNT) stat.count++;
+    float delta = value - stat.mean;
+    stat.mean += delta / stat.count;
+    float m2 = stat.m2 + delta * (value - stat.mean);
+    if (stat.count == ANOMALY_MAX_COUNT) m2 -= stat.m2 / stat.count; // keep the variance estimate bounded
+    stat.m2 = m2 > 0 ? m2 : 0.0f;
+}
+
+float stddev(const WelfordStat& stat) {
+    return stat.count > 1 ? sqrtf(stat.m2 / (stat.count - 1)) : 0.0f;
+}
+
+bool feed(AnomalyState& state, uint32_t timestamp, float percent, float sigma, AnomalyEvent& event) {
+    bool raised = false;
+    uint32_t hour = timestamp / 3600;
+    if (hour != state.currentHour) {
+        if (state.currentHour != 0 && hour > state.currentHour) {
+            closeHour(state, timestamp, sigma, event, raised);
+            if (hour / ANOMALY_HOURS != state.currentHour / ANOMALY_HOURS) closeDay(state, timestamp, sigma, event, raised);
+        }
+        state.currentHour = hour;
+        state.hourConsumption = 0.0f;
+        state.hourSamples = 0;
+    }
+
+    // Drops beyond the noise band count as consumption; rises beyond it are refills
+    if (!state.anchored) {
+        state.anchor = percent;
+        state.anchored = 1;
+    } else if (percent <= state.anchor - NOISE_PERCENT) {
+        state.hourConsumption += state.anchor - percent;
+        state.anchor = percent;
+    } else if (percent >= state.anchor + NOISE_PERCENT) {
+        state.anchor = percent;
+    }
+    state.hourSamples++;
+    return raised;
+}
+
+const char* typeName(AnomalyType type) {
+    switch (type) {
+        case AnomalyType::HIGH_CONSUMPTION: return "high_consumption";
+        case AnomalyType::LOW_CONSUMPTION:  return "low_consumption";
+        case AnomalyType::MINIMUM_FLOW:     return "minimum_flow";
+        default:                            return "none";
+    }
+}
+
+}
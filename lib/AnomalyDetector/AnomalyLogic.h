@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+
+// Platform-independent part of the anomaly detector: streaming consumption
+// baselines and the drift test. No Arduino dependencies so it can be
+// exercised on a host. Every update is O(1).
+//
+// Consumption is the sum of level drops (in % of the tank) over one hour,
+// measured against an anchor so sensor jitter smaller than NOISE_PERCENT does
+// not add up; refills move the anchor and do not count. Each closed hour is
+// tested against, then folded into, the Welford mean/variance of its
+// hour-of-day. The quietest hour of each day is the minimum-flow baseline: a
+// slow leak raises it even when every single hour still looks normal.
+
+static const uint8_t ANOMALY_HOURS = 24;
+// Hours a baseline must have seen before it is used to raise events
+static const uint16_t ANOMALY_MIN_COUNT = 7;
+// Welford counts saturate here, so older days fade out and the baseline follows
+// lasting changes in usage (roughly the last two months per hour-of-day)
+static const uint16_t ANOMALY_MAX_COUNT = 60;
+// Hours with fewer samples than this (reboot, sensor error) are not evaluated
+static const uint16_t ANOMALY_MIN_HOUR_SAMPLES = 30;
+// Days with fewer evaluated hours do not update the minimum-flow baseline
+static const uint8_t ANOMALY_MIN_DAY_HOURS = 20;
+
+struct __attribute__((packed)) WelfordStat {
+    uint16_t count;
+    float mean;
+    float m2;
+};
+
+// Persisted as-is; must stay a trivial type
+struct __attribute__((packed)) AnomalyState {
+    uint32_t magic;
+    WelfordStat hourly[ANOMALY_HOURS];
+    WelfordStat minimumFlow;  // quietest hour of each day
+    uint32_t currentHour;     // epoch hours of the hour being accumulated
+    float hourConsumption;
+    uint16_t hourSamples;
+    float dayMinimum;         // quietest evaluated hour of the current day
+    uint8_t dayHours;         // evaluated hours in the current day
+    float anchor;
+    uint8_t anchored;
+};
+
+enum class AnomalyType : uint8_t {
+    NONE,
+    HIGH_CONSUMPTION, // an hour used far more than usual for its hour-of-day
+    LOW_CONSUMPTION,  // an hour used far less, e.g. a stuck float valve refilling as fast as it drains
+    MINIMUM_FLOW      // the quietest hour of the day stayed high: likely a leak
+};
+
+struct AnomalyEvent {
+    uint32_t timestamp = 0;   // epoch seconds at the end of the evaluated period
+    AnomalyType type = AnomalyType::NONE;
+    uint8_t hour = 0;         // UTC hour-of-day, for hourly events
+    float value = 0.0f;       // consumption in % of the tank per hour
+    float mean = 0.0f;
+    float deviation = 0.0f;   // (value - mean) in standard deviations
+};
+
+namespace AnomalyLogic {
+    void reset(AnomalyState& state);
+    bool isValid(const AnomalyState& state);
+
+    void add(WelfordStat& stat, float value);
+    float stddev(const WelfordStat& stat);
+
+    // Feeds one valid level sample (epoch seconds, percent full). Returns true and
+    // fills `event` when closing an hour or day raised an anomaly; the minimum-flow
+    // event wins if both fire on the same sample. `sigma` <= 0 disables events.
+    bool feed(AnomalyState& state, uint32_t timestamp, float percent, float sigma, AnomalyEvent& event);
+
+    const char* typeName(AnomalyType type);
+}
@@ -0,0 +1,90 @@
+#include "BatteryLogic.h"
+
+namespace {
+    const uint32_t STATE_MAGIC = 0x32544142; // "BAT2", bumped when the layout changes
+}
+
+namespace BatteryLogic {
+
+void reset(BatteryState& state) {
+    state.magic = STATE_MAGIC;
+    state.wakeCount = 0;
+    state.elapsedSeconds = 0;
+    state.lastReportedStatus = 0;
+    state.head = 0;
+    state.count = 0;
+    state.published = 0;
+}
+
+bool isValid(const BatteryState& state) {
+    return state.magic == STATE_MAGIC && state.head < BATTERY_BUFFER_CAPACITY &&
+           state.count <= BATTERY_BUFFER_CAPACITY && state.published <= state.count;
+}
+
+void append(BatteryState& state, const BatterySample& sample) {
+    uint16_t tail = (state.head + state.count) % BATTERY_BUFFER_CAPACITY;
+    state.samples[tail] = sample;
+    if (state.count < BATTERY_BUFFER_CAPACITY) {
+        state.count++;
+    } else {
+        state.head = (state.head + 1) % BATTERY_BUFFER_CAPACITY;
+        if (state.published > 0) state.published--;
+    }
+}
+
+const BatterySample& at(const BatteryState& state, uint16_t i) {
+    return state.samples[(state.head + i) % BATTERY_BUFFER_CAPACITY];
+}
+
+void clear(BatteryState& state) {
+    state.head = 0;
+    state.count = 0;
+    state.published = 0;
+}
+
+bool hasRelative(const BatteryState& state) {
+    return state.count > 0 && at(state, 0).timestamp < BATTERY_MIN_EPOCH;
+}
+
+void rebase(BatteryState& state, uint32_t elapsedNow, uint32_t epochNow) {
+    for (uint16_t i = 0; i < state.count; ++i) {
+        BatterySample& s = state.samples[(state.head + i) % BATTERY_BUFFER_CAPACITY];
+        if (s.timestamp >= BATTERY_MIN_EPOCH) break;
+        uint32_t ago = elapsedNow > s.timestamp ? elapsedNow - s.timestamp : 0;
+        s.timestamp = epochNow - ago;
+    }
+}
+
+void markPublished(BatteryState& state) {
+    state.published = state.count;
+}
+
+float filteredDistance(float* readings, size_t count) {
+    // Compact valid readings to the front, then insertion sort (bursts are tiny)
+    size_t valid = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (readings[i] >= 0) readings[valid++] = readings[i];
+    }
+    if (valid == 0) return -1.0f;
+    for (size_t i = 1; i < valid; ++i) {
+        float v = readings[i];
+        size_t j = i;
+        while (j > 0 && readings[j - 1] > v) {
+            readings[j] = readings[j - 1];
+            --j;
+        }
+        readings[j] = v;
+    }
+    if (valid % 2) return readings[valid / 2];
+    return (readings[valid / 2 - 1] + readings[valid / 2]) / 2.0f;
+}
+
+WakeAction decide(const BatteryState& state, uint16_t uploadEveryWakes, bool alertChanged) {
+    if (alertChanged) return WakeAction::UPLOAD;
+    // A full buffer starts losing samples nobody has seen; held ones were already sent
+    if (state.count >= BATTERY_BUFFER_CAPACITY && state.published == 0) return WakeAction::UPLOAD;
+    if (uploadEveryWakes <= 1) return WakeAction::UPLOAD;
+    return (state.wakeCount % uploadEveryWakes == 0) ? WakeAction::UPLOAD : WakeAction::SLEEP;
+}
+
+}
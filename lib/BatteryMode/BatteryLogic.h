@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Platform-independent part of battery mode: the RTC sample buffer and the
+// per-wake decision. No Arduino dependencies so it can be exercised on a host.
+
+static const uint16_t BATTERY_BUFFER_CAPACITY = 96;
+static const uint8_t BATTERY_MAX_BURST = 15;
+// Timestamps below this are relative (seconds since the first battery-mode boot);
+// counting up from 0 they would take decades to get here
+static const uint32_t BATTERY_MIN_EPOCH = 1700000000;
+
+struct BatterySample {
+    uint32_t timestamp;   // epoch seconds, or seconds since the first battery-mode boot before SNTP sync
+    float distanceCm;     // filtered burst result, -1 on sensor error
+};
+
+// Lives in RTC slow memory across deep sleep. Must stay a trivial type: a
+// constructor would run on every wake and wipe the buffer.
+struct BatteryState {
+    uint32_t magic;
+    uint32_t wakeCount;
+    uint32_t elapsedSeconds;
+    uint8_t lastReportedStatus; // LevelStatus of the last successful upload
+    uint16_t head;              // index of the oldest sample
+    uint16_t count;
+    uint16_t published;         // oldest samples already sent over MQTT, held for the clock
+    BatterySample samples[BATTERY_BUFFER_CAPACITY];
+};
+
+enum class WakeAction : uint8_t {
+    SLEEP,  // buffer the sample and go straight back to sleep
+    UPLOAD  // bring up Wi-Fi and MQTT and flush the buffer
+};
+
+namespace BatteryLogic {
+    void reset(BatteryState& state);
+    bool isValid(const BatteryState& state);
+
+    // Appends a sample, overwriting the oldest one when the buffer is full.
+    void append(BatteryState& state, const BatterySample& sample);
+    // i = 0 is the oldest buffered sample.
+    const BatterySample& at(const BatteryState& state, uint16_t i);
+    void clear(BatteryState& state);
+
+    // Relative samples are taken before the first SNTP sync and come first in the
+    // buffer. Once the clock is valid they are moved onto it: `elapsedNow` is the
+    // relative time that corresponds to `epochNow`.
+    bool hasRelative(const BatteryState& state);
+    void rebase(BatteryState& state, uint32_t elapsedNow, uint32_t epochNow);
+    // Marks every buffered sample as sent; they stay buffered until they can be
+    // stored in history with epoch timestamps.
+    void markPublished(BatteryState& state);
+
+    // Median of the valid (non-negative) readings in a burst; -1 if none are valid.
+    // Reorders the input array.
+    float filteredDistance(float* readings, size_t count);
+
+    WakeAction decide(const BatteryState& state, uint16_t uploadEveryWakes, bool alertChanged);
+}
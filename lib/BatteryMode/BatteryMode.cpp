@@ -0,0 +1,136 @@
+#include "BatteryMode.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <LittleFS.h>
+#include <esp_sleep.h>
+#include "BatteryLogic.h"
+#include "LogManager.h"
+#include "Telemetry.h"
+#include "TimeSync.h"
+
+namespace {
+    RTC_DATA_ATTR BatteryState rtcState;
+
+    const unsigned long WIFI_TIMEOUT_MS = 8000;  // shorter than normal boot: every second costs battery
+    const unsigned long BURST_GAP_MS = 60;       // JSN-SR04T needs ~50 ms between pings
+    const uint16_t SAMPLES_PER_MESSAGE = 16;     // keeps each batch message well inside the MQTT buffer
+    const unsigned long SYNC_WAIT_MS = 2000;     // for SNTP after connecting, while relative samples are buffered
+
+    unsigned long wakeStart = 0;
+
+    // Seconds since the first battery-mode boot, the clock relative samples are on
+    uint32_t elapsedNow() {
+        return rtcState.elapsedSeconds + (uint32_t)(millis() - wakeStart) / 1000;
+    }
+
+    // Moves samples taken before the first sync onto epoch time once there is one
+    void rebaseIfSynced() {
+        if (TimeSync::isSynced() && BatteryLogic::hasRelative(rtcState)) {
+            BatteryLogic::rebase(rtcState, elapsedNow(), TimeSync::now());
+        }
+    }
+}
+
+bool BatteryMode::isWakeFromSleep() {
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && BatteryLogic::isValid(rtcState);
+}
+
+void BatteryMode::run(const Config& config, WaterLevelSensor& sensor, WiFiManager& wifiManager, MQTTClient& mqttClient) {
+    unsigned long start = millis();
+    wakeStart = start;
+    if (!BatteryLogic::isValid(rtcState)) {
+        BatteryLogic::reset(rtcState);
+    }
+    rtcState.wakeCount++;
+
+    float readings[BATTERY_MAX_BURST];
+    size_t burst = (size_t)constrain(config.batteryBurstSamples, 1, (int)BATTERY_MAX_BURST);
+    for (size_t i = 0; i < burst; ++i) {
+        if (i > 0) delay(BURST_GAP_MS);
+        readings[i] = sensor.readDistanceCm();
+    }
+    float distance = BatteryLogic::filteredDistance(readings, burst);
+
+    // The system clock keeps running through deep sleep, so once an upload has synced it
+    // samples carry epoch time; before that they count from the first battery-mode boot
+    rebaseIfSynced();
+    uint32_t timestamp = TimeSync::isSynced() ? TimeSync::now() : elapsedNow();
+    BatterySample sample = { timestamp, distance };
+    BatteryLogic::append(rtcState, sample);
+
+    Telemetry t = Telemetry::compute(config, distance);
+    bool alerting = t.status == LevelStatus::LOW_LEVEL || t.status == LevelStatus::FULL;
+    bool alertChanged = alerting && (uint8_t)t.status != rtcState.lastReportedStatus;
+    Serial.printf("[BATTERY] Wake %u: %.1f cm (%s), %u buffered\n",
+                  rtcState.wakeCount, distance, t.statusName(), rtcState.count);
+
+    if (BatteryLogic::decide(rtcState, config.batteryUploadEvery, alertChanged) == WakeAction::UPLOAD) {
+        if (upload(config, wifiManager, mqttClient)) {
+            rtcState.lastReportedStatus = (uint8_t)t.status;
+        } else {
+            Serial.println("[BATTERY] Upload failed, keeping samples for the next attempt.");
+        }
+    }
+
+    rtcState.elapsedSeconds += (millis() - start) / 1000 + (uint32_t)std::max(1, config.batterySleepInterval);
+    sleep(config);
+}
+
+void BatteryMode::sleep(const Config& config) {
+    uint64_t intervalUs = (uint64_t)std::max(1, config.batterySleepInterval) * 1000000ULL;
+    Serial.printf("[BATTERY] Sleeping for %d s\n", std::max(1, config.batterySleepInterval));
+    Serial.flush();
+    esp_sleep_enable_timer_wakeup(intervalUs);
+    esp_deep_sleep_start();
+}
+
+bool BatteryMode::upload(const Config& config, WiFiManager& wifiManager, MQTTClient& mqttClient) {
+    if (!wifiManager.connect(config, WIFI_TIMEOUT_MS)) return false;
+    TimeSync::startSync(); // completes in the background while the batch is published
+    if (!mqttClient.connect(config)) {
+        WiFi.disconnect(true);
+        return false;
+    }
+
+    // History needs epoch time, so give SNTP a moment when there are relative samples
+    unsigned long waitStart = millis();
+    while (BatteryLogic::hasRelative(rtcState) && !TimeSync::isSynced() && millis() - waitStart < SYNC_WAIT_MS) {
+        delay(50);
+    }
+    rebaseIfSynced();
+
+    // Samples held from an earlier upload were already sent
+    String topic = config.mqttTopic + "/batch";
+    bool ok = true;
+    for (uint16_t i = rtcState.published; i < rtcState.count && ok; i += SAMPLES_PER_MESSAGE) {
+        String payload = "{\"samples\":[";
+        for (uint16_t j = i; j < rtcState.count && j < i + SAMPLES_PER_MESSAGE; ++j) {
+            const BatterySample& s = BatteryLogic::at(rtcState, j);
+            if (j > i) payload += ",";
+            payload += "[" + String(s.timestamp) + "," + String(s.distanceCm, 1) + "]";
+        }
+        payload += "]}";
+        ok = mqttClient.publish(topic, payload);
+    }
+
+    if (ok && BatteryLogic::hasRelative(rtcState)) {
+        // Still no clock: relative timestamps would land at the start of the epoch
+        // history, so keep the samples until a later wake can rebase them
+        Serial.println("[BATTERY] No SNTP time yet, holding samples for history.");
+        BatteryLogic::markPublished(rtcState);
+    } else if (ok) {
+        // The burst is also the only time flash is touched in battery mode
+        if (LittleFS.begin()) {
+            LogManager::initLogFile();
+            for (uint16_t i = 0; i < rtcState.count; ++i) {
+                const BatterySample& s = BatteryLogic::at(rtcState, i);
+                LogManager::logLevelReading(s.timestamp, s.distanceCm);
+            }
+        }
+        BatteryLogic::clear(rtcState);
+    }
+
+    mqttClient.disconnect();
+    WiFi.disconnect(true);
+    return ok;
+}
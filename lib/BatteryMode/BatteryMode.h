@@ -0,0 +1,23 @@
+#pragma once
+#include "ConfigManager.h"
+#include "WaterLevelSensor.h"
+#include "WiFiManager.h"
+#include "MQTTClient.h"
+
+// Deep-sleep operation for tanks without mains power. Each wake takes a
+// filtered burst of readings, buffers it in RTC memory and goes back to sleep;
+// Wi-Fi and MQTT are only brought up every N wakes or when an alert fires.
+class BatteryMode {
+public:
+    // True when this boot is a timer wake-up from a battery-mode deep sleep.
+    static bool isWakeFromSleep();
+
+    // Runs one wake cycle and enters deep sleep. Does not return.
+    static void run(const Config& config, WaterLevelSensor& sensor, WiFiManager& wifiManager, MQTTClient& mqttClient);
+
+    // Enters deep sleep for the configured interval. Does not return.
+    static void sleep(const Config& config);
+
+private:
+    static bool upload(const Config& config, WiFiManager& wifiManager, MQTTClient& mqttClient);
+};
@@ -0,0 +1,41 @@
+#include "BootProfiler.h"
+#include <esp_timer.h>
+#include "Metrics.h"
+
+BootProfiler::Entry BootProfiler::_entries[BootProfiler::MAX_PHASES];
+uint8_t BootProfiler::_count = 0;
+uint32_t BootProfiler::_lastMark = 0;
+
+namespace {
+    // esp_timer starts at reset, before the Arduino core's own init
+    uint32_t sinceResetMs() {
+        return (uint32_t)(esp_timer_get_time() / 1000);
+    }
+}
+
+void BootProfiler::phase(const char* name) {
+    uint32_t now = sinceResetMs();
+    record(name, now - _lastMark);
+    _lastMark = now;
+}
+
+void BootProfiler::milestone(const char* name) {
+    record(name, sinceResetMs());
+}
+
+void BootProfiler::record(const char* name, uint32_t ms) {
+    if (_count < MAX_PHASES) {
+        _entries[_count].name = name;
+        _entries[_count].ms = ms;
+        _count++;
+    }
+    Metrics::set(name, (int32_t)ms);
+}
+
+void BootProfiler::printSummary() {
+    Serial.println("[BOOT] Phase timings:");
+    for (uint8_t i = 0; i < _count; ++i) {
+        Serial.printf("[BOOT]   %-24s %6u ms\n", _entries[i].name, (unsigned)_entries[i].ms);
+    }
+    Serial.printf("[BOOT]   %-24s %6u ms\n", "total", (unsigned)sinceResetMs());
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+
+// Timestamps boot phases. Each phase duration is also published to Metrics under the
+// given name, so names must be string literals (e.g. "boot_display_ms").
+class BootProfiler {
+public:
+    // Closes the current phase: records the time since the previous phase() call.
+    static void phase(const char* name);
+    // Records the absolute time since reset (e.g. first reading, Wi-Fi up).
+    static void milestone(const char* name);
+    static void printSummary();
+
+private:
+    static const uint8_t MAX_PHASES = 16;
+    struct Entry {
+        const char* name;
+        uint32_t ms;
+    };
+    static Entry _entries[MAX_PHASES];
+    static uint8_t _count;
+    static uint32_t _lastMark;
+
+    static void record(const char* name, uint32_t ms);
+};
@@ -1,22 +1,495 @@
 #include "ConfigManager.h"
+#include <Arduino.h>
 #include <Preferences.h>
+#include <string.h>
 #include "Logger.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #define PREF_NAMESPACE "waterlevel"
+#define PREF_BLOB_KEY "config"
+
+namespace {
+    const uint32_t BLOB_MAGIC = 0x574C4346; // "WLCF"
+    const uint16_t BLOB_VERSION = 9;
+
+    struct __attribute__((packed)) TankBlob {
+        char name[17];
+        int8_t triggerPin;
+        int8_t echoPin;
+        float depth;
+        uint8_t shape;
+        float diameter;
+        float width;
+        float length;
+    };
+
+    // On-flash layout. Fields may only be appended (bump BLOB_VERSION when doing so);
+    // a shorter blob from older firmware keeps defaults for the fields it lacks.
+    struct __attribute__((packed)) ConfigBlob {
+        char wifiSsid[33];
+        char wifiPassword[65];
+        char mqttServer[65];
+        int32_t mqttPort;
+        char mqttUser[33];
+        char mqttPassword[65];
+        char mqttTopic[97];
+        float tankDepth;
+        uint8_t tankDepthUnit;
+        uint8_t outputUnit;
+        float sensorOffset;
+        float sensorFull;
+        int32_t displayBrightness;
+        uint8_t displayMode;
+        uint8_t displayHardwareType;
+        uint8_t displayScrollEnabled;
+        char staticIp[16];
+        char gateway[16];
+        char subnet[16];
+        char hostname[33];
+        int32_t alertLow;
+        int32_t alertHigh;
+        uint8_t alertMethod;
+        char deviceName[33];
+        uint8_t otaEnabled;
+        int32_t sensorReadInterval;
+        uint8_t tankShape;
+        float tankDiameter;
+        float tankWidth;
+        float tankLength;
+        uint8_t volumeUnit;
+        uint8_t displayType;
+        int32_t ssd1306Width;
+        int32_t ssd1306Height;
+        // v2
+        uint8_t batteryMode;
+        int32_t batterySleepInterval;
+        int32_t batteryUploadEvery;
+        int32_t batteryBurstSamples;
+        // v3
+        int32_t wifiScanMaxAge;
+        // v4
+        uint8_t tankCount;
+        TankBlob extraTanks[MAX_TANKS - 1];
+        // v5
+        uint8_t adaptiveSampling;
+        int32_t sampleMinInterval;
+        int32_t sampleMaxInterval;
+        // v6
+        float anomalySigma;
+        // v7
+        uint8_t pumpEnabled;
+        int8_t pumpPin;
+        uint8_t pumpActiveLow;
+        uint8_t pumpStartPercent;
+        uint8_t pumpStopPercent;
+        int32_t pumpMinOnTime;
+        int32_t pumpMinOffTime;
+        int32_t pumpDryRunTime;
+        float pumpDryRunRise;
+        int32_t pumpMaxRunTime;
+        // v8
+        uint8_t modbusEnabled;
+        // v9
+        uint8_t fleetBroadcast;
+        int32_t fleetInterval;
+        uint8_t fleetHub;
+    };
+
+    struct __attribute__((packed)) BlobHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t length; // payload bytes following the header
+        uint32_t crc;    // CRC-32 of the payload
+    };
+
+    uint32_t crc32(const uint8_t* data, size_t len) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < len; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    template <size_t N>
+    void packString(char (&dst)[N], const String& src) {
+        strncpy(dst, src.c_str(), N - 1);
+        dst[N - 1] = '\0';
+    }
+
+    template <size_t N>
+    String unpackString(const char (&src)[N]) {
+        char buf[N];
+        memcpy(buf, src, N);
+        buf[N - 1] = '\0';
+        return String(buf);
+    }
+
+    void pack(const Config& c, ConfigBlob& b) {
+        memset(&b, 0, sizeof(b));
+        packString(b.wifiSsid, c.wifiSsid);
+        packString(b.wifiPassword, c.wifiPassword);
+        packString(b.mqttServer, c.mqttServer);
+        b.mqttPort = c.mqttPort;
+        packString(b.mqttUser, c.mqttUser);
+        packString(b.mqttPassword, c.mqttPassword);
+        packString(b.mqttTopic, c.mqttTopic);
+        b.tankDepth = c.tankDepth;
+        b.tankDepthUnit = (uint8_t)c.tankDepthUnit;
+        b.outputUnit = (uint8_t)c.outputUnit;
+        b.sensorOffset = c.sensorOffset;
+        b.sensorFull = c.sensorFull;
+        b.displayBrightness = c.displayBrightness;
+        b.displayMode = (uint8_t)c.displayMode;
+        b.displayHardwareType = (uint8_t)c.displayHardwareType;
+        b.displayScrollEnabled = c.displayScrollEnabled;
+        packString(b.staticIp, c.staticIp);
+        packString(b.gateway, c.gateway);
+        packString(b.subnet, c.subnet);
+        packString(b.hostname, c.hostname);
+        b.alertLow = c.alertLow;
+        b.alertHigh = c.alertHigh;
+        b.alertMethod = (uint8_t)c.alertMethod;
+        packString(b.deviceName, c.deviceName);
+        b.otaEnabled = c.otaEnabled;
+        b.sensorReadInterval = c.sensorReadInterval;
+        b.tankShape = (uint8_t)c.tankShape;
+        b.tankDiameter = c.tankDiameter;
+        b.tankWidth = c.tankWidth;
+        b.tankLength = c.tankLength;
+        b.volumeUnit = (uint8_t)c.volumeUnit;
+        b.displayType = (uint8_t)c.displayType;
+        b.ssd1306Width = c.ssd1306Width;
+        b.ssd1306Height = c.ssd1306Height;
+        b.batteryMode = c.batteryMode;
+        b.batterySleepInterval = c.batterySleepInterval;
+        b.batteryUploadEvery = c.batteryUploadEvery;
+        b.batteryBurstSamples = c.batteryBurstSamples;
+        b.wifiScanMaxAge = c.wifiScanMaxAge;
+        b.tankCount = c.tankCount;
+        for (uint8_t i = 0; i < MAX_TANKS - 1; ++i) {
+            const TankConfig& t = c.extraTanks[i];
+            TankBlob& tb = b.extraTanks[i];
+            packString(tb.name, t.name);
+            tb.triggerPin = t.triggerPin;
+            tb.echoPin = t.echoPin;
+            tb.depth = t.depth;
+            tb.shape = (uint8_t)t.shape;
+            tb.diameter = t.diameter;
+            tb.width = t.width;
+            tb.length = t.length;
+        }
+        b.adaptiveSampling = c.adaptiveSampling;
+        b.sampleMinInterval = c.sampleMinInterval;
+        b.sampleMaxInterval = c.sampleMaxInterval;
+        b.anomalySigma = c.anomalySigma;
+        b.pumpEnabled = c.pumpEnabled;
+        b.pumpPin = c.pumpPin;
+        b.pumpActiveLow = c.pumpActiveLow;
+        b.pumpStartPercent = c.pumpStartPercent;
+        b.pumpStopPercent = c.pumpStopPercent;
+        b.pumpMinOnTime = c.pumpMinOnTime;
+        b.pumpMinOffTime = c.pumpMinOffTime;
+        b.pumpDryRunTime = c.pumpDryRunTime;
+        b.pumpDryRunRise = c.pumpDryRunRise;
+        b.pumpMaxRunTime = c.pumpMaxRunTime;
+        b.modbusEnabled = c.modbusEnabled;
+        b.fleetBroadcast = c.fleetBroadcast;
+        b.fleetInterval = c.fleetInterval;
+        b.fleetHub = c.fleetHub;
+    }
+
+    void unpack(const ConfigBlob& b, Config& c) {
+        c.wifiSsid = unpackString(b.wifiSsid);
+        c.wifiPassword = unpackString(b.wifiPassword);
+        c.mqttServer = unpackString(b.mqttServer);
+        c.mqttPort = b.mqttPort;
+        c.mqttUser = unpackString(b.mqttUser);
+        c.mqttPassword = unpackString(b.mqttPassword);
+        c.mqttTopic = unpackString(b.mqttTopic);
+        c.tankDepth = b.tankDepth;
+        c.tankDepthUnit = (LengthUnit)b.tankDepthUnit;
+        c.outputUnit = (OutputUnit)b.outputUnit;
+        c.sensorOffset = b.sensorOffset;
+        c.sensorFull = b.sensorFull;
+        c.displayBrightness = b.displayBrightness;
+        c.displayMode = (DisplayMode)b.displayMode;
+        c.displayHardwareType = (DisplayHardwareType)b.displayHardwareType;
+        c.displayScrollEnabled = b.displayScrollEnabled != 0;
+        c.staticIp = unpackString(b.staticIp);
+        c.gateway = unpackString(b.gateway);
+        c.subnet = unpackString(b.subnet);
+        c.hostname = unpackString(b.hostname);
+        c.alertLow = b.alertLow;
+        c.alertHigh = b.alertHigh;
+        c.alertMethod = (AlertMethod)b.alertMethod;
+        c.deviceName = unpackString(b.deviceName);
+        c.otaEnabled = b.otaEnabled != 0;
+        c.sensorReadInterval = b.sensorReadInterval;
+        c.tankShape = (TankShape)b.tankShape;
+        c.tankDiameter = b.tankDiameter;
+        c.tankWidth = b.tankWidth;
+        c.tankLength = b.tankLength;
+        c.volumeUnit = (VolumeUnit)b.volumeUnit;
+        c.displayType = (DisplayType)b.displayType;
+        c.ssd1306Width = b.ssd1306Width;
+        c.ssd1306Height = b.ssd1306Height;
+        c.batteryMode = b.batteryMode != 0;
+        c.batterySleepInterval = b.batterySleepInterval;
+        c.batteryUploadEvery = b.batteryUploadEvery;
+        c.batteryBurstSamples = b.batteryBurstSamples;
+        c.wifiScanMaxAge = b.wifiScanMaxAge;
+        c.tankCount = b.tankCount >= 1 && b.tankCount <= MAX_TANKS ? b.tankCount : 1;
+        for (uint8_t i = 0; i < MAX_TANKS - 1; ++i) {
+            const TankBlob& tb = b.extraTanks[i];
+            TankConfig& t = c.extraTanks[i];
+            t.name = unpackString(tb.name);
+            t.triggerPin = tb.triggerPin;
+            t.echoPin = tb.echoPin;
+            t.depth = tb.depth;
+            t.shape = (TankShape)tb.shape;
+            t.diameter = tb.diameter;
+            t.width = tb.width;
+            t.length = tb.length;
+        }
+        c.adaptiveSampling = b.adaptiveSampling != 0;
+        c.sampleMinInterval = b.sampleMinInterval;
+        c.sampleMaxInterval = b.sampleMaxInterval;
+        c.anomalySigma = b.anomalySigma;
+        c.pumpEnabled = b.pumpEnabled != 0;
+        c.pumpPin = b.pumpPin;
+        c.pumpActiveLow = b.pumpActiveLow != 0;
+        c.pumpStartPercent = b.pumpStartPercent;
+        c.pumpStopPercent = b.pumpStopPercent;
+        c.pumpMinOnTime = b.pumpMinOnTime;
+        c.pumpMinOffTime = b.pumpMinOffTime;
+        c.pumpDryRunTime = b.pumpDryRunTime;
+        c.pumpDryRunRise = b.pumpDryRunRise;
+        c.pumpMaxRunTime = b.pumpMaxRunTime;
+        c.modbusEnabled = b.modbusEnabled != 0;
+        c.fleetBroadcast = b.fleetBroadcast != 0;
+        c.fleetInterval = b.fleetInterval;
+        c.fleetHub = b.fleetHub != 0;
+    }
+
+    struct __attribute__((packed)) StoredConfig {
+        BlobHeader header;
+        ConfigBlob payload;
+    };
+}
+
+Config Config::forTank(uint8_t tank) const {
+    Config c = *this;
+    if (tank == 0 || tank >= MAX_TANKS) return c;
+    const TankConfig& t = extraTanks[tank - 1];
+    c.deviceName = t.name;
+    c.tankDepth = t.depth;
+    c.tankShape = t.shape;
+    c.tankDiameter = t.diameter;
+    c.tankWidth = t.width;
+    c.tankLength = t.length;
+    return c;
+}
+
+volatile uint32_t ConfigManager::_generation = 0;
+ConfigChangeCallback ConfigManager::_changeCallback = nullptr;
+
+namespace {
+    // In-RAM copy of the stored config; authoritative once loaded. Guards String members,
+    // so a mutex rather than a critical section.
+    SemaphoreHandle_t cacheLock = xSemaphoreCreateMutex();
+    Config cached;
+    bool cacheValid = false;
+    bool dirty = false;
+    unsigned long lastChange = 0;
+
+    struct CacheGuard {
+        CacheGuard() { xSemaphoreTake(cacheLock, portMAX_DELAY); }
+        ~CacheGuard() { xSemaphoreGive(cacheLock); }
+    };
+
+    bool writeBlob(const Config& config) {
+        StoredConfig stored;
+        pack(config, stored.payload);
+        stored.header.magic = BLOB_MAGIC;
+        stored.header.version = BLOB_VERSION;
+        stored.header.length = sizeof(ConfigBlob);
+        stored.header.crc = crc32((const uint8_t*)&stored.payload, sizeof(ConfigBlob));
+
+        Preferences prefs;
+        if (!prefs.begin(PREF_NAMESPACE, false)) return false;
+        size_t written = prefs.putBytes(PREF_BLOB_KEY, &stored, sizeof(stored));
+        prefs.end();
+        return written == sizeof(stored);
+    }
+
+    // Keys of the pre-blob layout, one per field (see loadLegacy)
+    const char* const LEGACY_KEYS[] = {
+        "wifiSsid", "wifiPassword", "mqttServer", "mqttPort", "mqttUser", "mqttPassword", "mqttTopic",
+        "tankDepth", "outputUnit", "sensorOffset", "sensorFull", "displayBrightness", "displayMode",
+        "displayHardwareType", "displayScrollEnabled", "staticIp", "gateway", "subnet", "hostname",
+        "alertLow", "alertHigh", "alertMethod", "deviceName", "otaEnabled", "sensorReadInterval",
+        "tankDepthUnit", "tankShape", "tankWidth", "tankLength", "tankDiameter", "volumeUnit",
+        "displayType", "ssd1306Width", "ssd1306Height"
+    };
+
+    // Only once the blob is stored, so an interrupted migration leaves a full copy of the settings
+    void removeLegacyKeys() {
+        Preferences prefs;
+        if (!prefs.begin(PREF_NAMESPACE, false)) return;
+        for (const char* key : LEGACY_KEYS) {
+            if (prefs.isKey(key)) prefs.remove(key);
+        }
+        prefs.end();
+    }
+}
 
 ConfigManager::ConfigManager() {}
 
 bool ConfigManager::load(Config& config) const {
+    {
+        CacheGuard guard;
+        if (cacheValid) {
+            config = cached;
+            return true;
+        }
+    }
+    bool ok = loadStored(config);
+    CacheGuard guard;
+    if (!cacheValid) {
+        cached = config;
+        cacheValid = true;
+    }
+    return ok;
+}
+
+bool ConfigManager::loadStored(Config& config) const {
     Preferences prefs;
     if (!prefs.begin(PREF_NAMESPACE, true)) {
         Logger::error("[ConfigManager] Failed to open NVS namespace 'waterlevel' in read mode. Initializing with defaults.");
-        // Save defaults to create the namespace
-        save(config); // config already has defaults from struct
-        // Try again to open in read mode
-        if (!prefs.begin(PREF_NAMESPACE, true)) {
-            Logger::error("[ConfigManager] Failed to create NVS namespace 'waterlevel' after initializing defaults.");
-            return false;
+        config = Config();
+        return writeBlob(config);
+    }
+
+    size_t storedLen = prefs.getBytesLength(PREF_BLOB_KEY);
+    if (storedLen == 0) {
+        prefs.end();
+        if (!loadLegacy(config)) {
+            config = Config();
+            return writeBlob(config);
         }
+        Logger::info("[ConfigManager] Migrating per-key settings to config blob.");
+        if (!writeBlob(config)) return false; // the old keys stay and the migration is retried next boot
+        removeLegacyKeys();
+        return true;
+    }
+
+    StoredConfig stored;
+    memset(&stored, 0, sizeof(stored));
+    size_t readLen = prefs.getBytes(PREF_BLOB_KEY, &stored, storedLen < sizeof(stored) ? storedLen : sizeof(stored));
+    prefs.end();
+
+    const BlobHeader& header = stored.header;
+    size_t payloadLen = readLen > sizeof(BlobHeader) ? readLen - sizeof(BlobHeader) : 0;
+    if (header.magic != BLOB_MAGIC || header.length > payloadLen ||
+        crc32((const uint8_t*)&stored.payload, header.length) != header.crc) {
+        Logger::error("[ConfigManager] Config blob is corrupt. Using defaults.");
+        config = Config();
+        return false;
+    }
+
+    // Start from defaults so fields missing from an older, shorter blob keep their default value
+    ConfigBlob blob;
+    pack(Config(), blob);
+    memcpy(&blob, &stored.payload, header.length);
+    unpack(blob, config);
+    return true;
+}
+
+bool ConfigManager::save(const Config& config) const {
+    {
+        CacheGuard guard;
+        if (!writeBlob(config)) return false;
+        cached = config;
+        cacheValid = true;
+        dirty = false;
+    }
+    notifyChanged();
+    return true;
+}
+
+void ConfigManager::update(std::function<void(Config&)> change) const {
+    if (!cacheValid) {
+        Config current;
+        load(current);
+    }
+    {
+        CacheGuard guard;
+        change(cached);
+        dirty = true;
+        lastChange = millis();
+    }
+    notifyChanged();
+}
+
+bool ConfigManager::flush() const {
+    CacheGuard guard;
+    if (!dirty) return true;
+    if (!writeBlob(cached)) return false;
+    dirty = false;
+    return true;
+}
+
+void ConfigManager::flushIfIdle(unsigned long quietMs) const {
+    {
+        CacheGuard guard;
+        if (!dirty || millis() - lastChange < quietMs) return;
+    }
+    if (flush()) {
+        Logger::info("[ConfigManager] Pending changes written to NVS.");
+    } else {
+        Logger::error("[ConfigManager] Failed to write pending changes.");
+    }
+}
+
+bool ConfigManager::hasPendingWrites() {
+    return dirty;
+}
+
+void ConfigManager::reset() const {
+    Preferences prefs;
+    if (prefs.begin(PREF_NAMESPACE, false)) {
+        prefs.clear();
+        prefs.end();
+    }
+    CacheGuard guard;
+    cacheValid = false;
+    dirty = false;
+}
+
+void ConfigManager::notifyChanged() {
+    _generation++;
+    if (_changeCallback) _changeCallback();
+}
+
+uint32_t ConfigManager::generation() {
+    return _generation;
+}
+
+void ConfigManager::setChangeCallback(ConfigChangeCallback cb) {
+    _changeCallback = cb;
+}
+
+// Reads the pre-blob layout with one NVS key per field. Returns false if none is present.
+bool ConfigManager::loadLegacy(Config& config) const {
+    Preferences prefs;
+    if (!prefs.begin(PREF_NAMESPACE, true)) return false;
+    if (!prefs.isKey("tankDepth") && !prefs.isKey("wifiSsid")) {
+        prefs.end();
+        return false;
     }
 
     config.wifiSsid = prefs.getString("wifiSsid", "");
@@ -27,12 +500,12 @@ bool ConfigManager::load(Config& config) const {
     config.mqttPassword = prefs.getString("mqttPassword", "");
     config.mqttTopic = prefs.getString("mqttTopic", "home/waterlevel");
     config.tankDepth = prefs.getFloat("tankDepth", 100.0f);
-    config.outputUnit = prefs.getString("outputUnit", "cm");
+    enumFromString(prefs.getString("outputUnit", "cm"), config.outputUnit);
     config.sensorOffset = prefs.getFloat("sensorOffset", 0.0f);
     config.sensorFull = prefs.getFloat("sensorFull", 0.0f);
     config.displayBrightness = prefs.getInt("displayBrightness", 8);
-    config.displayMode = prefs.getString("displayMode", "level");
-    config.displayHardwareType = prefs.getString("displayHardwareType", "FC16_HW");
+    enumFromString(prefs.getString("displayMode", "level"), config.displayMode);
+    enumFromString(prefs.getString("displayHardwareType", "FC16_HW"), config.displayHardwareType);
     config.displayScrollEnabled = prefs.getBool("displayScrollEnabled", true);
     config.staticIp = prefs.getString("staticIp", "");
     config.gateway = prefs.getString("gateway", "");
@@ -40,71 +513,20 @@ bool ConfigManager::load(Config& config) const {
     config.hostname = prefs.getString("hostname", "");
     config.alertLow = prefs.getInt("alertLow", 0);
     config.alertHigh = prefs.getInt("alertHigh", 100);
-    config.alertMethod = prefs.getString("alertMethod", "mqtt");
+    enumFromString(prefs.getString("alertMethod", "mqtt"), config.alertMethod);
     config.deviceName = prefs.getString("deviceName", "");
-    config.otaEnabled = prefs.getString("otaEnabled", "off");
+    config.otaEnabled = prefs.getString("otaEnabled", "off") == "on";
     config.sensorReadInterval = prefs.getInt("sensorReadInterval", 1);
-    config.tankDepthUnit = prefs.getString("tankDepthUnit", "cm");
-    config.tankShape = prefs.getString("tankShape", "rectangle");
+    enumFromString(prefs.getString("tankDepthUnit", "cm"), config.tankDepthUnit);
+    enumFromString(prefs.getString("tankShape", "rectangle"), config.tankShape);
     config.tankWidth = prefs.getFloat("tankWidth", 0.0f);
     config.tankLength = prefs.getFloat("tankLength", 0.0f);
     config.tankDiameter = prefs.getFloat("tankDiameter", 0.0f);
-    config.volumeUnit = prefs.getString("volumeUnit", "L");
-    config.displayType = prefs.getString("displayType", "matrix");
+    enumFromString(prefs.getString("volumeUnit", "L"), config.volumeUnit);
+    enumFromString(prefs.getString("displayType", "matrix"), config.displayType);
     config.ssd1306Width = prefs.getInt("ssd1306Width", 128);
     config.ssd1306Height = prefs.getInt("ssd1306Height", 64);
 
     prefs.end();
     return true;
 }
-
-bool ConfigManager::save(const Config& config) const {
-    Preferences prefs;
-    if (!prefs.begin(PREF_NAMESPACE, false)) return false;
-
-    prefs.putString("wifiSsid", config.wifiSsid);
-    prefs.putString("wifiPassword", config.wifiPassword);
-    prefs.putString("mqttServer", config.mqttServer);
-    prefs.putInt   ("mqttPort", config.mqttPort);
-    prefs.putString("mqttUser", config.mqttUser);
-    prefs.putString("mqttPassword", config.mqttPassword);
-    prefs.putString("mqttTopic", config.mqttTopic);
-    prefs.putFloat ("tankDepth", config.tankDepth);
-    prefs.putString("outputUnit", config.outputUnit);
-    prefs.putFloat ("sensorOffset", config.sensorOffset);
-    prefs.putFloat ("sensorFull", config.sensorFull);
-    prefs.putInt   ("displayBrightness", config.displayBrightness);
-    prefs.putString("displayMode", config.displayMode);
-    prefs.putString("displayHardwareType", config.displayHardwareType);
-    prefs.putBool("displayScrollEnabled", config.displayScrollEnabled);
-    prefs.putString("staticIp", config.staticIp);
-    prefs.putString("gateway", config.gateway);
-    prefs.putString("subnet", config.subnet);
-    prefs.putString("hostname", config.hostname);
-    prefs.putInt   ("alertLow", config.alertLow);
-    prefs.putInt   ("alertHigh", config.alertHigh);
-    prefs.putString("alertMethod", config.alertMethod);
-    prefs.putString("deviceName", config.deviceName);
-    prefs.putString("otaEnabled", config.otaEnabled);
-    prefs.putInt   ("sensorReadInterval", config.sensorReadInterval);
-    prefs.putString("tankDepthUnit", config.tankDepthUnit);
-    prefs.putString("tankShape", config.tankShape);
-    prefs.putFloat("tankWidth", config.tankWidth);
-    prefs.putFloat("tankLength", config.tankLength);
-    prefs.putFloat("tankDiameter", config.tankDiameter);
-    prefs.putString("volumeUnit", config.volumeUnit);
-    prefs.putString("displayType", config.displayType);
-    prefs.putInt("ssd1306Width", config.ssd1306Width);
-    prefs.putInt("ssd1306Height", config.ssd1306Height);
-
-    prefs.end();
-    return true;
-}
-
-void ConfigManager::reset() const {
-    Preferences prefs;
-    if (prefs.begin(PREF_NAMESPACE, false)) {
-        prefs.clear();
-        prefs.end();
-    }
-}
@@ -1,22 +1,40 @@
 #pragma once
 #include <WString.h>
+#include <functional>
+#include "ConfigTypes.h"
+
+// Ultrasonic sensors the firmware can drive, one per tank. Tank 0 is the primary
+// tank described by the top-level Config fields.
+const uint8_t MAX_TANKS = 4;
+
+// Pins and geometry of an additional tank (1..MAX_TANKS-1)
+struct TankConfig {
+    String name;
+    int triggerPin = -1;
+    int echoPin = -1;
+    float depth = 100.0f;      // in cm
+    TankShape shape = TankShape::RECTANGLE;
+    float diameter = 0.0f;
+    float width = 0.0f;
+    float length = 0.0f;
+};
 
 struct Config {
     String wifiSsid = "CodeRunner";
     String wifiPassword = "qWe123!@#";
     String mqttServer;
-    int mqttPort;
+    int mqttPort = 1883;
     String mqttUser;
     String mqttPassword;
-    String mqttTopic;
+    String mqttTopic = "home/waterlevel";
     float tankDepth = 100.0f;
-    String tankDepthUnit = "cm";
-    String outputUnit = "cm";
+    LengthUnit tankDepthUnit = LengthUnit::CM;
+    OutputUnit outputUnit = OutputUnit::CM;
     float sensorOffset = 0.0f;
     float sensorFull = 0.0f;
     int displayBrightness = 8;
-    String displayMode = "level";
-    String displayHardwareType = "FC16_HW";
+    DisplayMode displayMode = DisplayMode::LEVEL;
+    DisplayHardwareType displayHardwareType = DisplayHardwareType::FC16_HW;
     bool displayScrollEnabled = true;
     String staticIp = "";
     String gateway = "";
@@ -24,25 +42,80 @@ struct Config {
     String hostname = "";
     int alertLow = 0;
     int alertHigh = 100;
-    String alertMethod = "mqtt";
+    AlertMethod alertMethod = AlertMethod::MQTT;
     String deviceName = "";
-    String otaEnabled = "off";
+    bool otaEnabled = false;
     int sensorReadInterval = 1; // JSN-SR04T reading interval in seconds (min 1)
-    String tankShape = "rectangle"; // or "cylinder"
+    TankShape tankShape = TankShape::RECTANGLE;
     float tankDiameter = 0.0f; // for cylinder, in cm
     float tankWidth = 0.0f;    // for rectangle, in cm
     float tankLength = 0.0f;   // for rectangle, in cm
-    String volumeUnit = "L"; // for liters or gallons
-    String displayType = "matrix"; // 'matrix', 'sevensegment', or 'ssd1306'
+    VolumeUnit volumeUnit = VolumeUnit::LITERS;
+    DisplayType displayType = DisplayType::MATRIX;
     int ssd1306Width = 128;
     int ssd1306Height = 64;
+    bool batteryMode = false;       // deep-sleep between wakes, upload in bursts
+    int batterySleepInterval = 300; // seconds asleep between wakes
+    int batteryUploadEvery = 12;    // bring up Wi-Fi/MQTT every N wakes
+    int batteryBurstSamples = 5;    // readings per wake, median-filtered
+    int wifiScanMaxAge = 30;        // seconds a cached Wi-Fi scan is served before rescanning
+    bool adaptiveSampling = false;  // vary the read interval with how fast the level moves
+    int sampleMinInterval = 1000;   // adaptive bounds, in ms
+    int sampleMaxInterval = 60000;
+    float anomalySigma = 3.0f;      // consumption drift that raises an anomaly event, 0 = off
+    bool pumpEnabled = false;       // fill pump relay driven from the primary tank's level
+    int pumpPin = -1;
+    bool pumpActiveLow = false;     // relay boards that switch on a LOW input
+    int pumpStartPercent = 20;      // pump starts at or below ...
+    int pumpStopPercent = 90;       // ... and stops at or above
+    int pumpMinOnTime = 60;         // seconds
+    int pumpMinOffTime = 120;       // seconds
+    int pumpDryRunTime = 300;       // seconds of pumping in which the level must rise, 0 = off
+    float pumpDryRunRise = 1.0f;    // % rise expected per pumpDryRunTime
+    int pumpMaxRunTime = 60;        // minutes, 0 = unlimited
+    bool modbusEnabled = false;     // read-only Modbus TCP slave on port 502
+    bool fleetBroadcast = false;    // multicast each tank's reading on the LAN
+    int fleetInterval = 10;         // seconds between broadcasts
+    bool fleetHub = false;          // collect other devices' broadcasts for /api/fleet
+    int tankCount = 1;              // sensors in use, including the primary tank
+    TankConfig extraTanks[MAX_TANKS - 1];
+
+    // This config with the geometry and name of `tank` in place of the primary tank's,
+    // so the per-sample derivations work unchanged for every tank
+    Config forTank(uint8_t tank) const;
 };
 
+typedef void (*ConfigChangeCallback)();
+
 class ConfigManager {
 public:
     ConfigManager();
 
+    // Config is persisted as one versioned, CRC-checked blob under a single NVS key.
+    // Devices still on the old one-key-per-field layout are migrated on first load.
+    // After the first load, reads are served from an in-RAM copy.
     bool load(Config& config) const;
+    // Writes through to NVS immediately.
     bool save(const Config& config) const;
     void reset() const;
+
+    // Write-back path for live controls: applies the change to the in-RAM config and
+    // notifies listeners now, but defers the NVS write until flushIfIdle() sees no
+    // further changes for quietMs. Repeated updates coalesce into one flash write.
+    void update(std::function<void(Config&)> change) const;
+    bool flush() const;
+    void flushIfIdle(unsigned long quietMs) const;
+    static bool hasPendingWrites();
+
+    // Incremented on every save or update, so readers can cheaply detect changes.
+    static uint32_t generation();
+    static void setChangeCallback(ConfigChangeCallback cb);
+
+private:
+    static volatile uint32_t _generation;
+    static ConfigChangeCallback _changeCallback;
+
+    static void notifyChanged();
+    bool loadStored(Config& config) const;
+    bool loadLegacy(Config& config) const;
 };
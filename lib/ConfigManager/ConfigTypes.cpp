@@ -0,0 +1,91 @@
+#include "ConfigTypes.h"
+#include <string.h>
+
+namespace {
+    constexpr EnumName<DisplayMode> DISPLAY_MODE_NAMES[] = {
+        { DisplayMode::LEVEL,    "level" },
+        { DisplayMode::PERCENT,  "percent" },
+        { DisplayMode::DISTANCE, "distance" },
+        { DisplayMode::VOLUME,   "volume" },
+        { DisplayMode::STATUS,   "status" },
+        { DisplayMode::TEXT,     "text" },
+    };
+
+    constexpr EnumName<OutputUnit> OUTPUT_UNIT_NAMES[] = {
+        { OutputUnit::CM,       "cm" },
+        { OutputUnit::IN,       "in" },
+        { OutputUnit::PERCENT,  "percent" },
+        { OutputUnit::QUANTITY, "quantity" },
+    };
+
+    constexpr EnumName<LengthUnit> LENGTH_UNIT_NAMES[] = {
+        { LengthUnit::CM, "cm" },
+        { LengthUnit::IN, "in" },
+    };
+
+    constexpr EnumName<TankShape> TANK_SHAPE_NAMES[] = {
+        { TankShape::RECTANGLE, "rectangle" },
+        { TankShape::CYLINDER,  "cylinder" },
+    };
+
+    constexpr EnumName<DisplayType> DISPLAY_TYPE_NAMES[] = {
+        { DisplayType::MATRIX,        "matrix" },
+        { DisplayType::SEVEN_SEGMENT, "sevensegment" },
+        { DisplayType::SSD1306,       "ssd1306" },
+    };
+
+    constexpr EnumName<DisplayHardwareType> DISPLAY_HARDWARE_TYPE_NAMES[] = {
+        { DisplayHardwareType::FC16_HW,      "FC16_HW" },
+        { DisplayHardwareType::GENERIC_HW,   "GENERIC_HW" },
+        { DisplayHardwareType::PAROLA_HW,    "PAROLA_HW" },
+        { DisplayHardwareType::ICSTATION_HW, "ICSTATION_HW" },
+    };
+
+    constexpr EnumName<VolumeUnit> VOLUME_UNIT_NAMES[] = {
+        { VolumeUnit::LITERS,  "L" },
+        { VolumeUnit::GALLONS, "gal" },
+    };
+
+    constexpr EnumName<AlertMethod> ALERT_METHOD_NAMES[] = {
+        { AlertMethod::MQTT,   "mqtt" },
+        { AlertMethod::BUZZER, "buzzer" },
+        { AlertMethod::LED,    "led" },
+    };
+
+    template <typename E, size_t N>
+    const char* lookupName(const EnumName<E> (&table)[N], E value) {
+        for (size_t i = 0; i < N; ++i) {
+            if (table[i].value == value) return table[i].name;
+        }
+        return table[0].name;
+    }
+
+    template <typename E, size_t N>
+    bool lookupValue(const EnumName<E> (&table)[N], const String& name, E& out) {
+        for (size_t i = 0; i < N; ++i) {
+            if (strcmp(table[i].name, name.c_str()) == 0) {
+                out = table[i].value;
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+const char* enumToString(DisplayMode value)         { return lookupName(DISPLAY_MODE_NAMES, value); }
+const char* enumToString(OutputUnit value)          { return lookupName(OUTPUT_UNIT_NAMES, value); }
+const char* enumToString(LengthUnit value)          { return lookupName(LENGTH_UNIT_NAMES, value); }
+const char* enumToString(TankShape value)           { return lookupName(TANK_SHAPE_NAMES, value); }
+const char* enumToString(DisplayType value)         { return lookupName(DISPLAY_TYPE_NAMES, value); }
+const char* enumToString(DisplayHardwareType value) { return lookupName(DISPLAY_HARDWARE_TYPE_NAMES, value); }
+const char* enumToString(VolumeUnit value)          { return lookupName(VOLUME_UNIT_NAMES, value); }
+const char* enumToString(AlertMethod value)         { return lookupName(ALERT_METHOD_NAMES, value); }
+
+bool enumFromString(const String& name, DisplayMode& out)         { return lookupValue(DISPLAY_MODE_NAMES, name, out); }
+bool enumFromString(const String& name, OutputUnit& out)          { return lookupValue(OUTPUT_UNIT_NAMES, name, out); }
+bool enumFromString(const String& name, LengthUnit& out)          { return lookupValue(LENGTH_UNIT_NAMES, name, out); }
+bool enumFromString(const String& name, TankShape& out)           { return lookupValue(TANK_SHAPE_NAMES, name, out); }
+bool enumFromString(const String& name, DisplayType& out)         { return lookupValue(DISPLAY_TYPE_NAMES, name, out); }
+bool enumFromString(const String& name, DisplayHardwareType& out) { return lookupValue(DISPLAY_HARDWARE_TYPE_NAMES, name, out); }
+bool enumFromString(const String& name, VolumeUnit& out)          { return lookupValue(VOLUME_UNIT_NAMES, name, out); }
+bool enumFromString(const String& name, AlertMethod& out)         { return lookupValue(ALERT_METHOD_NAMES, name, out); }
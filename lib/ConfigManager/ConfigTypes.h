@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <WString.h>
+
+// Compact enum-typed config fields. Names are only used at the web/NVS boundary;
+// everything else compares these as integers.
+
+enum class DisplayMode : uint8_t { LEVEL, PERCENT, DISTANCE, VOLUME, STATUS, TEXT };
+enum class OutputUnit : uint8_t { CM, IN, PERCENT, QUANTITY };
+enum class LengthUnit : uint8_t { CM, IN };
+enum class TankShape : uint8_t { RECTANGLE, CYLINDER };
+enum class DisplayType : uint8_t { MATRIX, SEVEN_SEGMENT, SSD1306 };
+enum class DisplayHardwareType : uint8_t { FC16_HW, GENERIC_HW, PAROLA_HW, ICSTATION_HW };
+enum class VolumeUnit : uint8_t { LITERS, GALLONS };
+enum class AlertMethod : uint8_t { MQTT, BUZZER, LED };
+
+template <typename E>
+struct EnumName {
+    E value;
+    const char* name;
+};
+
+// Returns the web/NVS name of a value (the first table entry for unknown values).
+const char* enumToString(DisplayMode value);
+const char* enumToString(OutputUnit value);
+const char* enumToString(LengthUnit value);
+const char* enumToString(TankShape value);
+const char* enumToString(DisplayType value);
+const char* enumToString(DisplayHardwareType value);
+const char* enumToString(VolumeUnit value);
+const char* enumToString(AlertMethod value);
+
+// Parses a web/NVS name. Leaves out untouched and returns false if the name is unknown.
+bool enumFromString(const String& name, DisplayMode& out);
+bool enumFromString(const String& name, OutputUnit& out);
+bool enumFromString(const String& name, LengthUnit& out);
+bool enumFromString(const String& name, TankShape& out);
+bool enumFromString(const String& name, DisplayType& out);
+bool enumFromString(const String& name, DisplayHardwareType& out);
+bool enumFromString(const String& name, VolumeUnit& out);
+bool enumFromString(const String& name, AlertMethod& out);
@@ -0,0 +1,131 @@
+#include "AdmissionControl.h"
+#include <Arduino.h>
+#include "Metrics.h"
+
+namespace {
+    const uint8_t MAX_IN_FLIGHT = 6;
+    // Heavy requests build JSON in Strings or hold a LittleFS file open (a few KB
+    // each); the rest is headroom for lwIP and MQTT. Pages render into the
+    // arena pool and are not checked against these.
+    const uint32_t HEAVY_MIN_FREE_HEAP = 24 * 1024;
+    const uint32_t HEAVY_MIN_LARGEST_BLOCK = 12 * 1024;
+    const char* RETRY_AFTER_SECONDS = "2";
+
+    volatile uint8_t inFlight = 0;
+    uint8_t inFlightPeak = 0;
+
+    bool hasSuffix(const String& url, const char* suffix) {
+        return url.endsWith(suffix);
+    }
+
+    // Rendered by beginPage(), whose arena checks the heap itself before going beyond the pool
+    bool isPage(AsyncWebServerRequest *request) {
+        const String& url = request->url();
+        return request->method() == HTTP_GET &&
+               (url == "/" || url.startsWith("/settings/") || url == "/connected" ||
+                url == "/logs" || url == "/fleet" || url == "/help");
+    }
+
+    // Cheap JSON endpoints, pages and static assets; everything else builds Strings or reads files
+    bool isHeavy(AsyncWebServerRequest *request) {
+        const String& url = request->url();
+        if (url == "/api/level" || url == "/api/metrics" || url == "/api/volumeunit" ||
+            url == "/api/display/brightness" || url.startsWith("/api/jobs") || isPage(request)) {
+            return false;
+        }
+        return !(hasSuffix(url, ".css") || hasSuffix(url, ".js") || hasSuffix(url, ".svg") || hasSuffix(url, ".png"));
+    }
+
+    void release() {
+        if (inFlight > 0) inFlight--;
+        Metrics::set("http_in_flight", inFlight);
+    }
+}
+
+RateLimiter::RateLimiter(uint16_t perMinute, uint8_t burst)
+    : _refillPerMinute((uint32_t)perMinute * 1000), _capacity((uint32_t)burst * 1000) {
+    memset(_clients, 0, sizeof(_clients));
+}
+
+bool RateLimiter::allow(uint32_t clientIp, unsigned long now) {
+    Client* slot = nullptr;
+    Client* oldest = &_clients[0];
+    for (uint8_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (_clients[i].ip == clientIp) {
+            slot = &_clients[i];
+            break;
+        }
+        if (_clients[i].lastSeen < oldest->lastSeen || _clients[i].ip == 0) oldest = &_clients[i];
+    }
+    if (!slot) {
+        slot = oldest;
+        slot->ip = clientIp;
+        slot->milliTokens = _capacity;
+        slot->lastSeen = now;
+    }
+
+    uint32_t refill = (uint32_t)((uint64_t)(now - slot->lastSeen) * _refillPerMinute / 60000UL);
+    slot->milliTokens = slot->milliTokens + refill > _capacity ? _capacity : slot->milliTokens + refill;
+    slot->lastSeen = now;
+    if (slot->milliTokens < 1000) return false;
+    slot->milliTokens -= 1000;
+    return true;
+}
+
+AdmissionControl::AdmissionControl()
+    : _historyLimiter(12, 4), _scanLimiter(30, 5) {}
+
+// A claimed request with a body only reaches handleRequest() once the body has
+// arrived, and other requests are matched in between, so the verdict travels with
+// the request in its temp object (freed by the request).
+bool AdmissionControl::canHandle(AsyncWebServerRequest *request) {
+    const String& url = request->url();
+    if (url == "/logs/stream") return false; // long-lived SSE, managed by AsyncEventSource
+
+    Verdict verdict = Verdict::ADMIT;
+    if (inFlight >= MAX_IN_FLIGHT) {
+        verdict = Verdict::BUSY;
+    } else if (isHeavy(request) && (ESP.getFreeHeap() < HEAVY_MIN_FREE_HEAP || ESP.getMaxAllocHeap() < HEAVY_MIN_LARGEST_BLOCK)) {
+        verdict = Verdict::LOW_HEAP;
+    } else {
+        uint32_t ip = (uint32_t)request->client()->remoteIP();
+        unsigned long now = millis();
+        bool history = url == "/api/level/history" || url == "/api/history/export" || url == "/logs/level.csv";
+        if ((history && !_historyLimiter.allow(ip, now)) ||
+            (url == "/scan/wifi" && !_scanLimiter.allow(ip, now))) {
+            verdict = Verdict::RATE_LIMITED;
+        }
+    }
+
+    if (verdict != Verdict::ADMIT) {
+        Verdict* stored = (Verdict*)malloc(sizeof(Verdict));
+        if (stored) *stored = verdict;
+        request->_tempObject = stored;
+        return true; // claim it so handleRequest() can reject it
+    }
+
+    // Released when the connection closes, i.e. once the response has been sent
+    inFlight++;
+    if (inFlight > inFlightPeak) {
+        inFlightPeak = inFlight;
+        Metrics::set("http_in_flight_peak", inFlightPeak);
+    }
+    Metrics::set("http_in_flight", inFlight);
+    Metrics::increment("http_admitted");
+    request->onDisconnect(release);
+    return false;
+}
+
+void AdmissionControl::handleRequest(AsyncWebServerRequest *request) {
+    int code = 503;
+    Verdict verdict = request->_tempObject ? *(Verdict*)request->_tempObject : Verdict::BUSY;
+    switch (verdict) {
+        case Verdict::BUSY:         Metrics::increment("http_rejected_busy"); break;
+        case Verdict::LOW_HEAP:     Metrics::increment("http_rejected_heap"); break;
+        case Verdict::RATE_LIMITED: Metrics::increment("http_rate_limited"); code = 429; break;
+        default: break;
+    }
+    AsyncWebServerResponse *response = request->beginResponse(code, "text/plain", code == 429 ? "Too many requests" : "Server busy");
+    response->addHeader("Retry-After", RETRY_AFTER_SECONDS);
+    request->send(response);
+}
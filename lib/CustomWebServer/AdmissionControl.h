@@ -0,0 +1,37 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+
+// Token bucket per client IPv4 address, over a small fixed table. The least recently
+// seen client is evicted when the table is full.
+class RateLimiter {
+public:
+    RateLimiter(uint16_t perMinute, uint8_t burst);
+    bool allow(uint32_t clientIp, unsigned long now);
+
+private:
+    static const uint8_t MAX_CLIENTS = 8;
+    struct Client {
+        uint32_t ip;
+        uint32_t milliTokens;
+        unsigned long lastSeen;
+    };
+    Client _clients[MAX_CLIENTS];
+    uint32_t _refillPerMinute; // milli-tokens
+    uint32_t _capacity;        // milli-tokens
+};
+
+// First handler in the chain: counts requests in flight and turns them away with
+// 503 + Retry-After when the server is saturated or heap is too low for a heavy
+// page, and with 429 when a client polls an expensive route too often. Admitted
+// requests fall through to the regular handlers. Counters are exported via Metrics.
+class AdmissionControl : public AsyncWebHandler {
+public:
+    AdmissionControl();
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+
+private:
+    enum class Verdict : uint8_t { ADMIT, BUSY, LOW_HEAP, RATE_LIMITED };
+    RateLimiter _historyLimiter;
+    RateLimiter _scanLimiter;
+};
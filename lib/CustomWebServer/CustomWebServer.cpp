@@ -3,159 +3,269 @@
 #include <LittleFS.h>
 #include "Logger.h"
 #include <FS.h>
-
-extern float lastDistance;
-
-// Place getDisplayString at file scope, before any other code
-String getDisplayString(const Config& config, float distance, float& percentOut) {
-    float tankDepth = config.tankDepth > 0 ? config.tankDepth : 100.0f;
-    percentOut = (distance < 0 || tankDepth <= 0) ? 0.0f : ((tankDepth - distance) / tankDepth * 100.0f);
-    if (distance < 0) return "ERROR";
-    if (distance > tankDepth) return "RANGE ERR" + String(distance);
-    if (config.displayMode == "level") {
-        if (config.outputUnit == "cm") {
-            float levelCm = tankDepth - distance;
-            if (levelCm < 0) levelCm = 0;
-            return String(levelCm, 1) + " cm";
-        } else if (config.outputUnit == "in") {
-            float levelIn = (tankDepth - distance) / 2.54f;
-            if (levelIn < 0) levelIn = 0;
-            return String(levelIn, 1) + " in";
-        } else {
-            return String(percentOut, 1) + " %";
-        }
-    } else if (config.displayMode == "distance") {
-        if (config.outputUnit == "cm") {
-            return String(distance, 1) + " cm";
-        } else if (config.outputUnit == "in") {
-            return String(distance/2.54f, 1) + " in";
-        } else {
-            return String(distance, 1) + " %";
+#include "Telemetry.h"
+#include "Metrics.h"
+#include "WiFiScanCache.h"
+#include "JobQueue.h"
+#include "AdmissionControl.h"
+#include "ResponseCache.h"
+#include "HistoryStore.h"
+#include "HistoryExport.h"
+#include "AnomalyDetector.h"
+#include "Forecast.h"
+#include "PumpController.h"
+#include "Fleet.h"
+#include "TimeSync.h"
+#include "PageTemplate.h"
+#include <memory>
+#include <vector>
+
+// Copy of a request's POST fields, so deferred jobs can use them after the request is gone
+class FormParams {
+public:
+    explicit FormParams(AsyncWebServerRequest *request) {
+        for (size_t i = 0; i < request->params(); ++i) {
+            const AsyncWebParameter* p = request->getParam(i);
+            if (p->isPost() && !p->isFile()) _params.push_back(std::make_pair(p->name(), p->value()));
         }
-    } else if (config.displayMode == "percent") {
-        return String(percentOut, 1) + "%";
-    } else if (config.displayMode == "volume") {
-        // Volume calculation
-        float levelCm = tankDepth - distance;
-        if (levelCm < 0) levelCm = 0;
-        float volumeL = 0.0f;
-        if (config.tankShape == "cylinder" && config.tankDiameter > 0) {
-            float radius = config.tankDiameter / 2.0f;
-            float area = 3.14159265f * radius * radius;
-            volumeL = area * levelCm / 1000.0f; // cm^2 * cm = cm^3, /1000 = L
-        } else if (config.tankShape == "rectangle" && config.tankWidth > 0 && config.tankLength > 0) {
-            float area = config.tankWidth * config.tankLength;
-            volumeL = area * levelCm / 1000.0f;
-        } else {
-            return "N/A";
+    }
+    bool has(const char* name) const {
+        for (const auto& p : _params) {
+            if (p.first == name) return true;
         }
-        if (config.outputUnit == "gal") {
-            float volumeGal = volumeL * 0.264172f;
-            return String(volumeGal, 1) + " gal";
-        } else {
-            return String(volumeL, 1) + " L";
+        return false;
+    }
+    String get(const char* name) const {
+        for (const auto& p : _params) {
+            if (p.first == name) return p.second;
         }
-    } else if (config.displayMode == "text") {
-        return config.deviceName.length() ? config.deviceName : "WaterLevel";
-    } else if (config.displayMode == "status") {
-        if (distance < 0) return "ERROR";
-        if (percentOut < config.alertLow) return "LOW";
-        if (percentOut >= config.alertHigh) return "FULL";
-        return "OK";
-    } else {
-        return String(percentOut, 1) + "%";
+        return String();
+    }
+private:
+    std::vector<std::pair<String, String>> _params;
+};
+
+// Queues a config change plus an immediate NVS commit on the job worker
+JobId submitConfigCommit(ConfigManager &configManager, const char* name, std::function<void(Config&)> update) {
+    return JobQueue::submit(name, [&configManager, update]() {
+        configManager.update(update);
+        return configManager.flush();
+    });
+}
+
+// Restarts once the HTTP response has had time to flush
+JobId submitReboot(ConfigManager &configManager) {
+    return JobQueue::submit("reboot", [&configManager]() {
+        configManager.flush(); // don't lose write-back changes still waiting for their quiet period
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        ESP.restart();
+        return true;
+    });
+}
+
+// 202 pointing at the job's status endpoint, or 503 if the queue is full
+void sendAccepted(AsyncWebServerRequest *request, JobId id, const String& contentType, const String& content) {
+    if (id == JobQueue::INVALID_JOB) {
+        request->send(503, contentType, content.length() ? String("<span style='color:red;'>Device busy, try again.</span>") : String());
+        return;
     }
+    AsyncWebServerResponse *response = request->beginResponse(202, contentType, content);
+    response->addHeader("Location", "/api/jobs/" + String(id));
+    request->send(response);
 }
 
-extern volatile bool shouldReboot;
+// ?tank=<n> selects one of the configured tanks; absent or out of range means the primary tank
+uint8_t tankParam(AsyncWebServerRequest *request, const Config& config) {
+    if (!request->hasParam("tank")) return 0;
+    long tank = request->getParam("tank")->value().toInt();
+    return tank > 0 && tank < config.tankCount ? (uint8_t)tank : 0;
+}
 
-String settingsNav(const String &active)
-{
-    String nav = "<nav class='nav'>";
-    nav += "<a href='/' class='nav-brand'>Water Level</a>";
-    nav += "<button class='nav-toggle' aria-label='Toggle navigation'>";
-    nav += "<span></span><span></span><span></span>";
-    nav += "</button>";
-    nav += "<ul class='nav-list'>";
-    nav += "<li><a href='/settings/wifi'" + String(active == "wifi" ? " class='active'" : "") + ">WiFi</a></li>";
-    nav += "<li><a href='/settings/mqtt'" + String(active == "mqtt" ? " class='active'" : "") + ">MQTT</a></li>";
-    nav += "<li><a href='/settings/tank'" + String(active == "tank" ? " class='active'" : "") + ">Tank</a></li>";
-    nav += "<li><a href='/settings/sensor'" + String(active == "sensor" ? " class='active'" : "") + ">Sensor</a></li>";
-    nav += "<li><a href='/settings/display'" + String(active == "display" ? " class='active'" : "") + ">Display</a></li>";
-    nav += "<li><a href='/settings/network'" + String(active == "network" ? " class='active'" : "") + ">Network</a></li>";
-    nav += "<li><a href='/settings/alerts'" + String(active == "alerts" ? " class='active'" : "") + ">Alerts</a></li>";
-    nav += "<li><a href='/settings/device'" + String(active == "device" ? " class='active'" : "") + ">Device</a></li>";
-    nav += "<li><a href='/logs'" + String(active == "logs" ? " class='active'" : "") + ">Logs</a></li>";
-    nav += "<li><a href='/help'" + String(active == "help" ? " class='active'" : "") + ">Help</a></li>";
-    nav += "</ul></nav>";
-    return nav;
+// Upper bound on rows decoded for one history or snapshot request
+const int MAX_HISTORY_ROWS = 1000;
+
+struct HistoryRow {
+    unsigned long timestamp;
+    float distanceCm;
+    float percent;
+    float levelCm;
+    float levelIn;
+    float liters;
+    float gallons;
+};
+
+// Only the distance is stored; the other columns are derived from the current tank config
+HistoryRow deriveHistoryRow(const Config& config, const HistorySample& sample) {
+    Telemetry t = Telemetry::compute(config, sample.distanceCm);
+    HistoryRow row;
+    row.timestamp = sample.timestamp;
+    row.distanceCm = t.distanceCm;
+    row.percent = t.percent;
+    row.levelCm = t.levelCm;
+    row.levelIn = t.levelIn;
+    row.liters = t.liters;
+    row.gallons = t.gallons;
+    return row;
 }
 
-// Helper function to get the common HTML head
-String getHtmlHead(const String &title) {
-    return R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>)rawliteral" + title + R"rawliteral(</title>
-    <link rel="stylesheet" href="/style.css">
-    <link rel="stylesheet" href="/logs.css">
-    <script src="/script.js"></script>
-</head>
-<body>
-)rawliteral";
+std::vector<HistoryRow> deriveHistoryRows(const Config& config, const std::vector<HistorySample>& samples, size_t n) {
+    std::vector<HistoryRow> rows;
+    rows.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        rows.push_back(deriveHistoryRow(config, samples[i]));
+    }
+    return rows;
 }
 
-// Helper function to get the common HTML footer
-String getHtmlFooter() {
-    return R"rawliteral(
-    <footer class="footer">
-        <div class="footer-content">
-            <div class="footer-section">
-                <h4>Water Level Indicator</h4>
-                <p>A smart water level monitoring system with real-time alerts and web interface.</p>
-            </div>
-            <div class="footer-section">
-                <h4>Quick Links</h4>
-                <ul>
-                    <li><a href="/">Home</a></li>
-                    <li><a href="/logs">Logs</a></li>
-                    <li><a href="/help">Help</a></li>
-                </ul>
-            </div>
-            <div class="footer-section">
-                <h4>Connect</h4>
-                <ul>
-                    <li><a href="https://github.com/vtoxi" target="_blank">GitHub</a></li>
-                    <li><a href="mailto:contact@vtoxi.com">Contact</a></li>
-                </ul>
-            </div>
-        </div>
-        <div class="footer-bottom">
-            <p>Designed and developed by <a href="https://github.com/vtoxi">Faisal S.</a></p>
-            <p class="copyright">© 2025 Water Level Indicator. All rights reserved.</p>
-        </div>
-    </footer>
-</body>
-</html>
-)rawliteral";
+// The last `count` rows of the tank's level history, oldest first
+std::vector<HistoryRow> readLevelHistory(const Config& config, int count, uint8_t tank = 0) {
+    if (count > MAX_HISTORY_ROWS) count = MAX_HISTORY_ROWS;
+    std::vector<HistorySample> samples(count);
+    size_t n = HistoryStore::readLast(samples.data(), samples.size(), tank);
+    return deriveHistoryRows(config.forTank(tank), samples, n);
 }
 
-// Helper function to show WiFi warning
-String wifiWarning() {
-    return WiFi.isConnected() ? "" : "<div class='wifi-warning'>WiFi is not connected. Some features may not work.</div>";
+// Rows with from <= timestamp <= to (epoch seconds), oldest first
+std::vector<HistoryRow> readLevelHistoryRange(const Config& config, uint32_t from, uint32_t to, uint8_t tank = 0) {
+    std::vector<HistorySample> samples(MAX_HISTORY_ROWS);
+    size_t n = HistoryStore::readRange(from, to, samples.data(), samples.size(), tank);
+    return deriveHistoryRows(config.forTank(tank), samples, n);
 }
 
-// Helper to load a file from LittleFS as a String
-String loadTemplateFile(const String& path) {
-    File f = LittleFS.open(path, "r");
-    if (!f) return String();
-    String content;
-    while (f.available()) content += (char)f.read();
-    f.close();
-    return content;
+// Streams history as CSV or NDJSON. X-History-Cursor names the first row sent, so an
+// interrupted download resumes with ?cursor=<that>&skip=<rows received>.
+AsyncWebServerResponse* beginHistoryExport(AsyncWebServerRequest* request, const Config& config,
+                                           const HistoryCursor& start, const ExportOptions& options) {
+    std::shared_ptr<HistoryExport> exporter(new HistoryExport(config.forTank(options.tank), start, options));
+    bool csv = options.format == ExportFormat::CSV;
+    AsyncWebServerResponse* response = request->beginChunkedResponse(csv ? "text/csv" : "application/x-ndjson",
+        [exporter](uint8_t* buffer, size_t maxLen, size_t) -> size_t {
+            return exporter->fill(buffer, maxLen);
+        });
+    response->addHeader("X-History-Cursor", HistoryExport::formatCursor(start));
+    response->addHeader("Content-Disposition", csv ? "attachment; filename=\"history.csv\""
+                                                   : "attachment; filename=\"history.ndjson\"");
+    if (options.gzip) response->addHeader("Content-Encoding", "gzip");
+    return response;
+}
+
+// History rows as a JSON array
+String renderLevelHistory(const std::vector<HistoryRow>& rows) {
+    String json = "[";
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const HistoryRow& r = rows[i];
+        if (i > 0) json += ",";
+        json += "{";
+        json += "\"timestamp\":" + String(r.timestamp);
+        json += ",\"distance_cm\":" + String(r.distanceCm, 2);
+        json += ",\"percent\":" + String(r.percent, 1);
+        json += ",\"level_cm\":" + String(r.levelCm, 2);
+        json += ",\"level_in\":" + String(r.levelIn, 2);
+        json += ",\"liters\":" + String(r.liters, 2);
+        json += ",\"gallons\":" + String(r.gallons, 2);
+        json += "}";
+    }
+    json += "]";
+    return json;
+}
+
+// Current reading plus the tank geometry the dashboard needs to draw it.
+// `config` is the tank's view from Config::forTank().
+String renderLevel(const Config& config, const Telemetry& t) {
+    String json = "{";
+    json += "\"tank\":" + String(t.tank);
+    json += ",\"distance_cm\":" + String(t.distanceCm, 2);
+    json += ",\"distance_in\":" + String(t.distanceIn, 2);
+    json += ",\"level_cm\":" + String(t.levelCm, 2);
+    json += ",\"level_in\":" + String(t.levelIn, 2);
+    json += ",\"percent\":" + String(t.percent, 1);
+    json += ",\"liters\":" + String(t.liters, 2);
+    json += ",\"gallons\":" + String(t.gallons, 2);
+    json += ",\"output_unit\":\"" + String(enumToString(config.outputUnit)) + "\"";
+    json += ",\"tank_shape\":\"" + String(enumToString(config.tankShape)) + "\"";
+    json += ",\"tank_depth\":" + String(config.tankDepth, 2);
+    json += ",\"tank_width\":" + String(config.tankWidth, 2);
+    json += ",\"tank_length\":" + String(config.tankLength, 2);
+    json += ",\"tank_diameter\":" + String(config.tankDiameter, 2);
+    json += ",\"display\":\"" + String(t.displayText) + "\"";
+    json += ",\"status\":\"" + String(t.statusName()) + "\"";
+    json += ",\"sample_interval_ms\":" + String(t.sampleIntervalMs);
+    json += ",\"rate_per_min\":" + String(t.ratePerMinute, 2);
+    json += "}";
+    return json;
+}
+
+// Every configured tank's current reading, plus the aggregate ping rate of the sensor array
+String renderTanks(const Config& config) {
+    String json = "{\"samples_per_second\":" + String(Metrics::get("sensor_samples_per_sec_x100") / 100.0f, 2);
+    json += ",\"tanks\":[";
+    for (uint8_t i = 0; i < config.tankCount && i < MAX_TANKS; ++i) {
+        Config tank = config.forTank(i);
+        if (i > 0) json += ",";
+        json += "{\"name\":\"" + (tank.deviceName.length() ? tank.deviceName : "Tank " + String(i + 1)) + "\"";
+        json += ",\"level\":" + renderLevel(tank, TelemetryStore::latest(i));
+        json += "}";
+    }
+    json += "]}";
+    return json;
+}
+
+// Fields for the additional tanks on the Tank settings page
+String renderExtraTanks(const Config& config) {
+    String html = "<label for='tankCount'>Number of Tanks</label><select name='tankCount' id='tankCount'>";
+    for (uint8_t n = 1; n <= MAX_TANKS; ++n) {
+        html += "<option value='" + String(n) + "'" + (config.tankCount == n ? " selected" : "") + ">" + String(n) + "</option>";
+    }
+    html += "</select>";
+    for (uint8_t i = 1; i < MAX_TANKS; ++i) {
+        const TankConfig& t = config.extraTanks[i - 1];
+        String p = "tank" + String(i) + "_";
+        html += "<fieldset class='extra-tank' data-tank='" + String(i) + "'><legend>Tank " + String(i + 1) + "</legend>";
+        html += "<label>Name</label><input name='" + p + "name' maxlength='16' value='" + t.name + "'>";
+        html += "<label>Trigger Pin</label><input name='" + p + "trig' type='number' min='-1' max='39' value='" + String(t.triggerPin) + "'>";
+        html += "<label>Echo Pin</label><input name='" + p + "echo' type='number' min='-1' max='39' value='" + String(t.echoPin) + "'>";
+        html += "<label>Depth (cm)</label><input name='" + p + "depth' type='number' step='0.1' value='" + String(t.depth, 1) + "'>";
+        html += "<label>Shape</label><select name='" + p + "shape'>";
+        html += "<option value='rectangle'" + String(t.shape == TankShape::RECTANGLE ? " selected" : "") + ">Rectangle</option>";
+        html += "<option value='cylinder'" + String(t.shape == TankShape::CYLINDER ? " selected" : "") + ">Cylinder</option></select>";
+        html += "<label>Width (cm)</label><input name='" + p + "width' type='number' step='0.1' value='" + String(t.width, 1) + "'>";
+        html += "<label>Length (cm)</label><input name='" + p + "length' type='number' step='0.1' value='" + String(t.length, 1) + "'>";
+        html += "<label>Diameter (cm)</label><input name='" + p + "diameter' type='number' step='0.1' value='" + String(t.diameter, 1) + "'>";
+        html += "</fieldset>";
+    }
+    return html;
+}
+
+// Everything the dashboard needs in one document: the current level, unit settings and
+// the last `window` log rows averaged down to at most `points` columnar samples.
+String renderSnapshot(const Config& config, int window, int points) {
+    Telemetry t = TelemetryStore::latest();
+    String json;
+    json.reserve(768 + points * 16);
+    json = "{\"generation\":" + String(ResponseCache::dataGeneration());
+    json += ",\"level\":" + renderLevel(config, t);
+    json += ",\"units\":{\"volume\":\"" + String(enumToString(config.volumeUnit)) + "\"";
+    json += ",\"length\":\"" + String(enumToString(config.tankDepthUnit)) + "\"";
+    json += ",\"display_mode\":\"" + String(enumToString(config.displayMode)) + "\"}";
+
+    std::vector<HistoryRow> rows = readLevelHistory(config, window);
+    size_t bucket = (rows.size() + points - 1) / points;
+    if (bucket == 0) bucket = 1;
+    String timestamps, percents;
+    for (size_t start = 0; start < rows.size(); start += bucket) {
+        size_t end = start + bucket < rows.size() ? start + bucket : rows.size();
+        float sum = 0.0f;
+        for (size_t i = start; i < end; ++i) sum += rows[i].percent;
+        if (start > 0) {
+            timestamps += ",";
+            percents += ",";
+        }
+        timestamps += String(rows[end - 1].timestamp);
+        percents += String(sum / (end - start), 1);
+    }
+    json += ",\"history\":{\"timestamp\":[" + timestamps + "],\"percent\":[" + percents + "]}";
+    json += "}";
+    return json;
 }
 
 CustomWebServer::CustomWebServer()
@@ -166,7 +276,7 @@ CustomWebServer::CustomWebServer()
 void CustomWebServer::begin(ConfigManager &configManager, WaterLevelSensor &sensor)
 {
     Logger::info("Initializing web server...");
-    LittleFS.begin();
+    // LittleFS is mounted once in setup(), before the web server starts
     File root = LittleFS.open("/");
     File file = root.openNextFile();
     while(file){
@@ -174,6 +284,9 @@ void CustomWebServer::begin(ConfigManager &configManager, WaterLevelSensor &sens
         file = root.openNextFile();
     }
     
+    // Must be the first handler so it sees every request before the routes do
+    _server.addHandler(new AdmissionControl());
+
     // Initialize event source for logs
     _eventSource = new AsyncEventSource("/logs/stream");
     _eventSource->onConnect([this](AsyncEventSourceClient *client) {
@@ -199,71 +312,130 @@ void CustomWebServer::begin(ConfigManager &configManager, WaterLevelSensor &sens
 void CustomWebServer::setupRoutes(ConfigManager &configManager, WaterLevelSensor &sensor)
 {
     // Helper function to handle settings updates
-    auto handleSettingsUpdate = [&configManager](AsyncWebServerRequest *request, const String& settingName, std::function<void(Config&)> updateConfig, bool rebootRequired) {
+    // The commit runs on the job worker; the form is copied first. Every setting is
+    // applied live by the main loop, so none of them needs a reboot.
+    auto handleSettingsUpdate = [&configManager](AsyncWebServerRequest *request, const String& settingName, std::function<void(Config&, const FormParams&)> updateConfig) {
         Logger::info(settingName + " settings update requested");
-        Config config;
-        configManager.load(config);
-        updateConfig(config);
-        configManager.save(config);
-        Logger::info(settingName + " settings saved" + (rebootRequired ? ", rebooting..." : "."));
-        if (rebootRequired) {
-            request->send(200, "text/html", "<h2>" + settingName + " Settings Saved! Rebooting...</h2>");
-            shouldReboot = true;
-        } else {
-            request->send(200, "text/html", "<h2>" + settingName + " Settings Saved!</h2>");
-        }
+        FormParams form(request);
+        JobId id = submitConfigCommit(configManager, "config", [form, updateConfig](Config& config) {
+            updateConfig(config, form);
+        });
+        sendAccepted(request, id, "text/html", "<h2>" + settingName + " Settings Saved!</h2>");
     };
 
+    // Routes match by prefix in registration order ("/api/level" would also take
+    // "/api/level/history"), so longer paths are registered before their parents
+
+    // --- Water Level History API Endpoint ---
+    // ?count=N for the newest rows, or ?from=&to= (epoch seconds) for a time window; ?tank=<n>
+    _server.on("/api/level/history", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        if (request->hasParam("from") || request->hasParam("to")) {
+            uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), nullptr, 10) : 0;
+            uint32_t to = request->hasParam("to") ? strtoul(request->getParam("to")->value().c_str(), nullptr, 10) : UINT32_MAX;
+            ResponseCache::send(request, "application/json", ResponseCache::historyGeneration(), [&configManager, request, from, to]() {
+                Config config;
+                configManager.load(config);
+                return renderLevelHistory(readLevelHistoryRange(config, from, to, tankParam(request, config)));
+            });
+            return;
+        }
+        int count = 100;
+        if (request->hasParam("count")) {
+            count = request->getParam("count")->value().toInt();
+            if (count <= 0) count = 100;
+        }
+        ResponseCache::send(request, "application/json", ResponseCache::historyGeneration(), [&configManager, request, count]() {
+            Config config;
+            configManager.load(config);
+            return renderLevelHistory(readLevelHistory(config, count, tankParam(request, config)));
+        });
+    });
+
     // --- Water Level API Endpoint ---
-    _server.on("/api/level", HTTP_GET, [&sensor, &configManager](AsyncWebServerRequest *request) {
+    // ?tank=<n> for an additional tank
+    _server.on("/api/level", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        ResponseCache::send(request, "application/json", [&configManager, request]() {
+            Config config;
+            configManager.load(config);
+            uint8_t tank = tankParam(request, config);
+            return renderLevel(config.forTank(tank), TelemetryStore::latest(tank));
+        });
+    });
+
+    // --- Consumption Anomaly API Endpoint ---
+    _server.on("/api/anomaly", HTTP_GET, [](AsyncWebServerRequest *request) {
+        ResponseCache::send(request, "application/json", []() {
+            return AnomalyDetector::toJson();
+        });
+    });
+
+    // --- Demand Forecast API Endpoint ---
+    _server.on("/api/forecast", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        ResponseCache::send(request, "application/json", [request, &configManager]() {
+            Config config;
+            configManager.load(config);
+            uint16_t hours = FORECAST_HORIZON;
+            if (request->hasParam("hours")) {
+                long h = request->getParam("hours")->value().toInt();
+                hours = h < 1 ? 1 : (h > FORECAST_HORIZON ? FORECAST_HORIZON : (uint16_t)h);
+            }
+            Telemetry primary = TelemetryStore::latest();
+            float percent = primary.isError() ? 0.0f : primary.percent;
+            return Forecast::toJson(TimeSync::now(), percent, config.alertLow, hours);
+        });
+    });
+
+    // --- Pump Controller API Endpoints ---
+    _server.on("/api/pump/reset", HTTP_POST, [](AsyncWebServerRequest *request) {
+        PumpController::clearFault();
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
+    });
+    _server.on("/api/pump", HTTP_GET, [](AsyncWebServerRequest *request) {
+        request->send(200, "application/json", PumpController::toJson());
+    });
+
+    // --- Fleet (LAN multicast) API Endpoint ---
+    _server.on("/api/fleet", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        sensor.setTankHeightCm(config.tankDepth);
-        float percent = 0.0f;
-        float tankDepth = config.tankDepth;
-        float distance = lastDistance;
-        float levelCm = tankDepth - distance;
-        if (levelCm < 0) levelCm = 0;
-        float levelIn = levelCm / 2.54f;
-        float distanceIn = distance / 2.54f;
-        float liters = 0.0f;
-        float gallons = 0.0f;
-        if (config.tankShape == "rectangle" && config.tankWidth > 0 && config.tankLength > 0) {
-            liters = (config.tankWidth * config.tankLength * levelCm) / 1000.0f;
-        } else if (config.tankShape == "cylinder" && config.tankDiameter > 0) {
-            float radius = config.tankDiameter / 2.0f;
-            float area = 3.14159265f * radius * radius;
-            liters = (area * levelCm) / 1000.0f;
-        }
-        gallons = liters * 0.264172f;
-        percent = (distance < 0 || tankDepth <= 0) ? 0.0f : ((tankDepth - distance) / tankDepth * 100.0f);
-        if (percent < 0) percent = 0;
-        String displayStr = getDisplayString(config, distance, percent);
-        String json = "{";
-        json += "\"distance_cm\":" + String(distance, 2);
-        json += ",\"distance_in\":" + String(distanceIn, 2);
-        json += ",\"level_cm\":" + String(levelCm, 2);
-        json += ",\"level_in\":" + String(levelIn, 2);
-        json += ",\"percent\":" + String(percent, 1);
-        json += ",\"liters\":" + String(liters, 2);
-        json += ",\"gallons\":" + String(gallons, 2);
-        json += ",\"output_unit\":\"" + config.outputUnit + "\"";
-        json += ",\"tank_shape\":\"" + config.tankShape + "\"";
-        json += ",\"tank_depth\":" + String(config.tankDepth, 2);
-        json += ",\"tank_width\":" + String(config.tankWidth, 2);
-        json += ",\"tank_length\":" + String(config.tankLength, 2);
-        json += ",\"tank_diameter\":" + String(config.tankDiameter, 2);
-        json += ",\"display\":\"" + displayStr + "\"";
-        json += "}";
-        request->send(200, "application/json", json);
+        request->send(200, "application/json", Fleet::toJson(config, config.tankCount));
+    });
+
+    // --- All Tanks API Endpoint ---
+    _server.on("/api/tanks", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        ResponseCache::send(request, "application/json", [&configManager]() {
+            Config config;
+            configManager.load(config);
+            return renderTanks(config);
+        });
+    });
+
+    // --- Dashboard Snapshot API Endpoint ---
+    // ?window=<log rows> (default 100) &points=<max history samples> (default 60)
+    _server.on("/api/snapshot", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        int window = request->hasParam("window") ? request->getParam("window")->value().toInt() : 100;
+        int points = request->hasParam("points") ? request->getParam("points")->value().toInt() : 60;
+        window = constrain(window, 1, 1000);
+        points = constrain(points, 1, 200);
+        ResponseCache::send(request, "application/json", [&configManager, window, points]() {
+            Config config;
+            configManager.load(config);
+            return renderSnapshot(config, window, points);
+        });
+    });
+
+    // --- Runtime Metrics API Endpoint ---
+    _server.on("/api/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+        request->send(200, "application/json", Metrics::toJson());
     });
 
     // --- Volume Unit API Endpoint ---
     _server.on("/api/volumeunit", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
-        Config config;
-        configManager.load(config);
-        String unit = config.volumeUnit.length() ? config.volumeUnit : "L";
-        request->send(200, "application/json", "{\"unit\":\"" + unit + "\"}");
+        ResponseCache::send(request, "application/json", [&configManager]() {
+            Config config;
+            configManager.load(config);
+            return "{\"unit\":\"" + String(enumToString(config.volumeUnit)) + "\"}";
+        });
     });
 
     _server.on("/api/volumeunit", HTTP_POST, [&configManager](AsyncWebServerRequest *request) {
@@ -278,12 +450,12 @@ void CustomWebServer::setupRoutes(ConfigManager &configManager, WaterLevelSensor
                 int quote1 = body.indexOf('"', colon);
                 int quote2 = body.indexOf('"', quote1 + 1);
                 String unit = body.substring(quote1 + 1, quote2);
-                if (unit == "L" || unit == "gal") {
-                    Config config;
-                    configManager.load(config);
-                    config.volumeUnit = unit;
-                    configManager.save(config);
-                    request->send(200, "application/json", "{}\n");
+                VolumeUnit volumeUnit;
+                if (enumFromString(unit, volumeUnit)) {
+                    JobId id = submitConfigCommit(configManager, "config", [volumeUnit](Config& config) {
+                        config.volumeUnit = volumeUnit;
+                    });
+                    sendAccepted(request, id, "application/json", "{}\n");
                     return;
                 }
             }
@@ -292,412 +464,419 @@ void CustomWebServer::setupRoutes(ConfigManager &configManager, WaterLevelSensor
     });
 
     // --- Dashboard with Animated Water Tank ---
-    _server.on("/", HTTP_GET, [&configManager, &sensor](AsyncWebServerRequest *request) {
+    _server.on("/", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
         Logger::info("Home page accessed from IP: " + request->client()->remoteIP().toString());
         Config config;
         configManager.load(config);
-        sensor.setTankHeightCm(config.tankDepth);
-        String html = loadTemplateFile("/dashboard.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Device Home");
-        header.replace("{{TITLE}}", "Device Home");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        float percent = 0.0f;
-        String levelStr = getDisplayString(config, lastDistance, percent);
-        String tankIconClass = (levelStr == "ERROR" || levelStr.startsWith("RANGE ERR")) ? "tank-error" : "";
-        html.replace("{{LEVEL_STR}}", levelStr);
-        html.replace("{{TANK_ICON_CLASS}}", tankIconClass);
-        html.replace("{{OUTPUT_UNIT}}", config.outputUnit);
-        html.replace("{{TANK_DEPTH}}", String(config.tankDepth));
-        html.replace("{{TANK_WIDTH}}", String(config.tankWidth));
-        html.replace("{{TANK_LENGTH}}", String(config.tankLength));
-        html.replace("{{TANK_DIAMETER}}", String(config.tankDiameter));
-        html.replace("{{TANK_SHAPE}}", config.tankShape);
-        html.replace("{{RECT_STYLE}}", config.tankShape == "rectangle" ? "display:block;" : "display:none;");
-        html.replace("{{CYL_STYLE}}", config.tankShape == "cylinder" ? "display:block;" : "display:none;");
-        html.replace("{{DISTANCE}}", String(lastDistance));
-        String displayModeForDashboard = config.outputUnit == "quantity" ? "volume" : config.displayMode;
-        html.replace("{{DISPLAY_MODE}}", displayModeForDashboard);
-        html.replace("{{VOLUME_UNIT}}", config.volumeUnit.length() ? config.volumeUnit : "L");
-        html.replace("{{VOLUME_UNIT_L_SELECTED}}", config.volumeUnit == "L" ? "selected" : "");
-        html.replace("{{VOLUME_UNIT_GAL_SELECTED}}", config.volumeUnit == "gal" ? "selected" : "");
-        request->send(200, "text/html", html);
+        Telemetry t = TelemetryStore::latest();
+        request->send(beginPage(request, 200, "/dashboard.html", "Device Home", [&](TemplateVars& vars) {
+            vars.set("LEVEL_STR", t.displayText);
+            vars.set("TANK_ICON_CLASS", t.isError() ? "tank-error" : "");
+            vars.set("OUTPUT_UNIT", enumToString(config.outputUnit));
+            vars.set("TANK_DEPTH", String(config.tankDepth));
+            vars.set("TANK_WIDTH", String(config.tankWidth));
+            vars.set("TANK_LENGTH", String(config.tankLength));
+            vars.set("TANK_DIAMETER", String(config.tankDiameter));
+            vars.set("TANK_SHAPE", enumToString(config.tankShape));
+            vars.set("RECT_STYLE", config.tankShape == TankShape::RECTANGLE ? "display:block;" : "display:none;");
+            vars.set("CYL_STYLE", config.tankShape == TankShape::CYLINDER ? "display:block;" : "display:none;");
+            vars.set("DISTANCE", String(t.distanceCm));
+            DisplayMode displayModeForDashboard = config.outputUnit == OutputUnit::QUANTITY ? DisplayMode::VOLUME : config.displayMode;
+            vars.set("DISPLAY_MODE", enumToString(displayModeForDashboard));
+            vars.set("VOLUME_UNIT", enumToString(config.volumeUnit));
+            vars.set("VOLUME_UNIT_L_SELECTED", config.volumeUnit == VolumeUnit::LITERS ? "selected" : "");
+            vars.set("VOLUME_UNIT_GAL_SELECTED", config.volumeUnit == VolumeUnit::GALLONS ? "selected" : "");
+        }));
     });
 
     // --- MQTT Settings Page ---
     _server.on("/settings/mqtt", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_mqtt.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "MQTT Setup");
-        header.replace("{{TITLE}}", "MQTT Setup");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{MQTT_SERVER}}", config.mqttServer);
-        html.replace("{{MQTT_PORT}}", String(config.mqttPort));
-        html.replace("{{MQTT_USER}}", config.mqttUser);
-        html.replace("{{MQTT_PASSWORD}}", config.mqttPassword);
-        html.replace("{{MQTT_TOPIC}}", config.mqttTopic);
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/settings_mqtt.html", "MQTT Setup", [&](TemplateVars& vars) {
+            vars.set("MQTT_SERVER", config.mqttServer);
+            vars.set("MQTT_PORT", String(config.mqttPort));
+            vars.set("MQTT_USER", config.mqttUser);
+            vars.set("MQTT_PASSWORD", config.mqttPassword);
+            vars.set("MQTT_TOPIC", config.mqttTopic);
+        }));
     });
 
     _server.on("/settings/mqtt", HTTP_POST, [&](AsyncWebServerRequest *request)
                {
-        handleSettingsUpdate(request, "MQTT", [&](Config& config) {
-            config.mqttServer = request->getParam("mqtt", true)->value();
-            config.mqttPort = request->getParam("port", true)->value().toInt();
-            config.mqttUser = request->getParam("mqttuser", true)->value();
-            config.mqttPassword = request->getParam("mqttpass", true)->value();
-            config.mqttTopic = request->getParam("mqtttopic", true)->value();
-        }, false);
+        handleSettingsUpdate(request, "MQTT", [](Config& config, const FormParams& form) {
+            config.mqttServer = form.get("mqtt");
+            config.mqttPort = form.get("port").toInt();
+            config.mqttUser = form.get("mqttuser");
+            config.mqttPassword = form.get("mqttpass");
+            config.mqttTopic = form.get("mqtttopic");
+        });
     });
 
     // --- Tank Settings Page ---
     _server.on("/settings/tank", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_tank.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Tank Setup");
-        header.replace("{{TITLE}}", "Tank Setup");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        float tankDepth = (config.outputUnit == "in" ? config.tankDepth / 2.54f : config.tankDepth);
-        html.replace("{{TANK_DEPTH}}", String(tankDepth, 1));
-        html.replace("{{TANK_DEPTH_UNIT_CM_SELECTED}}", config.outputUnit == "cm" ? "selected" : "");
-        html.replace("{{TANK_DEPTH_UNIT_IN_SELECTED}}", config.outputUnit == "in" ? "selected" : "");
-        html.replace("{{OUTPUT_UNIT_CM_SELECTED}}", config.outputUnit == "cm" ? "selected" : "");
-        html.replace("{{OUTPUT_UNIT_IN_SELECTED}}", config.outputUnit == "in" ? "selected" : "");
-        html.replace("{{OUTPUT_UNIT_PERCENT_SELECTED}}", config.outputUnit == "percent" ? "selected" : "");
-        html.replace("{{OUTPUT_UNIT_QUANTITY_SELECTED}}", config.outputUnit == "quantity" ? "selected" : "");
-        html.replace("{{TANK_SHAPE_RECTANGLE_SELECTED}}", config.tankShape == "rectangle" ? "selected" : "");
-        html.replace("{{TANK_SHAPE_CYLINDER_SELECTED}}", config.tankShape == "cylinder" ? "selected" : "");
-        html.replace("{{TANK_WIDTH}}", String(config.tankWidth, 1));
-        html.replace("{{TANK_LENGTH}}", String(config.tankLength, 1));
-        html.replace("{{TANK_DIAMETER}}", String(config.tankDiameter, 1));
-        request->send(200, "text/html", html);
+        float tankDepth = (config.outputUnit == OutputUnit::IN ? config.tankDepth / 2.54f : config.tankDepth);
+        request->send(beginPage(request, 200, "/settings_tank.html", "Tank Setup", [&](TemplateVars& vars) {
+            vars.set("TANK_DEPTH", String(tankDepth, 1));
+            vars.set("TANK_DEPTH_UNIT_CM_SELECTED", config.outputUnit == OutputUnit::CM ? "selected" : "");
+            vars.set("TANK_DEPTH_UNIT_IN_SELECTED", config.outputUnit == OutputUnit::IN ? "selected" : "");
+            vars.set("OUTPUT_UNIT_CM_SELECTED", config.outputUnit == OutputUnit::CM ? "selected" : "");
+            vars.set("OUTPUT_UNIT_IN_SELECTED", config.outputUnit == OutputUnit::IN ? "selected" : "");
+            vars.set("OUTPUT_UNIT_PERCENT_SELECTED", config.outputUnit == OutputUnit::PERCENT ? "selected" : "");
+            vars.set("OUTPUT_UNIT_QUANTITY_SELECTED", config.outputUnit == OutputUnit::QUANTITY ? "selected" : "");
+            vars.set("TANK_SHAPE_RECTANGLE_SELECTED", config.tankShape == TankShape::RECTANGLE ? "selected" : "");
+            vars.set("TANK_SHAPE_CYLINDER_SELECTED", config.tankShape == TankShape::CYLINDER ? "selected" : "");
+            vars.set("TANK_WIDTH", String(config.tankWidth, 1));
+            vars.set("TANK_LENGTH", String(config.tankLength, 1));
+            vars.set("TANK_DIAMETER", String(config.tankDiameter, 1));
+            vars.set("EXTRA_TANKS", renderExtraTanks(config));
+        }));
     });
 
     _server.on("/settings/tank", HTTP_POST, [&](AsyncWebServerRequest *request)
                {
-        handleSettingsUpdate(request, "Tank", [&](Config& config) {
-            float depth = request->getParam("tankDepth", true)->value().toFloat();
-            String depthUnit = request->getParam("tankDepthUnit", true)->value();
+        handleSettingsUpdate(request, "Tank", [](Config& config, const FormParams& form) {
+            float depth = form.get("tankDepth").toFloat();
             config.tankDepth = depth;
-            config.tankDepthUnit = depthUnit;
-            if (request->hasParam("outputUnit", true)) {
-                config.outputUnit = request->getParam("outputUnit", true)->value();
+            enumFromString(form.get("tankDepthUnit"), config.tankDepthUnit);
+            if (form.has("outputUnit")) {
+                enumFromString(form.get("outputUnit"), config.outputUnit);
             }
             // New fields
-            config.tankShape = request->getParam("tankShape", true)->value();
-            config.tankWidth = request->hasParam("tankWidth", true) ? request->getParam("tankWidth", true)->value().toFloat() : 0.0f;
-            config.tankLength = request->hasParam("tankLength", true) ? request->getParam("tankLength", true)->value().toFloat() : 0.0f;
-            config.tankDiameter = request->hasParam("tankDiameter", true) ? request->getParam("tankDiameter", true)->value().toFloat() : 0.0f;
+            enumFromString(form.get("tankShape"), config.tankShape);
+            config.tankWidth = form.has("tankWidth") ? form.get("tankWidth").toFloat() : 0.0f;
+            config.tankLength = form.has("tankLength") ? form.get("tankLength").toFloat() : 0.0f;
+            config.tankDiameter = form.has("tankDiameter") ? form.get("tankDiameter").toFloat() : 0.0f;
+            if (form.has("tankCount")) {
+                int count = form.get("tankCount").toInt();
+                config.tankCount = count >= 1 && count <= MAX_TANKS ? count : 1;
+            }
+            for (uint8_t i = 1; i < MAX_TANKS; ++i) {
+                String p = "tank" + String(i) + "_";
+                if (!form.has((p + "trig").c_str())) continue;
+                TankConfig& t = config.extraTanks[i - 1];
+                t.name = form.get((p + "name").c_str());
+                t.triggerPin = form.get((p + "trig").c_str()).toInt();
+                t.echoPin = form.get((p + "echo").c_str()).toInt();
+                t.depth = form.get((p + "depth").c_str()).toFloat();
+                enumFromString(form.get((p + "shape").c_str()), t.shape);
+                t.width = form.get((p + "width").c_str()).toFloat();
+                t.length = form.get((p + "length").c_str()).toFloat();
+                t.diameter = form.get((p + "diameter").c_str()).toFloat();
+            }
             // No direct hardware update here; main loop will apply changes
-        }, false);
+        });
     });
 
     // Add this route in setupRoutes:
     _server.on("/connected", HTTP_GET, [&](AsyncWebServerRequest *request) {
         String ip = WiFi.localIP().toString();
-        String html = loadTemplateFile("/connected.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Connected");
-        header.replace("{{TITLE}}", "Connected");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{IP}}", ip);
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/connected.html", "Connected", [&](TemplateVars& vars) {
+            vars.set("IP", ip);
+        }));
     });
 
     _server.on("/settings/sensor", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_sensor.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Sensor Calibration");
-        header.replace("{{TITLE}}", "Sensor Calibration");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{SENSOR_OFFSET}}", String(config.sensorOffset, 1));
-        html.replace("{{SENSOR_FULL}}", String(config.sensorFull, 1));
-        html.replace("{{SENSOR_READ_INTERVAL}}", String(config.sensorReadInterval));
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/settings_sensor.html", "Sensor Calibration", [&](TemplateVars& vars) {
+            vars.set("SENSOR_OFFSET", String(config.sensorOffset, 1));
+            vars.set("SENSOR_FULL", String(config.sensorFull, 1));
+            vars.set("SENSOR_READ_INTERVAL", String(config.sensorReadInterval));
+            vars.set("ADAPTIVE_SAMPLING_CHECKED", config.adaptiveSampling ? "checked" : "");
+            vars.set("SAMPLE_MIN_INTERVAL", String(config.sampleMinInterval / 1000.0f, 1));
+            vars.set("SAMPLE_MAX_INTERVAL", String(config.sampleMaxInterval / 1000.0f, 1));
+            vars.set("BATTERY_MODE_CHECKED", config.batteryMode ? "checked" : "");
+            vars.set("BATTERY_SLEEP_INTERVAL", String(config.batterySleepInterval));
+            vars.set("BATTERY_UPLOAD_EVERY", String(config.batteryUploadEvery));
+            vars.set("BATTERY_BURST_SAMPLES", String(config.batteryBurstSamples));
+        }));
     });
 
     _server.on("/settings/sensor", HTTP_POST, [&](AsyncWebServerRequest *request)
                {
-        handleSettingsUpdate(request, "Sensor", [&](Config& config) {
-            config.sensorOffset = request->getParam("offset", true)->value().toFloat();
-            config.sensorFull = request->getParam("full", true)->value().toFloat();
-            int interval = request->getParam("sensorReadInterval", true)->value().toInt();
+        handleSettingsUpdate(request, "Sensor", [](Config& config, const FormParams& form) {
+            config.sensorOffset = form.get("offset").toFloat();
+            config.sensorFull = form.get("full").toFloat();
+            int interval = form.get("sensorReadInterval").toInt();
             config.sensorReadInterval = interval < 1 ? 1 : interval;
+            config.adaptiveSampling = form.has("adaptiveSampling");
+            if (form.has("sampleMinInterval") && form.has("sampleMaxInterval")) {
+                int minInterval = (int)(form.get("sampleMinInterval").toFloat() * 1000.0f);
+                int maxInterval = (int)(form.get("sampleMaxInterval").toFloat() * 1000.0f);
+                config.sampleMinInterval = minInterval < 200 ? 200 : minInterval;
+                config.sampleMaxInterval = maxInterval < config.sampleMinInterval ? config.sampleMinInterval : maxInterval;
+            }
+            config.batteryMode = form.has("batteryMode");
+            if (form.has("batterySleepInterval")) {
+                int sleepInterval = form.get("batterySleepInterval").toInt();
+                config.batterySleepInterval = sleepInterval < 10 ? 10 : sleepInterval;
+            }
+            if (form.has("batteryUploadEvery")) {
+                int uploadEvery = form.get("batteryUploadEvery").toInt();
+                config.batteryUploadEvery = uploadEvery < 1 ? 1 : uploadEvery;
+            }
+            if (form.has("batteryBurstSamples")) {
+                int burst = form.get("batteryBurstSamples").toInt();
+                config.batteryBurstSamples = constrain(burst, 1, 15);
+            }
             // No direct hardware update here; main loop will apply changes
-        }, false);
+        });
     });
 
     _server.on("/settings/display", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_display.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Display Settings");
-        header.replace("{{TITLE}}", "Display Settings");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{BRIGHTNESS}}", String(config.displayBrightness));
-        html.replace("{{LEVEL_SELECTED}}", config.displayMode == "level" ? "selected" : "");
-        html.replace("{{PERCENT_SELECTED}}", config.displayMode == "percent" ? "selected" : "");
-        html.replace("{{DISTANCE_SELECTED}}", config.displayMode == "distance" ? "selected" : "");
-        html.replace("{{VOLUME_SELECTED}}", config.displayMode == "volume" ? "selected" : "");
-        html.replace("{{STATUS_SELECTED}}", config.displayMode == "status" ? "selected" : "");
-        html.replace("{{TEXT_SELECTED}}", config.displayMode == "text" ? "selected" : "");
-        html.replace("{{FC16_SELECTED}}", config.displayHardwareType == "FC16_HW" ? "selected" : "");
-        html.replace("{{GENERIC_SELECTED}}", config.displayHardwareType == "GENERIC_HW" ? "selected" : "");
-        html.replace("{{PAROLA_SELECTED}}", config.displayHardwareType == "PAROLA_HW" ? "selected" : "");
-        html.replace("{{ICSTATION_SELECTED}}", config.displayHardwareType == "ICSTATION_HW" ? "selected" : "");
-        html.replace("{{SCROLL_CHECKED}}", config.displayScrollEnabled ? "checked" : "");
-        html.replace("{{DISPLAY_TYPE_MATRIX_SELECTED}}", config.displayType == "matrix" ? "selected" : "");
-        html.replace("{{DISPLAY_TYPE_SEVENSEGMENT_SELECTED}}", config.displayType == "sevensegment" ? "selected" : "");
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/settings_display.html", "Display Settings", [&](TemplateVars& vars) {
+            vars.set("BRIGHTNESS", String(config.displayBrightness));
+            vars.set("LEVEL_SELECTED", config.displayMode == DisplayMode::LEVEL ? "selected" : "");
+            vars.set("PERCENT_SELECTED", config.displayMode == DisplayMode::PERCENT ? "selected" : "");
+            vars.set("DISTANCE_SELECTED", config.displayMode == DisplayMode::DISTANCE ? "selected" : "");
+            vars.set("VOLUME_SELECTED", config.displayMode == DisplayMode::VOLUME ? "selected" : "");
+            vars.set("STATUS_SELECTED", config.displayMode == DisplayMode::STATUS ? "selected" : "");
+            vars.set("TEXT_SELECTED", config.displayMode == DisplayMode::TEXT ? "selected" : "");
+            vars.set("FC16_SELECTED", config.displayHardwareType == DisplayHardwareType::FC16_HW ? "selected" : "");
+            vars.set("GENERIC_SELECTED", config.displayHardwareType == DisplayHardwareType::GENERIC_HW ? "selected" : "");
+            vars.set("PAROLA_SELECTED", config.displayHardwareType == DisplayHardwareType::PAROLA_HW ? "selected" : "");
+            vars.set("ICSTATION_SELECTED", config.displayHardwareType == DisplayHardwareType::ICSTATION_HW ? "selected" : "");
+            vars.set("SCROLL_CHECKED", config.displayScrollEnabled ? "checked" : "");
+            vars.set("DISPLAY_TYPE_MATRIX_SELECTED", config.displayType == DisplayType::MATRIX ? "selected" : "");
+            vars.set("DISPLAY_TYPE_SEVENSEGMENT_SELECTED", config.displayType == DisplayType::SEVEN_SEGMENT ? "selected" : "");
+        }));
     });
 
     _server.on("/settings/display", HTTP_POST, [&](AsyncWebServerRequest *request)
                {
-        handleSettingsUpdate(request, "Display", [&](Config& config) {
-            config.displayBrightness = request->getParam("brightness", true)->value().toInt();
-            config.displayMode = request->getParam("mode", true)->value();
-            config.displayHardwareType = request->getParam("hardwareType", true)->value();
-            config.displayScrollEnabled = request->hasParam("scroll", true);
-            if (request->hasParam("displayType", true)) {
-                config.displayType = request->getParam("displayType", true)->value();
+        handleSettingsUpdate(request, "Display", [](Config& config, const FormParams& form) {
+            config.displayBrightness = form.get("brightness").toInt();
+            enumFromString(form.get("mode"), config.displayMode);
+            enumFromString(form.get("hardwareType"), config.displayHardwareType);
+            config.displayScrollEnabled = form.has("scroll");
+            if (form.has("displayType")) {
+                enumFromString(form.get("displayType"), config.displayType);
             }
-            if (request->hasParam("volumeUnit", true)) {
-                config.volumeUnit = request->getParam("volumeUnit", true)->value();
+            if (form.has("volumeUnit")) {
+                enumFromString(form.get("volumeUnit"), config.volumeUnit);
             }
-            Serial.printf("[DEBUG] Saving displayScrollEnabled: %d\n", config.displayScrollEnabled);
             // No direct hardware update here; main loop will apply changes
-        }, false);
+        });
     });
 
     _server.on("/settings/network", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_network.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Network Settings");
-        header.replace("{{TITLE}}", "Network Settings");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{STATIC_IP}}", config.staticIp);
-        html.replace("{{GATEWAY}}", config.gateway);
-        html.replace("{{SUBNET}}", config.subnet);
-        html.replace("{{HOSTNAME}}", config.hostname);
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/settings_network.html", "Network Settings", [&](TemplateVars& vars) {
+            vars.set("STATIC_IP", config.staticIp);
+            vars.set("GATEWAY", config.gateway);
+            vars.set("SUBNET", config.subnet);
+            vars.set("HOSTNAME", config.hostname);
+            vars.set("WIFI_SCAN_MAX_AGE", String(config.wifiScanMaxAge));
+            vars.set("MODBUS_ENABLED_CHECKED", config.modbusEnabled ? "checked" : "");
+            vars.set("FLEET_BROADCAST_CHECKED", config.fleetBroadcast ? "checked" : "");
+            vars.set("FLEET_INTERVAL", String(config.fleetInterval));
+            vars.set("FLEET_HUB_CHECKED", config.fleetHub ? "checked" : "");
+        }));
     });
 
     _server.on("/settings/network", HTTP_POST, [&](AsyncWebServerRequest *request){
-        handleSettingsUpdate(request, "Network", [&](Config& config) {
-            config.staticIp = request->getParam("staticip", true)->value();
-            config.gateway = request->getParam("gateway", true)->value();
-            config.subnet = request->getParam("subnet", true)->value();
-            config.hostname = request->getParam("hostname", true)->value();
-            // Network changes require reboot
-        }, true);
+        handleSettingsUpdate(request, "Network", [](Config& config, const FormParams& form) {
+            config.staticIp = form.get("staticip");
+            config.gateway = form.get("gateway");
+            config.subnet = form.get("subnet");
+            config.hostname = form.get("hostname");
+            if (form.has("wifiScanMaxAge")) {
+                int maxAge = form.get("wifiScanMaxAge").toInt();
+                config.wifiScanMaxAge = maxAge < 5 ? 5 : maxAge;
+            }
+            config.modbusEnabled = form.has("modbusEnabled");
+            config.fleetBroadcast = form.has("fleetBroadcast");
+            config.fleetHub = form.has("fleetHub");
+            if (form.has("fleetInterval")) {
+                int interval = form.get("fleetInterval").toInt();
+                config.fleetInterval = interval < 1 ? 1 : interval;
+            }
+            // Applied live: the main loop re-associates with the new addressing
+        });
     });
 
     _server.on("/settings/alerts", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_alerts.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Alert Settings");
-        header.replace("{{TITLE}}", "Alert Settings");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{ALERT_LOW}}", String(config.alertLow));
-        html.replace("{{ALERT_HIGH}}", String(config.alertHigh));
-        html.replace("{{ALERT_METHOD_MQTT_SELECTED}}", config.alertMethod == "mqtt" ? "selected" : "");
-        html.replace("{{ALERT_METHOD_BUZZER_SELECTED}}", config.alertMethod == "buzzer" ? "selected" : "");
-        html.replace("{{ALERT_METHOD_LED_SELECTED}}", config.alertMethod == "led" ? "selected" : "");
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/settings_alerts.html", "Alert Settings", [&](TemplateVars& vars) {
+            vars.set("ALERT_LOW", String(config.alertLow));
+            vars.set("ALERT_HIGH", String(config.alertHigh));
+            vars.set("ANOMALY_SIGMA", String(config.anomalySigma, 1));
+            vars.set("ALERT_METHOD_MQTT_SELECTED", config.alertMethod == AlertMethod::MQTT ? "selected" : "");
+            vars.set("ALERT_METHOD_BUZZER_SELECTED", config.alertMethod == AlertMethod::BUZZER ? "selected" : "");
+            vars.set("ALERT_METHOD_LED_SELECTED", config.alertMethod == AlertMethod::LED ? "selected" : "");
+        }));
     });
 
     _server.on("/settings/alerts", HTTP_POST, [&](AsyncWebServerRequest *request){
-        handleSettingsUpdate(request, "Alert", [&](Config& config) {
-            config.alertLow = request->getParam("low", true)->value().toInt();
-            config.alertHigh = request->getParam("high", true)->value().toInt();
-            config.alertMethod = request->getParam("alertmethod", true)->value();
+        handleSettingsUpdate(request, "Alert", [](Config& config, const FormParams& form) {
+            config.alertLow = form.get("low").toInt();
+            config.alertHigh = form.get("high").toInt();
+            enumFromString(form.get("alertmethod"), config.alertMethod);
+            if (form.has("anomalySigma")) {
+                float sigma = form.get("anomalySigma").toFloat();
+                config.anomalySigma = sigma < 0 ? 0.0f : sigma;
+            }
             // No direct hardware update here; main loop will apply changes
-        }, false);
+        });
     });
 
-    _server.on("/settings/device", HTTP_GET, [&](AsyncWebServerRequest *request) {
+    _server.on("/settings/pump", HTTP_GET, [&](AsyncWebServerRequest *request) {
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_device.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Device Info / Reset");
-        header.replace("{{TITLE}}", "Device Info / Reset");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{DEVICE_NAME}}", config.deviceName);
-        html.replace("{{OTA_ON_SELECTED}}", config.otaEnabled == "on" ? "selected" : "");
-        html.replace("{{OTA_OFF_SELECTED}}", config.otaEnabled == "off" ? "selected" : "");
-        request->send(200, "text/html", html);
-    });
-
-    _server.on("/settings/device", HTTP_POST, [&](AsyncWebServerRequest *request)
-               {
-        handleSettingsUpdate(request, "Device", [&](Config& config) {
-            if (request->hasParam("deviceName", true)) {
-                config.deviceName = request->getParam("deviceName", true)->value();
+        request->send(beginPage(request, 200, "/settings_pump.html", "Pump Control", [&](TemplateVars& vars) {
+            vars.set("PUMP_ENABLED_CHECKED", config.pumpEnabled ? "checked" : "");
+            vars.set("PUMP_PIN", String(config.pumpPin));
+            vars.set("PUMP_ACTIVE_LOW_CHECKED", config.pumpActiveLow ? "checked" : "");
+            vars.set("PUMP_START", String(config.pumpStartPercent));
+            vars.set("PUMP_STOP", String(config.pumpStopPercent));
+            vars.set("PUMP_MIN_ON", String(config.pumpMinOnTime));
+            vars.set("PUMP_MIN_OFF", String(config.pumpMinOffTime));
+            vars.set("PUMP_DRY_RUN_TIME", String(config.pumpDryRunTime));
+            vars.set("PUMP_DRY_RUN_RISE", String(config.pumpDryRunRise, 1));
+            vars.set("PUMP_MAX_RUN", String(config.pumpMaxRunTime));
+        }));
+    });
+
+    _server.on("/settings/pump", HTTP_POST, [&](AsyncWebServerRequest *request){
+        if (request->hasParam("pumpPin", true)) {
+            Config current;
+            configManager.load(current);
+            const char* problem = PumpController::pinProblem(current, request->getParam("pumpPin", true)->value().toInt());
+            if (problem) {
+                request->send(400, "text/html", "<span style='color:red;'>" + String(problem) + ".</span>");
+                return;
+            }
+        }
+        handleSettingsUpdate(request, "Pump", [](Config& config, const FormParams& form) {
+            config.pumpEnabled = form.has("pumpEnabled");
+            config.pumpActiveLow = form.has("pumpActiveLow");
+            if (form.has("pumpPin")) config.pumpPin = form.get("pumpPin").toInt();
+            if (form.has("pumpStart") && form.has("pumpStop")) {
+                config.pumpStartPercent = constrain((int)form.get("pumpStart").toInt(), 0, 99);
+                int stop = constrain((int)form.get("pumpStop").toInt(), 0, 100);
+                config.pumpStopPercent = stop <= config.pumpStartPercent ? config.pumpStartPercent + 1 : stop;
+            }
+            // Times in seconds (max run in minutes); 0 disables the dry-run and max-run checks
+            const char* times[] = {"pumpMinOn", "pumpMinOff", "pumpDryRunTime", "pumpMaxRun"};
+            int* fields[] = {&config.pumpMinOnTime, &config.pumpMinOffTime, &config.pumpDryRunTime, &config.pumpMaxRunTime};
+            for (uint8_t i = 0; i < 4; ++i) {
+                if (!form.has(times[i])) continue;
+                int value = form.get(times[i]).toInt();
+                *fields[i] = value < 0 ? 0 : value;
             }
-            if (request->hasParam("otaEnabled", true)) {
-                config.otaEnabled = request->getParam("otaEnabled", true)->value();
+            if (form.has("pumpDryRunRise")) {
+                float rise = form.get("pumpDryRunRise").toFloat();
+                config.pumpDryRunRise = rise < 0 ? 0.0f : rise;
             }
             // No direct hardware update here; main loop will apply changes
-        }, false);
+        });
     });
 
+    // Ahead of /settings/device, which would otherwise take this POST as well
     _server.on("/settings/device/reset", HTTP_POST, [&](AsyncWebServerRequest *request) {
         Logger::info("Factory reset requested");
-        Config config;
-        configManager.load(config);
-        // Reset all values to defaults
-        config.wifiSsid = "";
-        config.wifiPassword = "";
-        config.mqttServer = "";
-        config.mqttPort = 1883;
-        config.mqttUser = "";
-        config.mqttPassword = "";
-        config.mqttTopic = "home/waterlevel";
-        config.tankDepth = 100.0f;
-        config.outputUnit = "cm";
-        config.sensorOffset = 0.0f;
-        config.sensorFull = 0.0f;
-        config.displayBrightness = 8;
-        config.displayMode = "level";
-        config.staticIp = "";
-        config.gateway = "";
-        config.subnet = "";
-        config.hostname = "";
-        config.alertLow = 0;
-        config.alertHigh = 100;
-        config.alertMethod = "mqtt";
-        config.deviceName = "";
-        config.otaEnabled = "off";
-        Logger::info("Resetting all settings to defaults");
-        if (configManager.save(config)) {
+        JobId id = JobQueue::submit("factory_reset", [&configManager]() {
+            Logger::info("Resetting all settings to defaults");
+            if (!configManager.save(Config())) {
+                Logger::error("Factory reset failed!");
+                return false;
+            }
             configManager.reset();
             Logger::info("Factory reset completed successfully");
-            String html = loadTemplateFile("/reset_success.html");
-            String header = loadTemplateFile("/header.html");
-            String footer = loadTemplateFile("/footer.html");
-            html.replace("{{TITLE}}", "Factory Reset Complete");
-            header.replace("{{TITLE}}", "Factory Reset Complete");
-            html.replace("{{HEADER}}", header);
-            html.replace("{{FOOTER}}", footer);
-            request->send(200, "text/html", html);
-            delay(2000);
-            ESP.restart();
-        } else {
-            Logger::error("Factory reset failed!");
-            String html = loadTemplateFile("/reset_failed.html");
-            String header = loadTemplateFile("/header.html");
-            String footer = loadTemplateFile("/footer.html");
-            html.replace("{{TITLE}}", "Reset Failed");
-            header.replace("{{TITLE}}", "Reset Failed");
-            html.replace("{{HEADER}}", header);
-            html.replace("{{FOOTER}}", footer);
-            request->send(500, "text/html", html);
+            return true;
+        });
+        if (id == JobQueue::INVALID_JOB) {
+            request->send(beginPage(request, 503, "/reset_failed.html", "Reset Failed"));
+            return;
         }
+        submitReboot(configManager);
+        AsyncWebServerResponse *response = beginPage(request, 202, "/reset_success.html", "Factory Reset Complete");
+        response->addHeader("Location", "/api/jobs/" + String(id));
+        request->send(response);
+    });
+
+    _server.on("/settings/device", HTTP_GET, [&](AsyncWebServerRequest *request) {
+        Config config;
+        configManager.load(config);
+        request->send(beginPage(request, 200, "/settings_device.html", "Device Info / Reset", [&](TemplateVars& vars) {
+            vars.set("DEVICE_NAME", config.deviceName);
+            vars.set("OTA_ON_SELECTED", config.otaEnabled ? "selected" : "");
+            vars.set("OTA_OFF_SELECTED", config.otaEnabled ? "" : "selected");
+        }));
+    });
+
+    _server.on("/settings/device", HTTP_POST, [&](AsyncWebServerRequest *request)
+               {
+        handleSettingsUpdate(request, "Device", [](Config& config, const FormParams& form) {
+            if (form.has("deviceName")) {
+                config.deviceName = form.get("deviceName");
+            }
+            if (form.has("otaEnabled")) {
+                config.otaEnabled = form.get("otaEnabled") == "on";
+            }
+            // No direct hardware update here; main loop will apply changes
+        });
     });
 
     // --- WiFi Settings Page ---
     _server.on("/settings/wifi", HTTP_GET, [&](AsyncWebServerRequest *request){
         Config config;
         configManager.load(config);
-        String html = loadTemplateFile("/settings_wifi.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "WiFi Setup");
-        header.replace("{{TITLE}}", "WiFi Setup");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        html.replace("{{WIFI_SSID}}", config.wifiSsid);
-        html.replace("{{WIFI_PASSWORD}}", config.wifiPassword);
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/settings_wifi.html", "WiFi Setup", [&](TemplateVars& vars) {
+            vars.set("WIFI_SSID", config.wifiSsid);
+            vars.set("WIFI_PASSWORD", config.wifiPassword);
+        }));
     });
 
     // WiFi POST handler for AJAX
     _server.on("/settings/wifi", HTTP_POST, [&](AsyncWebServerRequest *request) {
-        String debugMsg;
         if (!request->hasParam("ssid", true) || !request->hasParam("wifipass", true)) {
-            debugMsg = "[DEBUG] Missing ssid or wifipass in POST";
-            Serial.println(debugMsg);
             request->send(400, "text/html", "<span style='color:red;'>Missing required WiFi parameters.</span>");
             return;
         }
-        Config config;
-        if (!configManager.load(config)) {
-            debugMsg = "[DEBUG] Failed to load config in WiFi POST";
-            Serial.println(debugMsg);
-            request->send(500, "text/html", "<span style='color:red;'>Failed to load configuration.</span>");
-            return;
-        }
         String ssid = request->getParam("ssid", true)->value();
         String wifipass = request->getParam("wifipass", true)->value();
-        debugMsg = "[DEBUG] Received ssid: " + ssid + ", wifipass: " + wifipass;
-        Serial.println(debugMsg);
-        config.wifiSsid = ssid;
-        config.wifiPassword = wifipass;
-        if (!configManager.save(config)) {
-            debugMsg = "[DEBUG] Failed to save config in WiFi POST";
-            Serial.println(debugMsg);
-            request->send(500, "text/html", "<span style='color:red;'>Failed to save configuration.</span>");
-            return;
-        }
-        debugMsg = "[DEBUG] WiFi settings saved, rebooting...";
-        Serial.println(debugMsg);
-        request->send(200, "text/html", "<span style='color:green;'>WiFi settings saved! Rebooting...</span>");
-        delay(1000);
-        ESP.restart();
+        JobId id = submitConfigCommit(configManager, "config", [ssid, wifipass](Config& config) {
+            config.wifiSsid = ssid;
+            config.wifiPassword = wifipass;
+        });
+        // The main loop re-associates with the new network once the commit lands
+        sendAccepted(request, id, "text/html", "<span style='color:green;'>WiFi settings saved! Reconnecting...</span>");
     });
 
     // WiFi scan endpoint
-    _server.on("/scan/wifi", HTTP_GET, [](AsyncWebServerRequest *request) {
-        int n = WiFi.scanNetworks();
-        String json = "[";
-        for (int i = 0; i < n; ++i) {
-            if (i > 0) json += ",";
-            json += "{\"ssid\":\"" + WiFi.SSID(i) + "\",\"rssi\":" + String(WiFi.RSSI(i)) + "}";
-        }
-        json += "]";
-        request->send(200, "application/json", json);
+    // Never scans inline: serves the cached result and queues a background rescan when stale.
+    // 202 means no result exists yet; poll again until "scanning" is false.
+    _server.on("/scan/wifi", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        Config config;
+        configManager.load(config);
+        unsigned long maxAgeMs = (unsigned long)config.wifiScanMaxAge * 1000UL;
+        if (request->hasParam("refresh")) maxAgeMs = 0;
+        bool cached = WiFiScanCache::request(maxAgeMs);
+        request->send(cached ? 200 : 202, "application/json", WiFiScanCache::toJson());
     });
 
-    // --- Logs Page ---
-    _server.on("/logs", HTTP_GET, [&](AsyncWebServerRequest *request) {
-        String html = loadTemplateFile("/logs.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Device Logs");
-        header.replace("{{TITLE}}", "Device Logs");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        request->send(200, "text/html", html);
+    // Level history as CSV
+    _server.on("/logs/level.csv", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        Config config;
+        configManager.load(config);
+        request->send(beginHistoryExport(request, config, HistoryStore::seek(0), ExportOptions()));
+    });
+
+    // Add clear logs endpoint
+    _server.on("/logs/clear", HTTP_POST, [&](AsyncWebServerRequest *request) {
+        JobId id = JobQueue::submit("log_clear", []() {
+            Logger::clearLogs();
+            return true;
+        });
+        sendAccepted(request, id, "text/plain", "");
     });
 
     // Serve the log file for download or viewing
@@ -705,112 +884,107 @@ void CustomWebServer::setupRoutes(ConfigManager &configManager, WaterLevelSensor
         request->send(LittleFS, "/logs.txt", "text/plain");
     });
 
-    // Add clear logs endpoint
-    _server.on("/logs/clear", HTTP_POST, [&](AsyncWebServerRequest *request) {
-        Logger::clearLogs();
-        request->send(200);
+    // --- Logs Page ---
+    _server.on("/logs", HTTP_GET, [&](AsyncWebServerRequest *request) {
+        request->send(beginPage(request, 200, "/logs.html", "Device Logs"));
+    });
+
+    // --- Deferred job status: /api/jobs lists recent jobs, /api/jobs/<id> reports one ---
+    _server.on("/api/jobs", HTTP_GET, [](AsyncWebServerRequest *request) {
+        String url = request->url();
+        int slash = url.indexOf('/', 5); // after "/api/"
+        slash = url.indexOf('/', slash + 1);
+        if (slash < 0 || slash == (int)url.length() - 1) {
+            request->send(200, "application/json", JobQueue::listJson());
+            return;
+        }
+        String json = JobQueue::toJson((JobId)url.substring(slash + 1).toInt());
+        if (json.isEmpty()) {
+            request->send(404, "application/json", "{\"error\":\"Unknown job\"}");
+            return;
+        }
+        request->send(200, "application/json", json);
+    });
+
+    // --- Fleet Page ---
+    _server.on("/fleet", HTTP_GET, [&](AsyncWebServerRequest *request) {
+        request->send(beginPage(request, 200, "/fleet.html", "Fleet"));
     });
 
     // --- Help Page ---
     _server.on("/help", HTTP_GET, [&](AsyncWebServerRequest *request) {
-        String html = loadTemplateFile("/help.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "Connection Help");
-        header.replace("{{TITLE}}", "Connection Help");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        request->send(200, "text/html", html);
+        request->send(beginPage(request, 200, "/help.html", "Connection Help"));
     });
 
     // --- API endpoint for live brightness change ---
+    // Applied to the display right away; the NVS write is coalesced until the slider settles
     _server.on("/api/display/brightness", HTTP_POST, [&](AsyncWebServerRequest *request){
         if (request->hasParam("value", true)) {
             int value = request->getParam("value", true)->value().toInt();
             value = std::max(0, std::min(15, value));
-            Config config;
-            configManager.load(config);
-            config.displayBrightness = value;
-            configManager.save(config);
+            configManager.update([value](Config& config) {
+                config.displayBrightness = value;
+            });
             request->send(200, "application/json", "{}\n");
         } else {
             request->send(400, "application/json", "{\"error\":\"Missing value\"}\n");
         }
     });
 
-    // --- Water Level History API Endpoint ---
-    _server.on("/api/level/history", HTTP_GET, [](AsyncWebServerRequest *request) {
-        int count = 100;
-        if (request->hasParam("count")) {
-            count = request->getParam("count")->value().toInt();
-            if (count <= 0) count = 100;
-        }
-        File f = LittleFS.open("/level_log.csv", "r");
-        if (!f) {
-            request->send(200, "application/json", "[]");
-            return;
+    // --- History export: ?from=&to= (epoch seconds), fields=a,b, format=csv|ndjson, gzip=0|1,
+    // cursor=&skip= to resume, tank=<n>. Gzip follows Accept-Encoding unless gzip= is given. ---
+    _server.on("/api/history/export", HTTP_GET, [&configManager](AsyncWebServerRequest *request) {
+        Config config;
+        configManager.load(config);
+        ExportOptions options;
+        options.tank = tankParam(request, config);
+        if (request->hasParam("format")) {
+            String format = request->getParam("format")->value();
+            if (format == "ndjson") {
+                options.format = ExportFormat::NDJSON;
+            } else if (format != "csv") {
+                request->send(400, "application/json", "{\"error\":\"format must be csv or ndjson\"}");
+                return;
+            }
         }
-        // Skip header
-        String header = f.readStringUntil('\n');
-        std::vector<String> lines;
-        while (f.available()) {
-            String line = f.readStringUntil('\n');
-            if (line.length() > 0) {
-                lines.push_back(line);
-                if ((int)lines.size() > count) lines.erase(lines.begin());
+        if (request->hasParam("fields")) {
+            options.fields = HistoryExport::parseFields(request->getParam("fields")->value());
+            if (options.fields == 0) {
+                request->send(400, "application/json", "{\"error\":\"Unknown field\"}");
+                return;
             }
         }
-        f.close();
-        if (lines.empty()) {
-            request->send(200, "application/json", "[]");
-            return;
+        if (request->hasParam("to")) {
+            options.to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
         }
-        String json = "[";
-        for (size_t i = 0; i < lines.size(); ++i) {
-            String l = lines[i];
-            int idx = 0;
-            unsigned long ts = l.substring(0, idx = l.indexOf(',')).toInt();
-            l = l.substring(idx + 1);
-            float distance = l.substring(0, idx = l.indexOf(',')).toFloat();
-            l = l.substring(idx + 1);
-            float percent = l.substring(0, idx = l.indexOf(',')).toFloat();
-            l = l.substring(idx + 1);
-            float levelCm = l.substring(0, idx = l.indexOf(',')).toFloat();
-            l = l.substring(idx + 1);
-            float levelIn = l.substring(0, idx = l.indexOf(',')).toFloat();
-            l = l.substring(idx + 1);
-            float liters = l.substring(0, idx = l.indexOf(',')).toFloat();
-            l = l.substring(idx + 1);
-            float gallons = l.toFloat();
-            if (i > 0) json += ",";
-            json += "{";
-            json += "\"timestamp\":" + String(ts);
-            json += ",\"distance_cm\":" + String(distance, 2);
-            json += ",\"percent\":" + String(percent, 1);
-            json += ",\"level_cm\":" + String(levelCm, 2);
-            json += ",\"level_in\":" + String(levelIn, 2);
-            json += ",\"liters\":" + String(liters, 2);
-            json += ",\"gallons\":" + String(gallons, 2);
-            json += "}";
+        if (request->hasParam("gzip")) {
+            options.gzip = request->getParam("gzip")->value() != "0";
+        } else if (request->hasHeader("Accept-Encoding")) {
+            options.gzip = request->getHeader("Accept-Encoding")->value().indexOf("gzip") >= 0;
         }
-        json += "]";
-        request->send(200, "application/json", json);
+
+        HistoryCursor start;
+        if (request->hasParam("cursor")) {
+            if (!HistoryExport::parseCursor(request->getParam("cursor")->value(), start)) {
+                request->send(400, "application/json", "{\"error\":\"Invalid cursor\"}");
+                return;
+            }
+            options.header = false;
+        } else {
+            uint32_t from = request->hasParam("from") ? strtoul(request->getParam("from")->value().c_str(), nullptr, 10) : 0;
+            start = HistoryStore::seek(from, options.tank);
+        }
+        if (request->hasParam("skip")) {
+            HistoryStore::skip(start, strtoul(request->getParam("skip")->value().c_str(), nullptr, 10), options.tank);
+            options.header = false;
+        }
+
+        request->send(beginHistoryExport(request, config, start, options));
     });
 
     // 404 Not Found handler (must be last)
     _server.onNotFound([](AsyncWebServerRequest *request) {
-        String html = loadTemplateFile("/404.html");
-        String header = loadTemplateFile("/header.html");
-        String footer = loadTemplateFile("/footer.html");
-        html.replace("{{TITLE}}", "404 - Page Not Found");
-        header.replace("{{TITLE}}", "404 - Page Not Found");
-        html.replace("{{HEADER}}", header);
-        html.replace("{{FOOTER}}", footer);
-        request->send(404, "text/html", html);
-    });
-
-    _server.on("/logs/level.csv", HTTP_GET, [](AsyncWebServerRequest *request) {
-        request->send(LittleFS, "/level_log.csv", "text/csv");
+        request->send(beginPage(request, 404, "/404.html", "404 - Page Not Found"));
     });
 }
 
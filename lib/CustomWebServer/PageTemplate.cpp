@@ -0,0 +1,197 @@
+#include "PageTemplate.h"
+#include <LittleFS.h>
+#include <memory>
+#include "Metrics.h"
+
+TemplateVars::TemplateVars(ResponseArena* arena) : _arena(arena) {}
+
+void TemplateVars::set(const char* key, const char* value) {
+    size_t length = strlen(value);
+    char* copy = _count < MAX_VARS ? _arena->alloc(length + 1) : nullptr;
+    if (!copy) {
+        _failed = true;
+        return;
+    }
+    memcpy(copy, value, length + 1);
+    _vars[_count].key = key;
+    _vars[_count].value = copy;
+    _vars[_count].length = (uint16_t)length;
+    _count++;
+}
+
+void TemplateVars::set(const char* key, const String& value) {
+    set(key, value.c_str());
+}
+
+const char* TemplateVars::find(const char* key, size_t keyLength, size_t& valueLength) const {
+    for (uint8_t i = 0; i < _count; ++i) {
+        const Var& v = _vars[i];
+        if (strncmp(v.key, key, keyLength) == 0 && v.key[keyLength] == '\0') {
+            valueLength = v.length;
+            return v.value;
+        }
+    }
+    return nullptr;
+}
+
+namespace {
+    const uint8_t MAX_KEY = 48;
+
+    bool isKeyChar(char c) {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    // Copies one template file into the arena, substituting {{KEY}}s as they stream
+    // past. A placeholder may straddle read chunks, so matching is a small state
+    // machine over single characters; anything that turns out not to be a
+    // placeholder is written back out unchanged.
+    class TemplateRenderer {
+    public:
+        TemplateRenderer(ResponseArena* arena, const TemplateVars& vars, const char* title, bool nested)
+            : _arena(arena), _vars(vars), _title(title), _nested(nested) {}
+
+        bool render(const char* path) {
+            File f = LittleFS.open(path, "r");
+            if (!f) return false;
+            uint8_t chunk[256];
+            size_t n;
+            while ((n = f.read(chunk, sizeof(chunk))) > 0) {
+                for (size_t i = 0; i < n; ++i) feed((char)chunk[i]);
+            }
+            f.close();
+            abandon(); // unterminated placeholder at end of file
+            flush();
+            return true;
+        }
+
+    private:
+        enum class State : uint8_t { TEXT, OPEN, KEY, CLOSE };
+
+        void feed(char c) {
+            switch (_state) {
+                case State::TEXT:
+                    if (c == '{') _state = State::OPEN;
+                    else emit(c);
+                    break;
+                case State::OPEN:
+                    if (c == '{') {
+                        _state = State::KEY;
+                        _keyLength = 0;
+                    } else {
+                        abandon();
+                        feed(c);
+                    }
+                    break;
+                case State::KEY:
+                    if (c == '}' && _keyLength > 0) {
+                        _state = State::CLOSE;
+                    } else if (c == '{' && _keyLength == 0) {
+                        emit('{'); // "{{{KEY}}" is a brace before a placeholder
+                    } else if (isKeyChar(c) && _keyLength < MAX_KEY) {
+                        _key[_keyLength++] = c;
+                    } else {
+                        abandon();
+                        feed(c);
+                    }
+                    break;
+                case State::CLOSE:
+                    if (c == '}') {
+                        _state = State::TEXT;
+                        substitute();
+                    } else {
+                        abandon();
+                        feed(c);
+                    }
+                    break;
+            }
+        }
+
+        // Writes out the partial placeholder matched so far
+        void abandon() {
+            if (_state == State::TEXT) return;
+            emit('{');
+            if (_state != State::OPEN) {
+                emit('{');
+                for (uint8_t i = 0; i < _keyLength; ++i) emit(_key[i]);
+                if (_state == State::CLOSE) emit('}');
+            }
+            _state = State::TEXT;
+        }
+
+        void substitute() {
+            if (!_nested && keyIs("HEADER")) {
+                flush();
+                TemplateRenderer(_arena, _vars, _title, true).render("/header.html");
+                return;
+            }
+            if (!_nested && keyIs("FOOTER")) {
+                flush();
+                TemplateRenderer(_arena, _vars, _title, true).render("/footer.html");
+                return;
+            }
+            if (keyIs("TITLE")) {
+                flush();
+                _arena->append(_title);
+                return;
+            }
+            size_t length;
+            const char* value = _vars.find(_key, _keyLength, length);
+            if (value) {
+                flush();
+                _arena->append(value, length);
+            } else {
+                _state = State::CLOSE;
+                abandon();
+                emit('}');
+            }
+        }
+
+        bool keyIs(const char* name) const {
+            return strncmp(name, _key, _keyLength) == 0 && name[_keyLength] == '\0';
+        }
+
+        // Literal text is staged so the arena sees a few large appends, not one per byte
+        void emit(char c) {
+            if (_pending == sizeof(_out)) flush();
+            _out[_pending++] = c;
+        }
+
+        void flush() {
+            _arena->append(_out, _pending);
+            _pending = 0;
+        }
+
+        ResponseArena* _arena;
+        const TemplateVars& _vars;
+        const char* _title;
+        bool _nested;
+        State _state = State::TEXT;
+        char _key[MAX_KEY];
+        uint8_t _keyLength = 0;
+        char _out[128];
+        size_t _pending = 0;
+    };
+}
+
+AsyncWebServerResponse* beginPage(AsyncWebServerRequest* request, int code, const char* path, const char* title,
+                                  TemplateFiller fill) {
+    std::shared_ptr<ResponseArena> arena(ResponseArena::acquire(), ResponseArena::release);
+    if (arena) {
+        TemplateVars vars(arena.get());
+        if (fill) fill(vars);
+        bool found = !vars.failed() && TemplateRenderer(arena.get(), vars, title, false).render(path);
+        if (found && !arena->overflowed()) {
+            AsyncWebServerResponse* response = request->beginResponse("text/html", arena->length(),
+                [arena](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                    return arena->read(index, buffer, maxLen);
+                });
+            response->setCode(code);
+            return response;
+        }
+        if (!found && !vars.failed()) return request->beginResponse(500, "text/plain", "Template missing");
+    }
+    Metrics::increment("http_rejected_arena");
+    AsyncWebServerResponse* response = request->beginResponse(503, "text/plain", "Server busy");
+    response->addHeader("Retry-After", "2");
+    return response;
+}
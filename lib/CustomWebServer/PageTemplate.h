@@ -0,0 +1,42 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include <functional>
+#include "ResponseArena.h"
+
+// Placeholder values for one page. Values are copied into the request's arena,
+// so whatever String produced them can be freed straight away.
+class TemplateVars {
+public:
+    static const uint8_t MAX_VARS = 24;
+
+    explicit TemplateVars(ResponseArena* arena);
+    // `key` must outlive the render (a string literal); values are copied
+    void set(const char* key, const char* value);
+    void set(const char* key, const String& value);
+    // nullptr for keys that were never set
+    const char* find(const char* key, size_t keyLength, size_t& valueLength) const;
+    // A value could not be stored (too many vars, or the arena ran out)
+    bool failed() const { return _failed; }
+
+private:
+    struct Var {
+        const char* key;
+        const char* value;
+        uint16_t length;
+    };
+    ResponseArena* _arena;
+    Var _vars[MAX_VARS];
+    uint8_t _count = 0;
+    bool _failed = false;
+};
+
+typedef std::function<void(TemplateVars&)> TemplateFiller;
+
+// Renders a LittleFS page template into a request arena and wraps it in a
+// response; the arena goes back to the pool when the response is destroyed.
+// {{HEADER}} and {{FOOTER}} pull in /header.html and /footer.html, {{TITLE}} is
+// `title`, other {{KEY}}s come from `fill`; unknown keys are left as they are.
+// Templates are streamed, so no copy of them is held in memory. Only when neither
+// the arena pool nor the heap reserve has room is the response a 503 instead.
+AsyncWebServerResponse* beginPage(AsyncWebServerRequest* request, int code, const char* path, const char* title,
+                                  TemplateFiller fill = nullptr);
@@ -0,0 +1,103 @@
+#include "ResponseCache.h"
+#include "ConfigManager.h"
+#include "Telemetry.h"
+#include "LogManager.h"
+#include "Metrics.h"
+#include <memory>
+
+ResponseCache::Entry ResponseCache::_entries[ResponseCache::MAX_ENTRIES];
+
+namespace {
+    uint32_t fnv1a(uint32_t h, const String& s) {
+        for (unsigned int i = 0; i < s.length(); ++i) {
+            h = (h ^ (uint8_t)s[i]) * 16777619u;
+        }
+        return h;
+    }
+
+    uint32_t requestKey(AsyncWebServerRequest *request) {
+        uint32_t h = fnv1a(2166136261u, request->url());
+        for (size_t i = 0; i < request->params(); ++i) {
+            const AsyncWebParameter* p = request->getParam(i);
+            if (p->isPost() || p->isFile()) continue;
+            h = fnv1a(h, "&" + p->name() + "=" + p->value());
+        }
+        return h;
+    }
+
+    String etagFor(uint32_t keyHash, uint32_t generation) {
+        char buf[24];
+        snprintf(buf, sizeof(buf), "\"%08x-%x\"", (unsigned)keyHash, (unsigned)generation);
+        return String(buf);
+    }
+}
+
+// Each source only ever increments, so the sum changes whenever any of them does
+uint32_t ResponseCache::dataGeneration() {
+    return TelemetryStore::sequence() + ConfigManager::generation() + LogManager::generation();
+}
+
+uint32_t ResponseCache::historyGeneration() {
+    return ConfigManager::generation() + LogManager::generation();
+}
+
+void ResponseCache::send(AsyncWebServerRequest *request, const char* contentType, ResponseRenderer render) {
+    send(request, contentType, dataGeneration(), render);
+}
+
+void ResponseCache::send(AsyncWebServerRequest *request, const char* contentType, uint32_t generation,
+                         ResponseRenderer render) {
+    uint32_t key = requestKey(request);
+    String etag = etagFor(key, generation);
+
+    if (request->hasHeader("If-None-Match") && request->getHeader("If-None-Match")->value() == etag) {
+        Metrics::increment("http_cache_not_modified");
+        AsyncWebServerResponse *response = request->beginResponse(304);
+        response->addHeader("ETag", etag);
+        request->send(response);
+        return;
+    }
+
+    Entry* entry = nullptr;
+    Entry* victim = &_entries[0];
+    for (uint8_t i = 0; i < MAX_ENTRIES; ++i) {
+        if (_entries[i].keyHash == key) {
+            entry = &_entries[i];
+            break;
+        }
+        if (_entries[i].lastUsed < victim->lastUsed) victim = &_entries[i];
+    }
+
+    AsyncWebServerResponse *response;
+    if (entry && entry->generation == generation) {
+        Metrics::increment("http_cache_hits");
+        entry->lastUsed = millis();
+        response = request->beginResponse(200, entry->contentType, entry->body);
+    } else {
+        Metrics::increment("http_cache_misses");
+        std::shared_ptr<String> body = std::make_shared<String>(render());
+        if (body->length() <= MAX_BODY) {
+            if (!entry) entry = victim;
+            entry->keyHash = key;
+            entry->generation = generation;
+            entry->contentType = contentType;
+            entry->body = *body;
+            entry->lastUsed = millis();
+        } else if (entry) {
+            entry->body = String(); // stale and too large to replace
+            entry->keyHash = 0;
+            entry->lastUsed = 0;
+        }
+        // Sent from the rendered copy rather than copied into the response
+        response = request->beginResponse(contentType, body->length(),
+            [body](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+                size_t n = body->length() - index;
+                if (n > maxLen) n = maxLen;
+                memcpy(buffer, body->c_str() + index, n);
+                return n;
+            });
+    }
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache"); // always revalidate
+    request->send(response);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <ESPAsyncWebServer.h>
+#include <functional>
+
+typedef std::function<String()> ResponseRenderer;
+
+// Conditional-GET cache for dynamic JSON endpoints. Entries are keyed on route + query
+// and tagged with the data generation (samples, level log appends and config saves);
+// a matching If-None-Match gets 304, a repeat within the same generation gets the
+// stored body without re-rendering. Bodies over MAX_BODY are streamed from the one
+// rendered copy and not kept. Only used from the AsyncTCP task.
+class ResponseCache {
+public:
+    static uint32_t dataGeneration();
+    // Level log appends and config saves only, for routes that do not show the live sample
+    static uint32_t historyGeneration();
+    static void send(AsyncWebServerRequest *request, const char* contentType, ResponseRenderer render);
+    static void send(AsyncWebServerRequest *request, const char* contentType, uint32_t generation,
+                     ResponseRenderer render);
+
+private:
+    static const uint8_t MAX_ENTRIES = 4;
+    static const size_t MAX_BODY = 4096;
+    struct Entry {
+        uint32_t keyHash;
+        uint32_t generation;
+        String contentType;
+        String body;
+        unsigned long lastUsed;
+    };
+    static Entry _entries[MAX_ENTRIES];
+};
@@ -12,6 +12,8 @@ void DisplayManager::setHardwareType(uint8_t hwType) {
 }
 
 void DisplayManager::begin() {
+    // Safe to call again after a hardware type change; the old driver is torn down first
+    _parola.~MD_Parola();
     new (&_parola) MD_Parola((MD_MAX72XX::moduleType_t)_hardwareType, _dataPin, _clkPin, _csPin, _numDevices);
     _parola.begin();
     _parola.setIntensity(5); // 0-15
@@ -36,8 +38,8 @@ void DisplayManager::displayLevel(float percent) {
     displayText(buf, true);
 }
 
-void DisplayManager::update() {
-    _parola.displayAnimate();
+bool DisplayManager::update() {
+    return !_parola.displayAnimate();
 }
 
 void DisplayManager::setBrightness(int value) {
@@ -10,7 +10,8 @@ public:
     void displayText(const char* text, bool scroll = true);
     void displayNumber(float value) override;
     void displayLevel(float percent);
-    void update();
+    // Advances the current animation by one frame; false once it has finished
+    bool update();
     void setHardwareType(uint8_t hwType);
     void setBrightness(int value);
     void clear() override;
@@ -0,0 +1,151 @@
+#include "Fleet.h"
+#include <AsyncUDP.h>
+#include "Telemetry.h"
+#include "Metrics.h"
+
+namespace {
+    const IPAddress GROUP(239, 255, 77, 1);
+
+    AsyncUDP sender;
+    AsyncUDP listener;
+    bool listening = false;
+
+    portMUX_TYPE tableMux = portMUX_INITIALIZER_UNLOCKED;
+    FleetTable table; // written from the AsyncUDP task, read by the web server
+
+    // getEfuseMac() holds the MAC first byte lowest, so its low 32 bits are mostly the
+    // shared Espressif OUI; bytes 2-5 carry the three device-specific bytes
+    uint32_t deviceId() {
+        return (uint32_t)(ESP.getEfuseMac() >> 16);
+    }
+
+    FleetReading readingFor(const Config& config, uint8_t tank) {
+        Telemetry t = TelemetryStore::latest(tank);
+        FleetReading r;
+        memset(&r, 0, sizeof(r));
+        r.deviceId = deviceId();
+        r.sequence = t.sequence;
+        r.tank = tank;
+        r.status = (uint8_t)t.status;
+        r.volumeValid = t.volumeValid;
+        r.percent = t.percent;
+        r.distanceCm = t.distanceCm;
+        r.liters = t.liters;
+        snprintf(r.name, sizeof(r.name), "%s", config.forTank(tank).deviceName.c_str());
+        return r;
+    }
+
+    void onPacket(AsyncUDPPacket& packet) {
+        FleetReading reading;
+        if (!FleetProtocol::decode(packet.data(), packet.length(), reading)) {
+            Metrics::increment("fleet_rx_invalid");
+            return;
+        }
+        if (reading.deviceId == deviceId()) return; // our own datagram looped back
+        uint32_t address = (uint32_t)packet.remoteIP();
+        uint32_t now = millis();
+        portENTER_CRITICAL(&tableMux);
+        bool accepted = FleetProtocol::update(table, reading, address, now);
+        FleetProtocol::expire(table, now, Fleet::PEER_MAX_AGE);
+        portEXIT_CRITICAL(&tableMux);
+        if (accepted) Metrics::increment("fleet_rx");
+    }
+
+    // Names come from the network; quotes, backslashes and control characters are escaped
+    String jsonString(const char* text) {
+        String out = "\"";
+        for (const char* p = text; *p; ++p) {
+            char c = *p;
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if ((uint8_t)c < 0x20) {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)(uint8_t)c);
+                out += escaped;
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+        return out;
+    }
+
+    String peerJson(const FleetPeer& peer, bool self, uint32_t now) {
+        const FleetReading& r = peer.reading;
+        Telemetry status;
+        status.status = (LevelStatus)r.status;
+        char id[9];
+        snprintf(id, sizeof(id), "%08x", (unsigned)r.deviceId);
+        String json = "{\"device\":\"" + String(id) + "\"";
+        json += ",\"name\":" + jsonString(r.name);
+        json += ",\"tank\":" + String(r.tank);
+        json += ",\"address\":\"" + (self ? String("self") : IPAddress(peer.address).toString()) + "\"";
+        json += ",\"percent\":" + String(r.percent, 1);
+        json += ",\"distance\":" + String(r.distanceCm, 1);
+        json += ",\"liters\":" + (r.volumeValid ? String(r.liters, 1) : String("null"));
+        json += ",\"status\":\"" + String(status.statusName()) + "\"";
+        json += ",\"age_s\":" + String((now - peer.lastSeen) / 1000);
+        json += ",\"sequence\":" + String(r.sequence);
+        json += "}";
+        return json;
+    }
+}
+
+void Fleet::configure(const Config& config) {
+    if (config.fleetHub == listening) return;
+    if (config.fleetHub) {
+        portENTER_CRITICAL(&tableMux);
+        FleetProtocol::reset(table);
+        portEXIT_CRITICAL(&tableMux);
+        listening = listener.listenMulticast(GROUP, PORT);
+        if (listening) {
+            listener.onPacket(onPacket);
+            Serial.println("[FLEET] Hub listening on " + GROUP.toString() + ":" + String(PORT));
+        } else {
+            Serial.println("[FLEET] Failed to join multicast group");
+        }
+    } else {
+        listener.close();
+        listening = false;
+        Serial.println("[FLEET] Hub stopped");
+    }
+}
+
+void Fleet::broadcast(const Config& config, uint8_t tanks) {
+    uint8_t datagram[FLEET_DATAGRAM_SIZE];
+    for (uint8_t tank = 0; tank < tanks; ++tank) {
+        size_t length = FleetProtocol::encode(readingFor(config, tank), datagram);
+        if (sender.writeTo(datagram, length, GROUP, PORT) == length) {
+            Metrics::increment("fleet_tx");
+        }
+    }
+}
+
+String Fleet::toJson(const Config& config, uint8_t tanks) {
+    uint32_t now = millis();
+    FleetTable peers;
+    portENTER_CRITICAL(&tableMux);
+    FleetProtocol::expire(table, now, PEER_MAX_AGE);
+    peers = table;
+    portEXIT_CRITICAL(&tableMux);
+
+    String json = "{\"hub\":" + String(listening ? "true" : "false");
+    json += ",\"broadcast\":" + String(config.fleetBroadcast ? "true" : "false");
+    json += ",\"tanks\":[";
+    for (uint8_t tank = 0; tank < tanks; ++tank) {
+        FleetPeer self;
+        self.reading = readingFor(config, tank);
+        self.address = 0;
+        self.lastSeen = TelemetryStore::latest(tank).sampledAt;
+        self.received = 0;
+        if (tank > 0) json += ",";
+        json += peerJson(self, true, now);
+    }
+    for (uint8_t i = 0; i < peers.count; ++i) {
+        json += ",";
+        json += peerJson(peers.peers[i], false, now);
+    }
+    json += "]}";
+    return json;
+}
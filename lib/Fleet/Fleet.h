@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include "ConfigManager.h"
+#include "FleetProtocol.h"
+
+// Broker-less LAN telemetry (see FleetProtocol). Every device can multicast one
+// datagram per tank to 239.255.77.1:47701 at the configured rate; a device in
+// hub mode also listens on the group and keeps the newest reading of each
+// peer tank in a fixed table, served with its own tanks at /api/fleet.
+// Peers not heard from for PEER_MAX_AGE are dropped.
+class Fleet {
+public:
+    static const uint16_t PORT = 47701;
+    static const uint32_t PEER_MAX_AGE = 300000; // ms
+
+    // Starts or stops the hub listener to match the config
+    static void configure(const Config& config);
+    // Sends the latest reading of each of the first `tanks` tanks
+    static void broadcast(const Config& config, uint8_t tanks);
+    static String toJson(const Config& config, uint8_t tanks);
+};
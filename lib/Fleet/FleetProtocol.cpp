@@ -0,0 +1,117 @@
+#include "FleetProtocol.h"
+#include <string.h>
+
+namespace {
+    const uint8_t MAGIC[3] = {'W', 'L', 'F'};
+    const uint8_t FLAG_VOLUME_VALID = 0x01;
+
+    void put16(uint8_t* p, uint16_t v) {
+        p[0] = (uint8_t)v;
+        p[1] = (uint8_t)(v >> 8);
+    }
+
+    void put32(uint8_t* p, uint32_t v) {
+        put16(p, (uint16_t)v);
+        put16(p + 2, (uint16_t)(v >> 16));
+    }
+
+    uint16_t get16(const uint8_t* p) {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    uint32_t get32(const uint8_t* p) {
+        return get16(p) | ((uint32_t)get16(p + 2) << 16);
+    }
+
+    int16_t scaled(float value) {
+        float v = value * 10.0f;
+        if (v > 32767.0f) return 32767;
+        if (v < -32768.0f) return -32768;
+        return (int16_t)(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+}
+
+namespace FleetProtocol {
+
+size_t encode(const FleetReading& reading, uint8_t* out) {
+    memcpy(out, MAGIC, 3);
+    out[3] = FLEET_VERSION;
+    put32(out + 4, reading.deviceId);
+    put32(out + 8, reading.sequence);
+    out[12] = reading.tank;
+    out[13] = reading.status;
+    out[14] = reading.volumeValid ? FLAG_VOLUME_VALID : 0;
+    out[15] = 0;
+    put16(out + 16, (uint16_t)scaled(reading.percent));
+    put16(out + 18, (uint16_t)scaled(reading.distanceCm));
+    put32(out + 20, reading.liters > 0 ? (uint32_t)(reading.liters * 10.0f + 0.5f) : 0);
+    memset(out + 24, 0, FLEET_NAME_LENGTH);
+    for (uint8_t i = 0; i < FLEET_NAME_LENGTH && reading.name[i]; ++i) out[24 + i] = (uint8_t)reading.name[i];
+    return FLEET_DATAGRAM_SIZE;
+}
+
+bool decode(const uint8_t* data, size_t length, FleetReading& reading) {
+    if (length < FLEET_DATAGRAM_SIZE || memcmp(data, MAGIC, 3) != 0 || data[3] != FLEET_VERSION) return false;
+    reading.deviceId = get32(data + 4);
+    reading.sequence = get32(data + 8);
+    reading.tank = data[12];
+    reading.status = data[13];
+    reading.volumeValid = (data[14] & FLAG_VOLUME_VALID) != 0;
+    reading.percent = (int16_t)get16(data + 16) / 10.0f;
+    reading.distanceCm = (int16_t)get16(data + 18) / 10.0f;
+    reading.liters = get32(data + 20) / 10.0f;
+    // The name ends up in JSON and HTML: printable ASCII only
+    uint8_t n = 0;
+    for (; n < FLEET_NAME_LENGTH && data[24 + n]; ++n) {
+        uint8_t c = data[24 + n];
+        reading.name[n] = c >= 0x20 && c < 0x7F ? (char)c : '?';
+    }
+    reading.name[n] = '\0';
+    return true;
+}
+
+void reset(FleetTable& table) {
+    memset(&table, 0, sizeof(table));
+}
+
+bool update(FleetTable& table, const FleetReading& reading, uint32_t address, uint32_t nowMs) {
+    FleetPeer* slot = nullptr;
+    for (uint8_t i = 0; i < table.count; ++i) {
+        FleetPeer& p = table.peers[i];
+        if (p.reading.deviceId == reading.deviceId && p.reading.tank == reading.tank) {
+            if (p.reading.sequence == reading.sequence && p.received) return false;
+            slot = &p;
+            break;
+        }
+    }
+    if (!slot) {
+        if (table.count < FLEET_MAX_PEERS) {
+            slot = &table.peers[table.count++];
+        } else {
+            slot = &table.peers[0];
+            for (uint8_t i = 1; i < table.count; ++i) {
+                if (nowMs - table.peers[i].lastSeen > nowMs - slot->lastSeen) slot = &table.peers[i];
+            }
+        }
+        slot->received = 0;
+    }
+    slot->reading = reading;
+    slot->address = address;
+    slot->lastSeen = nowMs;
+    slot->received++;
+    return true;
+}
+
+uint8_t expire(FleetTable& table, uint32_t nowMs, uint32_t maxAgeMs) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < table.count; ++i) {
+        if (nowMs - table.peers[i].lastSeen > maxAgeMs) continue;
+        if (kept != i) table.peers[kept] = table.peers[i];
+        kept++;
+    }
+    uint8_t dropped = table.count - kept;
+    table.count = kept;
+    return dropped;
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Platform-independent part of fleet telemetry: the datagram wire format and
+// the hub's peer table. No Arduino dependencies so both can be exercised over
+// loopback on a host.
+//
+// Datagram (little-endian, FLEET_DATAGRAM_SIZE bytes):
+//   0  magic "WLF"   3  version   4  device id (u32)   8  sequence (u32)
+//   12 tank (u8)     13 status    14 flags (bit 0: volume valid)   15 reserved
+//   16 percent x10 (i16)   18 distance cm x10 (i16, -10 on sensor error)
+//   20 litres x10 (u32)    24 device name, NUL padded (16 bytes)
+
+static const size_t FLEET_DATAGRAM_SIZE = 40;
+static const uint8_t FLEET_VERSION = 1;
+static const uint8_t FLEET_NAME_LENGTH = 16;
+static const uint8_t FLEET_MAX_PEERS = 16;
+
+struct FleetReading {
+    uint32_t deviceId;
+    uint32_t sequence;
+    uint8_t tank;
+    uint8_t status;       // LevelStatus
+    bool volumeValid;
+    float percent;
+    float distanceCm;
+    float liters;
+    char name[FLEET_NAME_LENGTH + 1];
+};
+
+struct FleetPeer {
+    FleetReading reading;
+    uint32_t address;     // IPv4 of the sender, 0 for this device's own tanks
+    uint32_t lastSeen;    // ms
+    uint32_t received;
+};
+
+// Fixed-size table keyed on (device id, tank). Must stay a trivial type.
+struct FleetTable {
+    FleetPeer peers[FLEET_MAX_PEERS];
+    uint8_t count;
+};
+
+namespace FleetProtocol {
+    size_t encode(const FleetReading& reading, uint8_t* out);
+    // False for datagrams that are not ours, from another version or truncated.
+    // Name bytes outside printable ASCII are replaced with '?'.
+    bool decode(const uint8_t* data, size_t length, FleetReading& reading);
+
+    void reset(FleetTable& table);
+    // Inserts or refreshes the entry for the reading's device and tank. A full
+    // table replaces the entry heard from least recently. Repeats of the last
+    // sequence (multicast duplicates) are ignored. Returns false if ignored.
+    bool update(FleetTable& table, const FleetReading& reading, uint32_t address, uint32_t nowMs);
+    // Drops entries not heard from for `maxAgeMs`; returns how many were dropped
+    uint8_t expire(FleetTable& table, uint32_t nowMs, uint32_t maxAgeMs);
+}
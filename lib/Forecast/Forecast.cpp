@@ -0,0 +1,139 @@
+#include "Forecast.h"
+#include <LittleFS.h>
+#include "HistoryStore.h"
+#include "Telemetry.h"
+#include "TimeSync.h"
+#include "Metrics.h"
+
+namespace {
+    const char* STATE_PATH = "/forecast.bin";
+    // One reading a minute is logged; hours with fewer valid readings are skipped
+    const size_t MAX_HOUR_SAMPLES = 128;
+    const size_t MIN_HOUR_SAMPLES = 30;
+    const float NOISE_PERCENT = 0.5f;
+
+    portMUX_TYPE stateMux = portMUX_INITIALIZER_UNLOCKED;
+    ForecastState state;
+    uint32_t checkedHour = 0; // newest hour already rolled up or skipped
+
+    bool load() {
+        File f = LittleFS.open(STATE_PATH, "r");
+        if (!f) return false;
+        bool ok = f.read((uint8_t*)&state, sizeof(state)) == sizeof(state) && ForecastLogic::isValid(state);
+        f.close();
+        return ok;
+    }
+
+    void save(const ForecastState& snapshot) {
+        File f = LittleFS.open(STATE_PATH, "w");
+        if (!f) {
+            Serial.println("[FORECAST] Failed to write " + String(STATE_PATH));
+            return;
+        }
+        f.write((const uint8_t*)&snapshot, sizeof(snapshot));
+        f.close();
+    }
+
+    ForecastState snapshot() {
+        portENTER_CRITICAL(&stateMux);
+        ForecastState copy = state;
+        portEXIT_CRITICAL(&stateMux);
+        return copy;
+    }
+
+    String hoursJson(float hours) {
+        return hours < 0 ? String("null") : String(hours, 1);
+    }
+
+    // Level after `hours` hours of forecast consumption, floored at empty
+    float levelAfter(const ForecastState& s, float percent, uint16_t hours) {
+        for (uint16_t h = 1; h <= hours; ++h) percent -= ForecastLogic::consumptionAhead(s, h);
+        return percent > 0.0f ? percent : 0.0f;
+    }
+}
+
+void Forecast::begin() {
+    if (load()) {
+        Serial.printf("[FORECAST] Model restored, %u hours seen\n", (unsigned)state.hoursSeen);
+    } else {
+        ForecastLogic::reset(state);
+    }
+    checkedHour = state.lastHour;
+}
+
+bool Forecast::update(uint32_t now, const Config& config) {
+    if (!TimeSync::isSynced()) return false;
+    uint32_t closed = now / 3600 - 1;
+    if (closed <= checkedHour) return false;
+    checkedHour = closed;
+
+    // Hourly rollup of the level history: consumption over the hour that just closed
+    HistorySample* samples = new HistorySample[MAX_HOUR_SAMPLES];
+    float* percents = new float[MAX_HOUR_SAMPLES];
+    size_t n = HistoryStore::readRange(closed * 3600, closed * 3600 + 3599, samples, MAX_HOUR_SAMPLES);
+    size_t valid = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (samples[i].distanceCm < 0) continue;
+        percents[valid++] = Telemetry::compute(config, samples[i].distanceCm).percent;
+    }
+    float used = ForecastLogic::consumption(percents, valid, NOISE_PERCENT);
+    delete[] samples;
+    delete[] percents;
+    if (valid < MIN_HOUR_SAMPLES) return false;
+
+    portENTER_CRITICAL(&stateMux);
+    ForecastLogic::update(state, closed, used);
+    ForecastState copy = state;
+    portEXIT_CRITICAL(&stateMux);
+    save(copy);
+    Metrics::set("forecast_hours_seen", copy.hoursSeen);
+    return true;
+}
+
+String Forecast::toJson(uint32_t now, float percent, float lowPercent, uint16_t hours) {
+    ForecastState s = snapshot();
+    if (hours > FORECAST_HORIZON) hours = FORECAST_HORIZON;
+    String json = "{\"ready\":" + String(ForecastLogic::isReady(s) ? "true" : "false");
+    json += ",\"hours_seen\":" + String(s.hoursSeen);
+    json += ",\"level_percent\":" + String(percent, 1);
+    if (!ForecastLogic::isReady(s)) return json + "}";
+
+    float toEmpty = ForecastLogic::hoursUntil(s, percent, 0.0f, hours);
+    float toLow = ForecastLogic::hoursUntil(s, percent, lowPercent, hours);
+    json += ",\"hours_to_empty\":" + hoursJson(toEmpty);
+    json += ",\"hours_to_low\":" + hoursJson(toLow);
+    json += ",\"empty_at\":" + (toEmpty < 0 ? String("null") : String(now + (uint32_t)(toEmpty * 3600.0f)));
+    json += ",\"start\":" + String((s.lastHour + 1) * 3600);
+    String consumption = "[";
+    String level = "[";
+    float projected = percent;
+    for (uint16_t h = 1; h <= hours; ++h) {
+        float used = ForecastLogic::consumptionAhead(s, h);
+        projected = projected > used ? projected - used : 0.0f;
+        if (h > 1) {
+            consumption += ",";
+            level += ",";
+        }
+        consumption += String(used, 2);
+        level += String(projected, 1);
+    }
+    json += ",\"consumption_per_hour\":" + consumption + "]";
+    json += ",\"level\":" + level + "]";
+    json += "}";
+    return json;
+}
+
+String Forecast::summaryJson(uint32_t now, float percent, float lowPercent) {
+    ForecastState s = snapshot();
+    if (!ForecastLogic::isReady(s)) return "{\"ready\":false}";
+    float toEmpty = ForecastLogic::hoursUntil(s, percent, 0.0f, FORECAST_HORIZON);
+    String json = "{\"ready\":true";
+    json += ",\"hours_to_empty\":" + hoursJson(toEmpty);
+    json += ",\"hours_to_low\":" + hoursJson(ForecastLogic::hoursUntil(s, percent, lowPercent, FORECAST_HORIZON));
+    json += ",\"empty_at\":" + (toEmpty < 0 ? String("null") : String(now + (uint32_t)(toEmpty * 3600.0f)));
+    json += ",\"level_24h\":" + String(levelAfter(s, percent, 24), 1);
+    json += ",\"level_48h\":" + String(levelAfter(s, percent, 48), 1);
+    json += ",\"level_72h\":" + String(levelAfter(s, percent, 72), 1);
+    json += "}";
+    return json;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include "ConfigManager.h"
+#include "ForecastLogic.h"
+
+// Demand forecast for the primary tank (see ForecastLogic). Once an hour the
+// hour that just closed is rolled up from the level history into the model;
+// the 116 byte state is then written to /forecast.bin so it survives reboots.
+class Forecast {
+public:
+    static void begin();
+    // Folds the newest closed hour into the model if that has not happened yet.
+    // Needs wall-clock time. Returns true when the model was updated.
+    static bool update(uint32_t now, const Config& config);
+
+    // Projection from `percent` now over the next `hours` (at most FORECAST_HORIZON):
+    // hourly consumption and level, plus the time until empty and until `lowPercent`
+    static String toJson(uint32_t now, float percent, float lowPercent, uint16_t hours);
+    // Time to empty/low and the level in 24, 48 and 72 hours, for MQTT
+    static String summaryJson(uint32_t now, float percent, float lowPercent);
+};
@@ -0,0 +1,88 @@
+#include "ForecastLogic.h"
+#include <math.h>
+
+namespace {
+    const uint32_t STATE_MAGIC = 0x46435354; // "FCST"
+}
+
+namespace ForecastLogic {
+
+void reset(ForecastState& state) {
+    state.magic = STATE_MAGIC;
+    state.lastHour = 0;
+    state.hoursSeen = 0;
+    state.level = 0.0f;
+    state.trend = 0.0f;
+    for (uint8_t i = 0; i < FORECAST_SEASON; ++i) state.season[i] = 0.0f;
+}
+
+bool isValid(const ForecastState& state) {
+    return state.magic == STATE_MAGIC;
+}
+
+bool isReady(const ForecastState& state) {
+    return state.hoursSeen >= FORECAST_SEASON;
+}
+
+void update(ForecastState& state, uint32_t hour, float consumption) {
+    if (state.lastHour != 0 && hour <= state.lastHour) return;
+    uint8_t slot = hour % FORECAST_SEASON;
+    state.lastHour = hour;
+
+    // First day: record the raw profile, then split it into level and season
+    if (state.hoursSeen < FORECAST_SEASON) {
+        state.season[slot] = consumption;
+        if (++state.hoursSeen == FORECAST_SEASON) {
+            float sum = 0.0f;
+            for (uint8_t i = 0; i < FORECAST_SEASON; ++i) sum += state.season[i];
+            state.level = sum / FORECAST_SEASON;
+            for (uint8_t i = 0; i < FORECAST_SEASON; ++i) state.season[i] -= state.level;
+        }
+        return;
+    }
+
+    float seasonal = state.season[slot];
+    float previous = state.level;
+    state.level = ALPHA * (consumption - seasonal) + (1.0f - ALPHA) * (previous + PHI * state.trend);
+    state.trend = BETA * (state.level - previous) + (1.0f - BETA) * PHI * state.trend;
+    state.season[slot] = GAMMA * (consumption - state.level) + (1.0f - GAMMA) * seasonal;
+    state.hoursSeen++;
+}
+
+float consumptionAhead(const ForecastState& state, uint16_t ahead) {
+    float damping = PHI * (1.0f - powf(PHI, ahead)) / (1.0f - PHI); // PHI + PHI^2 + ... + PHI^ahead
+    float value = state.level + damping * state.trend + state.season[(state.lastHour + ahead) % FORECAST_SEASON];
+    return value > 0.0f ? value : 0.0f;
+}
+
+float consumption(const float* percents, size_t count, float noise) {
+    if (count == 0) return 0.0f;
+    float used = 0.0f;
+    float anchor = percents[0];
+    for (size_t i = 1; i < count; ++i) {
+        if (percents[i] <= anchor - noise) {
+            used += anchor - percents[i];
+            anchor = percents[i];
+        } else if (percents[i] >= anchor + noise) {
+            anchor = percents[i];
+        }
+    }
+    return used;
+}
+
+float hoursUntil(const ForecastState& state, float percent, float floor, uint16_t horizon) {
+    if (percent <= floor) return 0.0f;
+    float damping = 0.0f;
+    float power = 1.0f;
+    for (uint16_t h = 1; h <= horizon; ++h) {
+        power *= PHI;
+        damping += power;
+        float used = state.level + damping * state.trend + state.season[(state.lastHour + h) % FORECAST_SEASON];
+        if (used <= 0.0f) continue;
+        if (percent - used <= floor) return (h - 1) + (percent - floor) / used;
+        percent -= used;
+    }
+    return -1.0f;
+}
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Platform-independent part of the demand forecast: additive Holt-Winters
+// (triple exponential smoothing) over hourly consumption with a daily season
+// and a damped trend. No Arduino dependencies so it can be exercised on a host.
+//
+// The model is fed one value per closed hour: the tank's consumption in % of
+// its capacity (level drops; refills do not count). Forecasting consumption
+// rather than the level itself keeps tanker refills, which are not part of the
+// demand pattern, out of the model; the level is projected by subtracting the
+// forecast consumption from the current reading.
+
+static const uint8_t FORECAST_SEASON = 24;     // hours in one season
+static const uint16_t FORECAST_HORIZON = 72;   // longest projection, in hours
+
+// Persisted as-is; must stay a trivial type
+struct __attribute__((packed)) ForecastState {
+    uint32_t magic;
+    uint32_t lastHour;    // epoch hour of the last update, 0 before the first
+    uint32_t hoursSeen;
+    float level;          // smoothed consumption per hour, deseasonalised
+    float trend;          // change of `level` per hour
+    float season[FORECAST_SEASON];
+};
+
+namespace ForecastLogic {
+    static const float ALPHA = 0.2f;   // level smoothing
+    static const float BETA = 0.02f;   // trend smoothing
+    static const float GAMMA = 0.15f;  // season smoothing
+    static const float PHI = 0.98f;    // trend damping per hour ahead
+
+    void reset(ForecastState& state);
+    bool isValid(const ForecastState& state);
+    // The first day only seeds the season; forecasts are available after it
+    bool isReady(const ForecastState& state);
+
+    // Folds in the consumption of epoch hour `hour`. Hours must be fed in order;
+    // missing hours are simply skipped.
+    void update(ForecastState& state, uint32_t hour, float consumption);
+
+    // Forecast consumption of the hour `ahead` hours after the last update (ahead >= 1)
+    float consumptionAhead(const ForecastState& state, uint16_t ahead);
+
+    // Sum of level drops beyond `noise` over a run of readings (in %), oldest first
+    float consumption(const float* percents, size_t count, float noise);
+
+    // Hours until the projected level falls to `floor` starting from `percent` now,
+    // interpolated within the hour; -1 if it stays above within `horizon` hours
+    float hoursUntil(const ForecastState& state, float percent, float floor, uint16_t horizon);
+}
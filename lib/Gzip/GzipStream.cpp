@@ -0,0 +1,187 @@
+#include "GzipStream.h"
+#include <string.h>
+
+namespace {
+    const uint8_t GZIP_HEADER[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff}; // deflate, no name, unknown OS
+    const size_t MIN_MATCH = 3;
+    const size_t MAX_MATCH = 258;
+    const size_t FINISH_WORST_CASE = sizeof(GZIP_HEADER) + 4 + 8;
+    const uint16_t END_OF_BLOCK = 256;
+
+    const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                      35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                        8193, 12289, 16385, 24577};
+    const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+        crc = ~crc;
+        for (size_t i = 0; i < len; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+    uint16_t hash3(const uint8_t* p) {
+        return ((p[0] << 5) ^ (p[1] << 2) ^ p[2] ^ (p[0] >> 3)) & 0x1FF;
+    }
+}
+
+GzipStream::GzipStream()
+    : _windowLen(0), _outLen(0), _bitBuffer(0), _bitCount(0), _crc(0), _inputSize(0),
+      _headerWritten(false), _finished(false) {
+    for (size_t i = 0; i < HASH_SIZE; ++i) _hashHead[i] = -1;
+}
+
+size_t GzipStream::write(const uint8_t* data, size_t len) {
+    size_t consumed = 0;
+    while (!_finished && consumed < len && OUTPUT_SIZE - _outLen >= CHUNK_WORST_CASE + sizeof(GZIP_HEADER)) {
+        if (!_headerWritten) {
+            for (size_t i = 0; i < sizeof(GZIP_HEADER); ++i) putByte(GZIP_HEADER[i]);
+            putBits(0, 1); // BFINAL = 0: the final block is an empty one written by finish()
+            putBits(1, 2); // BTYPE = 01, fixed Huffman
+            _headerWritten = true;
+        }
+        size_t n = len - consumed < MAX_CHUNK ? len - consumed : MAX_CHUNK;
+        compressChunk(data + consumed, n);
+        consumed += n;
+    }
+    return consumed;
+}
+
+bool GzipStream::finish() {
+    if (_finished) return true;
+    if (OUTPUT_SIZE - _outLen < FINISH_WORST_CASE) return false;
+    if (!_headerWritten) {
+        for (size_t i = 0; i < sizeof(GZIP_HEADER); ++i) putByte(GZIP_HEADER[i]);
+        putBits(0, 1);
+        putBits(1, 2);
+        _headerWritten = true;
+    }
+    putCode(END_OF_BLOCK - 256, 7);
+    putBits(1, 1); // BFINAL
+    putBits(1, 2);
+    putCode(END_OF_BLOCK - 256, 7);
+    if (_bitCount > 0) {
+        putByte(_bitBuffer & 0xFF);
+        _bitBuffer = 0;
+        _bitCount = 0;
+    }
+    for (int i = 0; i < 4; ++i) putByte((_crc >> (8 * i)) & 0xFF);
+    for (int i = 0; i < 4; ++i) putByte((_inputSize >> (8 * i)) & 0xFF);
+    _finished = true;
+    return true;
+}
+
+size_t GzipStream::read(uint8_t* dest, size_t max) {
+    size_t n = _outLen < max ? _outLen : max;
+    memcpy(dest, _out, n);
+    memmove(_out, _out + n, _outLen - n);
+    _outLen -= n;
+    return n;
+}
+
+void GzipStream::compressChunk(const uint8_t* data, size_t len) {
+    if (_windowLen + len > sizeof(_window)) slideWindow();
+    memcpy(_window + _windowLen, data, len);
+    _crc = crc32Update(_crc, data, len);
+    _inputSize += len;
+
+    size_t pos = _windowLen;
+    size_t end = _windowLen + len;
+    while (pos < end) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (pos + MIN_MATCH <= end) {
+            uint16_t h = hash3(_window + pos);
+            int16_t candidate = _hashHead[h];
+            _hashHead[h] = (int16_t)pos;
+            if (candidate >= 0 && pos - candidate <= WINDOW_SIZE) {
+                size_t limit = end - pos < MAX_MATCH ? end - pos : MAX_MATCH;
+                size_t length = 0;
+                while (length < limit && _window[candidate + length] == _window[pos + length]) length++;
+                if (length >= MIN_MATCH) {
+                    bestLength = length;
+                    bestDistance = pos - candidate;
+                }
+            }
+        }
+        if (bestLength == 0) {
+            putLiteral(_window[pos]);
+            pos++;
+            continue;
+        }
+        putMatch(bestLength, bestDistance);
+        for (size_t i = 1; i < bestLength && pos + i + MIN_MATCH <= end; ++i) {
+            _hashHead[hash3(_window + pos + i)] = (int16_t)(pos + i);
+        }
+        pos += bestLength;
+    }
+    _windowLen = end;
+}
+
+// Keeps the last WINDOW_SIZE bytes as history for back-references
+void GzipStream::slideWindow() {
+    if (_windowLen <= WINDOW_SIZE) return;
+    size_t shift = _windowLen - WINDOW_SIZE;
+    memmove(_window, _window + shift, WINDOW_SIZE);
+    _windowLen = WINDOW_SIZE;
+    for (size_t i = 0; i < HASH_SIZE; ++i) {
+        _hashHead[i] = _hashHead[i] >= (int16_t)shift ? (int16_t)(_hashHead[i] - shift) : -1;
+    }
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t count) {
+    _bitBuffer |= value << _bitCount;
+    _bitCount += count;
+    while (_bitCount >= 8) {
+        putByte(_bitBuffer & 0xFF);
+        _bitBuffer >>= 8;
+        _bitCount -= 8;
+    }
+}
+
+// Huffman codes are defined MSB-first but packed LSB-first, so reverse them
+void GzipStream::putCode(uint16_t code, uint8_t length) {
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < length; ++i) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    putBits(reversed, length);
+}
+
+void GzipStream::putLiteral(uint8_t value) {
+    if (value < 144) {
+        putCode(0x30 + value, 8);
+    } else {
+        putCode(0x190 + (value - 144), 9);
+    }
+}
+
+void GzipStream::putMatch(uint16_t length, uint16_t distance) {
+    uint8_t i = 28;
+    while (LENGTH_BASE[i] > length) i--;
+    uint16_t symbol = 257 + i;
+    if (symbol < 280) {
+        putCode(symbol - 256, 7);
+    } else {
+        putCode(0xC0 + (symbol - 280), 8);
+    }
+    putBits(length - LENGTH_BASE[i], LENGTH_EXTRA[i]);
+
+    uint8_t d = 29;
+    while (DISTANCE_BASE[d] > distance) d--;
+    putCode(d, 5);
+    putBits(distance - DISTANCE_BASE[d], DISTANCE_EXTRA[d]);
+}
+
+void GzipStream::putByte(uint8_t value) {
+    _out[_outLen++] = value;
+}
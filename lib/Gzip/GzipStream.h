@@ -0,0 +1,53 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Incremental gzip encoder with a small fixed footprint (~3.5 KB): greedy LZ77
+// over a 1 KB window, coded with the fixed Huffman tables of RFC 1951, so no
+// dynamic trees have to be built or buffered. CSV exports shrink to about a
+// third of their size. No Arduino dependencies.
+//
+// Usage: write() input while there is room for output, drain output with read(),
+// call finish() once and drain the rest.
+class GzipStream {
+public:
+    static const size_t WINDOW_SIZE = 1024;
+    static const size_t OUTPUT_SIZE = 512;
+
+    GzipStream();
+
+    // Compresses as much of `data` as fits in the output buffer; returns the bytes consumed
+    size_t write(const uint8_t* data, size_t len);
+    // Ends the deflate stream and appends the gzip trailer; returns false if the
+    // output buffer must be drained first
+    bool finish();
+    bool isFinished() const { return _finished; }
+
+    size_t available() const { return _outLen; }
+    size_t read(uint8_t* dest, size_t max);
+
+private:
+    static const size_t HASH_SIZE = 512;
+    static const size_t MAX_CHUNK = 256;   // input compressed per step
+    static const size_t CHUNK_WORST_CASE = MAX_CHUNK * 9 / 8 + 8;
+
+    void compressChunk(const uint8_t* data, size_t len);
+    void slideWindow();
+    void putBits(uint32_t value, uint8_t count);
+    void putCode(uint16_t code, uint8_t length);
+    void putLiteral(uint8_t value);
+    void putMatch(uint16_t length, uint16_t distance);
+    void putByte(uint8_t value);
+
+    uint8_t _window[WINDOW_SIZE * 2];
+    size_t _windowLen;
+    int16_t _hashHead[HASH_SIZE];   // window position of the last occurrence, -1 = none
+    uint8_t _out[OUTPUT_SIZE];
+    size_t _outLen;
+    uint32_t _bitBuffer;
+    uint8_t _bitCount;
+    uint32_t _crc;
+    uint32_t _inputSize;
+    bool _headerWritten;
+    bool _finished;
+};
@@ -0,0 +1,61 @@
+#include "HistoryCache.h"
+
+HistoryCache::HistoryCache()
+    : _buffer(nullptr), _capacity(0), _head(0), _count(0) {
+}
+
+void HistoryCache::attach(HistorySample* buffer, size_t capacity, size_t filled) {
+    _buffer = buffer;
+    _capacity = buffer ? capacity : 0;
+    _head = 0;
+    _count = filled < _capacity ? filled : _capacity;
+}
+
+void HistoryCache::push(const HistorySample& sample) {
+    if (_capacity == 0) return;
+    _buffer[(_head + _count) % _capacity] = sample;
+    if (_count < _capacity) {
+        _count++;
+    } else {
+        _head = (_head + 1) % _capacity;
+    }
+}
+
+void HistoryCache::clear() {
+    _head = 0;
+    _count = 0;
+}
+
+size_t HistoryCache::copyLast(HistorySample* out, size_t count, size_t skipNewest) const {
+    if (skipNewest >= _count) return 0;
+    size_t available = _count - skipNewest;
+    if (count > available) count = available;
+    size_t start = available - count;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = at(start + i);
+    }
+    return count;
+}
+
+bool HistoryCache::covers(uint32_t timestamp) const {
+    return _count > 0 && at(0).timestamp <= timestamp;
+}
+
+size_t HistoryCache::copyRange(uint32_t from, uint32_t to, HistorySample* out, size_t max) const {
+    // Binary search for the first sample at or after `from`
+    size_t lo = 0;
+    size_t hi = _count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (at(mid).timestamp < from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    size_t n = 0;
+    for (size_t i = lo; i < _count && n < max && at(i).timestamp <= to; ++i) {
+        out[n++] = at(i);
+    }
+    return n;
+}
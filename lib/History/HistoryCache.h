@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include "HistoryCodec.h"
+
+// Fixed-size ring of the most recent history samples, kept in RAM so recent
+// history queries never touch flash. Samples are pushed in time order. The buffer is supplied by the owner (PSRAM
+// when the board has it). No Arduino dependencies.
+class HistoryCache {
+public:
+    HistoryCache();
+    // The first `filled` entries of `buffer` already hold samples, oldest first
+    void attach(HistorySample* buffer, size_t capacity, size_t filled = 0);
+
+    void push(const HistorySample& sample);
+    void clear();
+    size_t size() const { return _count; }
+    size_t capacity() const { return _capacity; }
+
+    // True if the ring reaches back to `timestamp`
+    bool covers(uint32_t timestamp) const;
+    // Samples with from <= timestamp <= to, oldest first, at most `max`
+    size_t copyRange(uint32_t from, uint32_t to, HistorySample* out, size_t max) const;
+    // Copies `count` samples ending `skipNewest` samples before the newest one
+    // into `out`, oldest first. Returns how many were available.
+    size_t copyLast(HistorySample* out, size_t count, size_t skipNewest = 0) const;
+
+private:
+    const HistorySample& at(size_t i) const { return _buffer[(_head + i) % _capacity]; }
+
+    HistorySample* _buffer;
+    size_t _capacity;
+    size_t _head;   // index of the oldest sample
+    size_t _count;
+};
@@ -0,0 +1,201 @@
+#include "HistoryCodec.h"
+#include <string.h>
+
+namespace {
+    const uint32_t PAYLOAD_BITS = HISTORY_PAYLOAD_SIZE * 8;
+
+    // Bucket widths after the '10', '110' and '1110' prefixes; '1111' is always 32 bits
+    const uint8_t TIMESTAMP_WIDTHS[3] = {7, 9, 12};
+    const uint8_t DISTANCE_WIDTHS[3] = {4, 8, 16};
+
+    bool fits(int32_t value, uint8_t width) {
+        int32_t limit = (int32_t)1 << (width - 1);
+        return value >= -limit && value < limit;
+    }
+
+    uint32_t codedBits(int32_t value, const uint8_t* widths) {
+        if (value == 0) return 1;
+        for (uint8_t i = 0; i < 3; ++i) {
+            if (fits(value, widths[i])) return (i + 2) + widths[i];
+        }
+        return 4 + 32;
+    }
+
+    void writeBits(uint8_t* payload, uint16_t& bitPos, uint32_t value, uint8_t width) {
+        for (int8_t i = width - 1; i >= 0; --i) {
+            uint8_t mask = 0x80 >> (bitPos & 7);
+            if ((value >> i) & 1) {
+                payload[bitPos >> 3] |= mask;
+            } else {
+                payload[bitPos >> 3] &= ~mask;
+            }
+            bitPos++;
+        }
+    }
+
+    void writeValue(uint8_t* payload, uint16_t& bitPos, int32_t value, const uint8_t* widths) {
+        if (value == 0) {
+            writeBits(payload, bitPos, 0, 1);
+            return;
+        }
+        for (uint8_t i = 0; i < 3; ++i) {
+            if (fits(value, widths[i])) {
+                // i + 1 ones followed by a zero
+                writeBits(payload, bitPos, ((1u << (i + 1)) - 1) << 1, i + 2);
+                writeBits(payload, bitPos, (uint32_t)value & ((1u << widths[i]) - 1), widths[i]);
+                return;
+            }
+        }
+        writeBits(payload, bitPos, 0xF, 4);
+        writeBits(payload, bitPos, (uint32_t)value, 32);
+    }
+
+    bool readBits(const HistoryBlock& block, uint16_t& bitPos, uint8_t width, uint32_t& value) {
+        if ((uint32_t)bitPos + width > block.bitLength) return false;
+        value = 0;
+        for (uint8_t i = 0; i < width; ++i) {
+            uint8_t bit = (block.payload[bitPos >> 3] >> (7 - (bitPos & 7))) & 1;
+            value = (value << 1) | bit;
+            bitPos++;
+        }
+        return true;
+    }
+
+    bool readValue(const HistoryBlock& block, uint16_t& bitPos, const uint8_t* widths, int32_t& value) {
+        uint8_t ones = 0;
+        uint32_t bit;
+        while (ones < 4) {
+            if (!readBits(block, bitPos, 1, bit)) return false;
+            if (!bit) break;
+            ones++;
+        }
+        if (ones == 0) {
+            value = 0;
+            return true;
+        }
+        uint8_t width = ones < 4 ? widths[ones - 1] : 32;
+        uint32_t raw;
+        if (!readBits(block, bitPos, width, raw)) return false;
+        if (width < 32 && (raw & (1u << (width - 1)))) {
+            raw |= ~((1u << width) - 1); // sign-extend
+        }
+        value = (int32_t)raw;
+        return true;
+    }
+}
+
+namespace HistoryCodec {
+
+int32_t quantize(float distanceCm) {
+    float scaled = distanceCm * HISTORY_DISTANCE_SCALE;
+    return (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+}
+
+float dequantize(int32_t distance) {
+    return distance / HISTORY_DISTANCE_SCALE;
+}
+
+bool isValid(const HistoryBlock& block) {
+    if (block.bitLength > PAYLOAD_BITS) return false;
+    if (block.count == 0) return block.bitLength == 0;
+    return block.count > 1 || block.bitLength == 0;
+}
+
+}
+
+HistoryEncoder::HistoryEncoder()
+    : _block(nullptr), _prevTimestamp(0), _prevDelta(0), _prevDistance(0) {
+}
+
+void HistoryEncoder::begin(HistoryBlock* block) {
+    _block = block;
+    memset(block, 0, sizeof(HistoryBlock));
+    _prevTimestamp = 0;
+    _prevDelta = 0;
+    _prevDistance = 0;
+}
+
+bool HistoryEncoder::resume(HistoryBlock* block) {
+    if (!HistoryCodec::isValid(*block)) {
+        begin(block);
+        return false;
+    }
+    _block = block;
+    HistoryDecoder decoder(*block);
+    HistorySample sample;
+    uint16_t decoded = 0;
+    uint32_t prevTimestamp = block->firstTimestamp;
+    _prevDelta = 0;
+    while (decoder.next(sample)) {
+        if (decoded > 0) _prevDelta = (int32_t)(sample.timestamp - prevTimestamp);
+        prevTimestamp = sample.timestamp;
+        _prevDistance = HistoryCodec::quantize(sample.distanceCm);
+        decoded++;
+    }
+    if (decoded != block->count) {
+        begin(block);
+        return false;
+    }
+    _prevTimestamp = prevTimestamp;
+    return true;
+}
+
+bool HistoryEncoder::append(uint32_t timestamp, float distanceCm) {
+    int32_t distance = HistoryCodec::quantize(distanceCm);
+    if (_block->count == 0) {
+        _block->firstTimestamp = timestamp;
+        _block->lastTimestamp = timestamp;
+        _block->firstDistance = distance;
+        _block->count = 1;
+        _block->bitLength = 0;
+        _prevTimestamp = timestamp;
+        _prevDelta = 0;
+        _prevDistance = distance;
+        return true;
+    }
+    if (_block->count == UINT16_MAX) return false;
+
+    // Unsigned arithmetic so out-of-order or wrapped timestamps round-trip exactly
+    int32_t delta = (int32_t)(timestamp - _prevTimestamp);
+    int32_t deltaOfDelta = (int32_t)((uint32_t)delta - (uint32_t)_prevDelta);
+    int32_t distanceDelta = (int32_t)((uint32_t)distance - (uint32_t)_prevDistance);
+    uint32_t bits = codedBits(deltaOfDelta, TIMESTAMP_WIDTHS) + codedBits(distanceDelta, DISTANCE_WIDTHS);
+    if (_block->bitLength + bits > PAYLOAD_BITS) return false;
+
+    uint16_t bitPos = _block->bitLength;
+    writeValue(_block->payload, bitPos, deltaOfDelta, TIMESTAMP_WIDTHS);
+    writeValue(_block->payload, bitPos, distanceDelta, DISTANCE_WIDTHS);
+    _block->bitLength = bitPos;
+    _block->count++;
+    _block->lastTimestamp = timestamp;
+    _prevTimestamp = timestamp;
+    _prevDelta = delta;
+    _prevDistance = distance;
+    return true;
+}
+
+HistoryDecoder::HistoryDecoder(const HistoryBlock& block)
+    : _block(block), _index(0), _bitPos(0), _prevTimestamp(0), _prevDelta(0), _prevDistance(0) {
+}
+
+bool HistoryDecoder::next(HistorySample& sample) {
+    if (_index >= _block.count) return false;
+    if (_index == 0) {
+        _prevTimestamp = _block.firstTimestamp;
+        _prevDistance = _block.firstDistance;
+    } else {
+        int32_t deltaOfDelta, distanceDelta;
+        if (!readValue(_block, _bitPos, TIMESTAMP_WIDTHS, deltaOfDelta) ||
+            !readValue(_block, _bitPos, DISTANCE_WIDTHS, distanceDelta)) {
+            _index = _block.count;
+            return false;
+        }
+        _prevDelta = (int32_t)((uint32_t)_prevDelta + (uint32_t)deltaOfDelta);
+        _prevTimestamp += (uint32_t)_prevDelta;
+        _prevDistance = (int32_t)((uint32_t)_prevDistance + (uint32_t)distanceDelta);
+    }
+    _index++;
+    sample.timestamp = _prevTimestamp;
+    sample.distanceCm = HistoryCodec::dequantize(_prevDistance);
+    return true;
+}
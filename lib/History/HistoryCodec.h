@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed encoding of the level history. Only the timestamp and the measured
+// distance are stored; level, percent and volume are derived from the tank config
+// when the history is read. No Arduino dependencies so it can be exercised on a host.
+//
+// Timestamps are delta-of-delta coded, so a steady logging interval costs one bit
+// per sample. Distances are quantized to DISTANCE_SCALE steps per cm (0.1 cm, below
+// the sensor's resolution) and delta coded. Both use the same prefix buckets:
+//   '0'              value is zero
+//   '10'   + w0 bits  '110' + w1 bits  '1110' + w2 bits  '1111' + 32 bits
+// with the value stored as two's complement in the bucket width.
+
+static const size_t HISTORY_BLOCK_SIZE = 256;
+static const size_t HISTORY_HEADER_SIZE = 16;
+static const size_t HISTORY_PAYLOAD_SIZE = HISTORY_BLOCK_SIZE - HISTORY_HEADER_SIZE;
+static const float HISTORY_DISTANCE_SCALE = 10.0f;
+
+struct HistorySample {
+    uint32_t timestamp;
+    float distanceCm;   // -1 on sensor error
+};
+
+// One fixed-size block as written to flash. Must stay a trivial type.
+struct HistoryBlock {
+    uint32_t firstTimestamp;
+    uint32_t lastTimestamp;
+    int32_t firstDistance;  // quantized
+    uint16_t count;         // samples in the block, 0 = unused
+    uint16_t bitLength;     // bits of payload in use
+    uint8_t payload[HISTORY_PAYLOAD_SIZE];
+};
+
+class HistoryEncoder {
+public:
+    HistoryEncoder();
+    // Starts a fresh, empty block.
+    void begin(HistoryBlock* block);
+    // Continues a partially filled block read back from flash. Returns false
+    // if the block is corrupt, in which case it is restarted empty.
+    bool resume(HistoryBlock* block);
+    // Returns false when the sample does not fit; the block is then full and
+    // the caller starts a new one.
+    bool append(uint32_t timestamp, float distanceCm);
+
+private:
+    HistoryBlock* _block;
+    uint32_t _prevTimestamp;
+    int32_t _prevDelta;
+    int32_t _prevDistance;
+};
+
+class HistoryDecoder {
+public:
+    explicit HistoryDecoder(const HistoryBlock& block);
+    // Yields samples oldest first; false once the block is exhausted or corrupt.
+    bool next(HistorySample& sample);
+
+private:
+    const HistoryBlock& _block;
+    uint16_t _index;
+    uint16_t _bitPos;
+    uint32_t _prevTimestamp;
+    int32_t _prevDelta;
+    int32_t _prevDistance;
+};
+
+namespace HistoryCodec {
+    int32_t quantize(float distanceCm);
+    float dequantize(int32_t distance);
+    // Structural sanity check for blocks read back from flash.
+    bool isValid(const HistoryBlock& block);
+}
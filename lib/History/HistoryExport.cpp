@@ -0,0 +1,155 @@
+#include "HistoryExport.h"
+#include "GzipStream.h"
+#include "Telemetry.h"
+
+namespace {
+    const size_t ROWS_PER_STEP = 32;
+
+    struct FieldName {
+        uint8_t bit;
+        const char* name;
+    };
+
+    const FieldName FIELD_NAMES[] = {
+        {HistoryExport::FIELD_TIMESTAMP, "timestamp"},
+        {HistoryExport::FIELD_DISTANCE, "distance_cm"},
+        {HistoryExport::FIELD_PERCENT, "percent"},
+        {HistoryExport::FIELD_LEVEL_CM, "level_cm"},
+        {HistoryExport::FIELD_LEVEL_IN, "level_in"},
+        {HistoryExport::FIELD_LITERS, "liters"},
+        {HistoryExport::FIELD_GALLONS, "gallons"},
+    };
+    const size_t FIELD_COUNT = sizeof(FIELD_NAMES) / sizeof(FIELD_NAMES[0]);
+
+    // Value of one field with the precision the CSV log has always used
+    int formatField(char* buf, size_t len, uint8_t bit, uint32_t timestamp, const Telemetry& t) {
+        switch (bit) {
+            case HistoryExport::FIELD_TIMESTAMP: return snprintf(buf, len, "%u", (unsigned)timestamp);
+            case HistoryExport::FIELD_DISTANCE:  return snprintf(buf, len, "%.2f", t.distanceCm);
+            case HistoryExport::FIELD_PERCENT:   return snprintf(buf, len, "%.1f", t.percent);
+            case HistoryExport::FIELD_LEVEL_CM:  return snprintf(buf, len, "%.2f", t.levelCm);
+            case HistoryExport::FIELD_LEVEL_IN:  return snprintf(buf, len, "%.2f", t.levelIn);
+            case HistoryExport::FIELD_LITERS:    return snprintf(buf, len, "%.2f", t.liters);
+            case HistoryExport::FIELD_GALLONS:   return snprintf(buf, len, "%.2f", t.gallons);
+            default:                             return 0;
+        }
+    }
+}
+
+uint8_t HistoryExport::parseFields(const String& list) {
+    uint8_t fields = 0;
+    int start = 0;
+    while (start <= (int)list.length()) {
+        int comma = list.indexOf(',', start);
+        if (comma < 0) comma = list.length();
+        String name = list.substring(start, comma);
+        name.trim();
+        if (name.length() > 0) {
+            uint8_t bit = 0;
+            for (size_t i = 0; i < FIELD_COUNT; ++i) {
+                if (name == FIELD_NAMES[i].name) bit = FIELD_NAMES[i].bit;
+            }
+            if (bit == 0) return 0;
+            fields |= bit;
+        }
+        start = comma + 1;
+    }
+    return fields;
+}
+
+bool HistoryExport::parseCursor(const String& text, HistoryCursor& cursor) {
+    unsigned long block, sample;
+    if (sscanf(text.c_str(), "%lu.%lu", &block, &sample) != 2 || sample > UINT16_MAX) return false;
+    cursor.block = block;
+    cursor.sample = sample;
+    return true;
+}
+
+String HistoryExport::formatCursor(const HistoryCursor& cursor) {
+    return String(cursor.block) + "." + String(cursor.sample);
+}
+
+HistoryExport::HistoryExport(const Config& config, const HistoryCursor& start, const ExportOptions& options)
+    : _config(config), _cursor(start), _options(options), _gzip(nullptr), _pendingPos(0), _sourceDone(false) {
+    if (_options.fields == 0) _options.fields = 0x7F;
+    if (_options.gzip) _gzip = new GzipStream();
+    if (_options.header && _options.format == ExportFormat::CSV) renderHeader();
+}
+
+HistoryExport::~HistoryExport() {
+    delete _gzip;
+}
+
+size_t HistoryExport::fill(uint8_t* buffer, size_t maxLen) {
+    if (!_gzip) {
+        while (_pending.length() - _pendingPos < maxLen && !_sourceDone) renderRows();
+        size_t n = _pending.length() - _pendingPos;
+        if (n > maxLen) n = maxLen;
+        memcpy(buffer, _pending.c_str() + _pendingPos, n);
+        _pendingPos += n;
+        return n;
+    }
+
+    while (_gzip->available() < maxLen && !_gzip->isFinished()) {
+        if (_pendingPos >= _pending.length()) {
+            if (_sourceDone) {
+                if (!_gzip->finish()) break; // drain first, finish on the next call
+            } else {
+                renderRows();
+            }
+            continue;
+        }
+        size_t used = _gzip->write((const uint8_t*)_pending.c_str() + _pendingPos, _pending.length() - _pendingPos);
+        if (used == 0) break; // output buffer full
+        _pendingPos += used;
+    }
+    return _gzip->read(buffer, maxLen);
+}
+
+void HistoryExport::renderHeader() {
+    bool first = true;
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        if (!(_options.fields & FIELD_NAMES[i].bit)) continue;
+        if (!first) _pending += ",";
+        _pending += FIELD_NAMES[i].name;
+        first = false;
+    }
+    _pending += "\n";
+}
+
+void HistoryExport::renderRows() {
+    // Drop what has been sent so the buffer only ever holds one step's rows
+    if (_pendingPos > 0) {
+        _pending.remove(0, _pendingPos);
+        _pendingPos = 0;
+    }
+
+    HistorySample samples[ROWS_PER_STEP];
+    size_t n = HistoryStore::read(_cursor, samples, ROWS_PER_STEP, _options.tank);
+    if (n == 0) _sourceDone = true;
+
+    char line[192];
+    for (size_t i = 0; i < n; ++i) {
+        if (samples[i].timestamp > _options.to) {
+            _sourceDone = true;
+            break;
+        }
+        Telemetry t = Telemetry::compute(_config, samples[i].distanceCm);
+        size_t len = 0;
+        bool first = true;
+        if (_options.format == ExportFormat::NDJSON) line[len++] = '{';
+        for (size_t f = 0; f < FIELD_COUNT; ++f) {
+            if (!(_options.fields & FIELD_NAMES[f].bit)) continue;
+            if (!first) line[len++] = ',';
+            if (_options.format == ExportFormat::NDJSON) {
+                len += snprintf(line + len, sizeof(line) - len, "\"%s\":", FIELD_NAMES[f].name);
+            }
+            len += formatField(line + len, sizeof(line) - len, FIELD_NAMES[f].bit, samples[i].timestamp, t);
+            first = false;
+        }
+        if (_options.format == ExportFormat::NDJSON) line[len++] = '}';
+        line[len++] = '\n';
+        line[len] = '\0';
+        _pending += line;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include "ConfigManager.h"
+#include "HistoryStore.h"
+
+class GzipStream;
+
+enum class ExportFormat : uint8_t {
+    CSV,
+    NDJSON
+};
+
+struct ExportOptions {
+    ExportFormat format = ExportFormat::CSV;
+    uint8_t fields = 0x7F;        // HistoryExport::FIELD_* bits
+    uint32_t to = UINT32_MAX;     // last timestamp included
+    bool gzip = false;
+    bool header = true;           // CSV column names; left out when resuming
+    uint8_t tank = 0;
+};
+
+// Streams a slice of the level history as CSV or NDJSON, optionally gzip
+// compressed, rendering a few dozen rows at a time so memory stays bounded
+// however long the range is. Derived columns use the current tank config,
+// which the caller passes as Config::forTank(options.tank).
+class HistoryExport {
+public:
+    static const uint8_t FIELD_TIMESTAMP = 0x01;
+    static const uint8_t FIELD_DISTANCE  = 0x02;
+    static const uint8_t FIELD_PERCENT   = 0x04;
+    static const uint8_t FIELD_LEVEL_CM  = 0x08;
+    static const uint8_t FIELD_LEVEL_IN  = 0x10;
+    static const uint8_t FIELD_LITERS    = 0x20;
+    static const uint8_t FIELD_GALLONS   = 0x40;
+
+    // "timestamp,percent" -> field bits; 0 if the list is empty or names an unknown field
+    static uint8_t parseFields(const String& list);
+    // Cursors travel as "<block>.<sample>"
+    static bool parseCursor(const String& text, HistoryCursor& cursor);
+    static String formatCursor(const HistoryCursor& cursor);
+
+    HistoryExport(const Config& config, const HistoryCursor& start, const ExportOptions& options);
+    ~HistoryExport();
+
+    // Chunked-response filler: the next part of the body, 0 once it is complete
+    size_t fill(uint8_t* buffer, size_t maxLen);
+
+private:
+    void renderHeader();
+    void renderRows();
+
+    Config _config;
+    HistoryCursor _cursor;
+    ExportOptions _options;
+    GzipStream* _gzip;
+    String _pending;
+    size_t _pendingPos;
+    bool _sourceDone;
+};
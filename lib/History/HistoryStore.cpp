@@ -0,0 +1,646 @@
+#include "HistoryStore.h"
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "Metrics.h"
+#include "HistoryCache.h"
+#include "ConfigManager.h"
+
+namespace {
+    const uint32_t STORE_MAGIC = 0x54534948; // "HIST"
+    const uint16_t STORE_VERSION = 2;
+    // Sealed blocks go into segment files of SEGMENT_BLOCKS blocks, one 4 KB LittleFS
+    // block each. Sealing rewrites at most that one flash block, and the oldest
+    // history is dropped a segment at a time by deleting its file.
+    const uint32_t SEGMENT_BLOCKS = 16;
+    // 512 KB for the primary tank: at one sample a minute a block holds several hours, so
+    // the store spans about a year. Additional tanks get 128 KB each to fit the partition.
+    const uint32_t PRIMARY_BLOCK_COUNT = 2048;
+    const uint32_t EXTRA_BLOCK_COUNT = 512;
+    // Most recent samples kept in RAM: ~12 hours at one a minute, or ~11 days with PSRAM.
+    // Additional tanks keep a quarter of that.
+    const size_t HOT_CAPACITY_INTERNAL = 720;
+    const size_t HOT_CAPACITY_PSRAM = 16384;
+    // Sparse time index: the first timestamp of every INDEX_STRIDE-th block, so a
+    // time seek is a binary search here plus a few block-header reads
+    const uint32_t INDEX_STRIDE = 16;
+    const uint32_t INDEX_SIZE = PRIMARY_BLOCK_COUNT / INDEX_STRIDE;
+
+    struct StoreHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t blockSize;
+        uint32_t blockCount;    // capacity, including the open block
+        uint32_t used;          // blocks stored, including the open one
+        uint32_t sealedSamples; // samples in every block but the open one
+        uint32_t firstBlock;    // number of the oldest block since the store was created
+    };
+
+    SemaphoreHandle_t storeLock = xSemaphoreCreateMutex();
+    struct StoreGuard {
+        StoreGuard() { xSemaphoreTake(storeLock, portMAX_DELAY); }
+        ~StoreGuard() { xSemaphoreGive(storeLock); }
+    };
+
+    // One directory per tank: a small "state" file with the header and the open
+    // block, and the sealed blocks in segment files named by segment number
+    struct Store {
+        char dir[16];
+        uint32_t blockCount;
+        uint32_t indexSize;
+        bool ready = false;
+        StoreHeader header;
+        HistoryBlock openBlock;
+        HistoryEncoder encoder;
+        HistoryCache hotCache;
+        HistorySample* hotBuffer = nullptr;
+        uint32_t timeIndex[INDEX_SIZE]; // block k * INDEX_STRIDE lives at k % indexSize
+        uint32_t newestTimestamp = 0;
+    };
+    Store stores[MAX_TANKS];
+
+    Store& storeFor(uint8_t tank) {
+        Store& s = stores[tank < MAX_TANKS ? tank : 0];
+        if (s.blockCount == 0) {
+            uint8_t index = &s - stores;
+            snprintf(s.dir, sizeof(s.dir), "/history/t%u", index);
+            s.blockCount = index == 0 ? PRIMARY_BLOCK_COUNT : EXTRA_BLOCK_COUNT;
+            s.indexSize = s.blockCount / INDEX_STRIDE;
+        }
+        return s;
+    }
+
+    void statePath(const char* dir, char* out, size_t size) {
+        snprintf(out, size, "%s/state", dir);
+    }
+
+    void segmentPath(const char* dir, uint32_t segment, char* out, size_t size) {
+        snprintf(out, size, "%s/%lu", dir, (unsigned long)segment);
+    }
+
+    bool writeAt(File& f, uint32_t offset, const void* data, size_t len) {
+        return f.seek(offset) && f.write((const uint8_t*)data, len) == len;
+    }
+
+    bool readAt(File& f, uint32_t offset, void* data, size_t len) {
+        return f.seek(offset) && f.read((uint8_t*)data, len) == len;
+    }
+
+    // Reads sealed blocks by number, keeping the segment file of the last one open
+    class SegmentReader {
+    public:
+        explicit SegmentReader(const char* dir) : _dir(dir) {}
+        ~SegmentReader() {
+            if (_file) _file.close();
+        }
+        bool read(uint32_t block, void* out, size_t len) {
+            uint32_t segment = block / SEGMENT_BLOCKS;
+            if (segment != _segment) {
+                if (_file) _file.close();
+                char path[32];
+                segmentPath(_dir, segment, path, sizeof(path));
+                _file = LittleFS.open(path, "r");
+                _segment = segment;
+            }
+            return _file && readAt(_file, (block % SEGMENT_BLOCKS) * HISTORY_BLOCK_SIZE, out, len);
+        }
+
+    private:
+        const char* _dir;
+        File _file;
+        uint32_t _segment = UINT32_MAX;
+    };
+
+    // The header and the open block. LittleFS commits a file when it is closed, so a
+    // power cut leaves either the previous state or this one.
+    bool writeState(const Store& s) {
+        char path[32];
+        statePath(s.dir, path, sizeof(path));
+        File f = LittleFS.open(path, "w");
+        if (!f) return false;
+        bool ok = f.write((const uint8_t*)&s.header, sizeof(s.header)) == sizeof(s.header) &&
+                  f.write((const uint8_t*)&s.openBlock, sizeof(s.openBlock)) == sizeof(s.openBlock);
+        f.close();
+        return ok;
+    }
+
+    bool writeSealed(const Store& s, uint32_t block, const HistoryBlock& data) {
+        char path[32];
+        segmentPath(s.dir, block / SEGMENT_BLOCKS, path, sizeof(path));
+        uint32_t offset = (block % SEGMENT_BLOCKS) * HISTORY_BLOCK_SIZE;
+        // A segment's first block truncates whatever a crash left under that name; a
+        // block sealed again after a crash lands on its earlier copy
+        File f = offset == 0 || !LittleFS.exists(path) ? LittleFS.open(path, "w") : LittleFS.open(path, "r+");
+        if (!f) return false;
+        bool ok = writeAt(f, offset, &data, sizeof(data));
+        f.close();
+        return ok;
+    }
+
+    // Deletes the segment files outside [first, last]; first > last deletes them all
+    void pruneSegments(const char* dir, uint32_t first, uint32_t last) {
+        for (;;) {
+            char stale[8][32];
+            uint8_t n = 0;
+            File d = LittleFS.open(dir);
+            if (!d || !d.isDirectory()) return;
+            for (File f = d.openNextFile(); f && n < 8; f = d.openNextFile()) {
+                const char* name = strrchr(f.name(), '/');
+                name = name ? name + 1 : f.name();
+                char* end;
+                unsigned long segment = strtoul(name, &end, 10);
+                if (end == name || *end != '\0') continue; // the state file
+                if (first <= last && segment >= first && segment <= last) continue;
+                segmentPath(dir, segment, stale[n++], sizeof(stale[0]));
+            }
+            d.close();
+            if (n == 0) return;
+            for (uint8_t i = 0; i < n; ++i) {
+                if (!LittleFS.remove(stale[i])) return; // would be listed again forever
+            }
+        }
+    }
+
+    void pruneSegments(const Store& s) {
+        const StoreHeader& h = s.header;
+        pruneSegments(s.dir, h.firstBlock / SEGMENT_BLOCKS, (h.firstBlock + h.used - 1) / SEGMENT_BLOCKS);
+    }
+
+    bool create(Store& s) {
+        s.header.magic = STORE_MAGIC;
+        s.header.version = STORE_VERSION;
+        s.header.blockSize = HISTORY_BLOCK_SIZE;
+        s.header.blockCount = s.blockCount;
+        s.header.used = 1;
+        s.header.sealedSamples = 0;
+        s.header.firstBlock = 0;
+        s.encoder.begin(&s.openBlock);
+        LittleFS.mkdir("/history");
+        LittleFS.mkdir(s.dir);
+        pruneSegments(s.dir, 1, 0);
+        return writeState(s);
+    }
+
+    bool load(Store& s) {
+        char path[32];
+        statePath(s.dir, path, sizeof(path));
+        File f = LittleFS.open(path, "r");
+        if (!f) return false;
+        StoreHeader& h = s.header;
+        bool ok = readAt(f, 0, &h, sizeof(h)) && h.magic == STORE_MAGIC &&
+                  h.version == STORE_VERSION && h.blockSize == HISTORY_BLOCK_SIZE &&
+                  h.blockCount == s.blockCount && h.used >= 1 && h.used <= h.blockCount &&
+                  h.firstBlock % SEGMENT_BLOCKS == 0 &&
+                  readAt(f, sizeof(h), &s.openBlock, sizeof(s.openBlock));
+        f.close();
+        if (!ok) return false;
+        if (!s.encoder.resume(&s.openBlock)) {
+            Serial.printf("[HISTORY] Open block of %s was corrupt, restarted it\n", s.dir);
+        }
+        pruneSegments(s); // a segment dropped just before a power cut
+        return true;
+    }
+
+    // Copies the `count` samples that precede the newest `skipNewest` ones, oldest first.
+    // Sealed blocks are read without the lock.
+    size_t readFromFlash(const char* dir, const StoreHeader& snapshot, const HistoryBlock& open,
+                         HistorySample* out, size_t count, size_t skipNewest) {
+        if (snapshot.used == 0 || count == 0) return 0;
+        SegmentReader reader(dir);
+
+        // Walk back over block headers until enough samples are covered
+        size_t wanted = count + skipNewest;
+        uint32_t first = snapshot.used - 1;
+        size_t covered = open.count;
+        while (covered < wanted && first > 0) {
+            HistoryBlock prev;
+            if (!reader.read(snapshot.firstBlock + first - 1, &prev, HISTORY_HEADER_SIZE)) break;
+            covered += prev.count;
+            first--;
+        }
+        if (covered <= skipNewest) return 0;
+
+        size_t skip = covered > wanted ? covered - wanted : 0;
+        size_t limit = covered - skipNewest - skip < count ? covered - skipNewest - skip : count;
+        size_t n = 0;
+        HistoryBlock* block = new HistoryBlock;
+        for (uint32_t i = first; i < snapshot.used && n < limit; ++i) {
+            if (i == snapshot.used - 1) {
+                *block = open;
+            } else if (!reader.read(snapshot.firstBlock + i, block, sizeof(HistoryBlock)) ||
+                       !HistoryCodec::isValid(*block)) {
+                continue;
+            }
+            HistoryDecoder decoder(*block);
+            HistorySample sample;
+            while (n < limit && decoder.next(sample)) {
+                if (skip > 0) {
+                    skip--;
+                    continue;
+                }
+                out[n++] = sample;
+            }
+        }
+        delete block;
+        return n;
+    }
+
+    // Header fields of block number `block`; the open block comes from its RAM copy
+    bool readBlockHeader(SegmentReader& reader, const StoreHeader& snapshot, const HistoryBlock& open,
+                         uint32_t block, HistoryBlock& out) {
+        if (block - snapshot.firstBlock == snapshot.used - 1) {
+            memcpy(&out, &open, HISTORY_HEADER_SIZE);
+            return true;
+        }
+        return reader.read(block, &out, HISTORY_HEADER_SIZE);
+    }
+
+    void indexOpenBlock(Store& s) {
+        uint32_t block = s.header.firstBlock + s.header.used - 1;
+        if (block % INDEX_STRIDE == 0) {
+            s.timeIndex[(block / INDEX_STRIDE) % s.indexSize] = s.openBlock.firstTimestamp;
+        }
+    }
+
+    // Rebuilds the time index and the newest timestamp from the block headers
+    void buildIndex(Store& s) {
+        SegmentReader reader(s.dir);
+        uint32_t end = s.header.firstBlock + s.header.used;
+        HistoryBlock block;
+        for (uint32_t b = (s.header.firstBlock + INDEX_STRIDE - 1) / INDEX_STRIDE * INDEX_STRIDE; b < end; b += INDEX_STRIDE) {
+            if (readBlockHeader(reader, s.header, s.openBlock, b, block)) {
+                s.timeIndex[(b / INDEX_STRIDE) % s.indexSize] = block.firstTimestamp;
+            }
+        }
+        s.newestTimestamp = 0;
+        if (s.openBlock.count > 0) {
+            s.newestTimestamp = s.openBlock.lastTimestamp;
+        } else if (s.header.used > 1 && readBlockHeader(reader, s.header, s.openBlock, end - 2, block)) {
+            s.newestTimestamp = block.lastTimestamp;
+        }
+    }
+
+    // Range of blocks [lo, hi) that holds the last sample before `timestamp`, from the
+    // sparse index. Searched in place under the lock rather than copied out.
+    void narrowWithIndex(const Store& s, uint32_t timestamp, uint32_t& lo, uint32_t& hi) {
+        const StoreHeader& h = s.header;
+        uint32_t end = h.firstBlock + h.used;
+        if (s.openBlock.count == 0) end--; // the open block has no samples (and no index entry) yet
+        lo = h.firstBlock;
+        hi = end;
+        int32_t kLo = (h.firstBlock + INDEX_STRIDE - 1) / INDEX_STRIDE;
+        int32_t kHi = end > 0 ? (int32_t)((end - 1) / INDEX_STRIDE) : -1;
+        while (kLo <= kHi) {
+            int32_t mid = kLo + (kHi - kLo) / 2;
+            if (s.timeIndex[mid % s.indexSize] <= timestamp) {
+                lo = mid * INDEX_STRIDE;
+                kLo = mid + 1;
+            } else {
+                hi = mid * INDEX_STRIDE;
+                kHi = mid - 1;
+            }
+        }
+    }
+
+    // Gives the hot tier its buffer (once) and back-fills it with the newest stored samples
+    void fillHotCache(Store& s) {
+        bool primary = &s == stores;
+        size_t capacity = s.hotCache.capacity();
+        if (!s.hotBuffer) {
+            if (psramFound()) {
+                capacity = primary ? HOT_CAPACITY_PSRAM : HOT_CAPACITY_PSRAM / 4;
+                s.hotBuffer = (HistorySample*)ps_malloc(capacity * sizeof(HistorySample));
+            }
+            if (!s.hotBuffer) {
+                capacity = primary ? HOT_CAPACITY_INTERNAL : HOT_CAPACITY_INTERNAL / 4;
+                s.hotBuffer = (HistorySample*)malloc(capacity * sizeof(HistorySample));
+            }
+            if (!s.hotBuffer) capacity = 0;
+        }
+        size_t filled = readFromFlash(s.dir, s.header, s.openBlock, s.hotBuffer, capacity, 0);
+        s.hotCache.attach(s.hotBuffer, capacity, filled);
+        Serial.printf("[HISTORY] Hot tier of %s holds %u of %u samples\n", s.dir, (unsigned)filled, (unsigned)capacity);
+    }
+
+    // Totals across every tank's store
+    void publishMetrics() {
+        uint32_t samples = 0;
+        uint32_t blocks = 0;
+        size_t capacity = 0;
+        for (uint8_t i = 0; i < MAX_TANKS; ++i) {
+            if (!stores[i].ready) continue;
+            samples += stores[i].header.sealedSamples + stores[i].openBlock.count;
+            blocks += stores[i].header.used;
+            capacity += stores[i].hotCache.capacity();
+        }
+        Metrics::set("history_samples", samples);
+        Metrics::set("history_blocks", blocks);
+        Metrics::set("history_cache_capacity", capacity);
+    }
+}
+
+bool HistoryStore::begin(uint8_t tank) {
+    StoreGuard guard;
+    Store& s = storeFor(tank);
+    if (s.ready) return true;
+    s.ready = load(s);
+    if (!s.ready) {
+        Serial.println("[HISTORY] No valid store, creating " + String(s.dir));
+        s.ready = create(s);
+    }
+    if (s.ready) {
+        buildIndex(s);
+        fillHotCache(s);
+        publishMetrics();
+    }
+    return s.ready;
+}
+
+bool HistoryStore::append(uint32_t timestamp, float distanceCm, uint8_t tank) {
+    StoreGuard guard;
+    Store& s = storeFor(tank);
+    if (!s.ready) return false;
+    // Blocks must stay in time order for seeks, so a clock step backwards is clamped
+    if (timestamp < s.newestTimestamp) timestamp = s.newestTimestamp;
+    s.newestTimestamp = timestamp;
+    HistorySample sample = { timestamp, distanceCm };
+    s.hotCache.push(sample);
+    if (s.encoder.append(timestamp, distanceCm)) {
+        if (s.openBlock.count == 1) indexOpenBlock(s);
+        return writeState(s);
+    }
+
+    // The open block is full: seal it into its segment and start the next block.
+    // If sealing fails the state is left alone and the next append tries again.
+    StoreHeader& h = s.header;
+    if (!writeSealed(s, h.firstBlock + h.used - 1, s.openBlock)) return false;
+    h.sealedSamples += s.openBlock.count;
+    h.used++;
+    uint32_t dropped = UINT32_MAX;
+    if (h.used > h.blockCount) {
+        // Full: the oldest segment goes, once the new state no longer refers to it
+        dropped = h.firstBlock / SEGMENT_BLOCKS;
+        SegmentReader reader(s.dir);
+        HistoryBlock oldest;
+        for (uint32_t b = h.firstBlock; b < h.firstBlock + SEGMENT_BLOCKS; ++b) {
+            if (!reader.read(b, &oldest, HISTORY_HEADER_SIZE)) continue;
+            h.sealedSamples -= oldest.count < h.sealedSamples ? oldest.count : h.sealedSamples;
+        }
+        h.firstBlock += SEGMENT_BLOCKS;
+        h.used -= SEGMENT_BLOCKS;
+    }
+    s.encoder.begin(&s.openBlock);
+    s.encoder.append(timestamp, distanceCm);
+    indexOpenBlock(s);
+    publishMetrics();
+    bool ok = writeState(s);
+    if (ok && dropped != UINT32_MAX) {
+        char path[32];
+        segmentPath(s.dir, dropped, path, sizeof(path));
+        LittleFS.remove(path);
+    }
+    return ok;
+}
+
+size_t HistoryStore::read(HistoryCursor& cursor, HistorySample* out, size_t max, uint8_t tank) {
+    StoreHeader snapshot;
+    HistoryBlock* open = new HistoryBlock;
+    HistoryBlock* block = new HistoryBlock;
+    const char* dir;
+    {
+        StoreGuard guard;
+        Store& s = storeFor(tank);
+        snapshot = s.header;
+        *open = s.openBlock;
+        dir = s.dir;
+        if (!s.ready) snapshot.used = 0;
+    }
+    if (cursor.block < snapshot.firstBlock) {
+        cursor.block = snapshot.firstBlock;
+        cursor.sample = 0;
+    }
+
+    // Sealed blocks are read without the lock; only the open block changes under it
+    SegmentReader reader(dir);
+    size_t n = 0;
+    while (n < max && cursor.block - snapshot.firstBlock < snapshot.used) {
+        uint32_t i = cursor.block - snapshot.firstBlock;
+        bool isOpen = i == snapshot.used - 1;
+        if (isOpen) {
+            *block = *open;
+        } else if (!reader.read(cursor.block, block, sizeof(HistoryBlock)) || !HistoryCodec::isValid(*block)) {
+            cursor.block++;
+            cursor.sample = 0;
+            continue;
+        }
+        HistoryDecoder decoder(*block);
+        HistorySample sample;
+        uint16_t index = 0;
+        while (n < max && decoder.next(sample)) {
+            if (index++ < cursor.sample) continue;
+            out[n++] = sample;
+            cursor.sample++;
+        }
+        if (n < max) {
+            if (isOpen) break; // caught up with the newest sample
+            cursor.block++;
+            cursor.sample = 0;
+        }
+    }
+    delete open;
+    delete block;
+    return n;
+}
+
+void HistoryStore::skip(HistoryCursor& cursor, uint32_t count, uint8_t tank) {
+    StoreHeader snapshot;
+    HistoryBlock* open = new HistoryBlock;
+    const char* dir;
+    {
+        StoreGuard guard;
+        Store& s = storeFor(tank);
+        snapshot = s.header;
+        *open = s.openBlock;
+        dir = s.dir;
+        if (!s.ready) snapshot.used = 0;
+    }
+    if (cursor.block < snapshot.firstBlock) {
+        cursor.block = snapshot.firstBlock;
+        cursor.sample = 0;
+    }
+    SegmentReader reader(dir);
+    HistoryBlock block;
+    while (count > 0 && cursor.block - snapshot.firstBlock < snapshot.used) {
+        if (!readBlockHeader(reader, snapshot, *open, cursor.block, block)) break;
+        uint32_t remaining = block.count > cursor.sample ? block.count - cursor.sample : 0;
+        if (count < remaining) {
+            cursor.sample += count;
+            break;
+        }
+        if (cursor.block - snapshot.firstBlock == snapshot.used - 1) {
+            cursor.sample = block.count; // stop at the newest sample
+            break;
+        }
+        count -= remaining;
+        cursor.block++;
+        cursor.sample = 0;
+    }
+    delete open;
+}
+
+HistoryCursor HistoryStore::seek(uint32_t timestamp, uint8_t tank) {
+    StoreHeader snapshot;
+    HistoryBlock* open = new HistoryBlock;
+    const char* dir;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    {
+        StoreGuard guard;
+        Store& s = storeFor(tank);
+        snapshot = s.header;
+        *open = s.openBlock;
+        dir = s.dir;
+        if (!s.ready) snapshot.used = 0;
+        if (snapshot.used > 0) narrowWithIndex(s, timestamp, lo, hi);
+    }
+    HistoryCursor cursor;
+    cursor.block = snapshot.firstBlock;
+    if (snapshot.used == 0) {
+        delete open;
+        return cursor;
+    }
+
+    // Binary-search the block headers inside the stride the index picked
+    SegmentReader reader(dir);
+    HistoryBlock* block = new HistoryBlock;
+    uint32_t found = lo;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (!readBlockHeader(reader, snapshot, *open, mid, *block) || block->firstTimestamp <= timestamp) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // Finally find the first sample at or after `timestamp` inside that block
+    cursor.block = found;
+    uint32_t i = found - snapshot.firstBlock;
+    bool loaded = false;
+    if (i == snapshot.used - 1) {
+        *block = *open;
+        loaded = true;
+    } else if (i < snapshot.used) {
+        loaded = reader.read(found, block, sizeof(HistoryBlock)) && HistoryCodec::isValid(*block);
+    }
+    if (loaded) {
+        HistoryDecoder decoder(*block);
+        HistorySample sample;
+        bool reached = false;
+        while (decoder.next(sample)) {
+            if (sample.timestamp >= timestamp) {
+                reached = true;
+                break;
+            }
+            cursor.sample++;
+        }
+        if (!reached && i < snapshot.used - 1) {
+            cursor.block++;
+            cursor.sample = 0;
+        }
+    }
+    delete block;
+    delete open;
+    return cursor;
+}
+
+size_t HistoryStore::readRange(uint32_t from, uint32_t to, HistorySample* out, size_t max, uint8_t tank) {
+    {
+        StoreGuard guard;
+        Store& s = storeFor(tank);
+        if (!s.ready) return 0;
+        if (s.hotCache.covers(from)) {
+            Metrics::increment("history_cache_hits");
+            return s.hotCache.copyRange(from, to, out, max);
+        }
+    }
+    Metrics::increment("history_cache_misses");
+    HistoryCursor cursor = seek(from, tank);
+    size_t n = 0;
+    bool past = false;
+    while (n < max && !past) {
+        size_t got = read(cursor, out + n, max - n, tank);
+        if (got == 0) break;
+        size_t end = n + got;
+        for (size_t i = n; i < end; ++i) {
+            if (out[i].timestamp > to) {
+                past = true;
+                break;
+            }
+            if (out[i].timestamp >= from) out[n++] = out[i];
+        }
+    }
+    return n;
+}
+
+size_t HistoryStore::readLast(HistorySample* out, size_t count, uint8_t tank) {
+    if (count == 0) return 0;
+    StoreHeader snapshot;
+    HistoryBlock* open = new HistoryBlock;
+    const char* dir;
+    size_t cached;
+    {
+        StoreGuard guard;
+        Store& s = storeFor(tank);
+        if (!s.ready) {
+            delete open;
+            return 0;
+        }
+        cached = s.hotCache.size();
+        if (count <= cached || s.header.sealedSamples + s.openBlock.count <= cached) {
+            Metrics::increment("history_cache_hits");
+            delete open;
+            return s.hotCache.copyLast(out, count);
+        }
+        // The newest part comes from RAM, only the rest is read from flash
+        snapshot = s.header;
+        *open = s.openBlock;
+        dir = s.dir;
+        cached = s.hotCache.copyLast(out + (count - cached), cached);
+    }
+    Metrics::increment("history_cache_misses");
+    size_t older = count - cached;
+    size_t n = readFromFlash(dir, snapshot, *open, out, older, cached);
+    delete open;
+    if (n < older) {
+        memmove(out + n, out + older, cached * sizeof(HistorySample));
+    }
+    return n + cached;
+}
+
+void HistoryStore::clear(uint8_t tank) {
+    StoreGuard guard;
+    Store& s = storeFor(tank);
+    s.hotCache.clear();
+    s.newestTimestamp = 0;
+    s.ready = create(s);
+    publishMetrics();
+}
+
+uint32_t HistoryStore::sampleCount(uint8_t tank) {
+    StoreGuard guard;
+    Store& s = storeFor(tank);
+    return s.ready ? s.header.sealedSamples + s.openBlock.count : 0;
+}
+
+uint32_t HistoryStore::bytesUsed(uint8_t tank) {
+    StoreGuard guard;
+    Store& s = storeFor(tank);
+    return s.ready ? sizeof(StoreHeader) + s.header.used * HISTORY_BLOCK_SIZE : 0;
+}
+
+uint32_t HistoryStore::lastTimestamp(uint8_t tank) {
+    StoreGuard guard;
+    return storeFor(tank).newestTimestamp;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include "HistoryCodec.h"
+
+// Position in the store for incremental reads. Blocks are numbered from the
+// first one ever written, so a cursor stays valid while the ring wraps.
+struct HistoryCursor {
+    uint32_t block = 0;
+    uint16_t sample = 0;
+};
+
+// Level history on LittleFS, one directory per tank (/history/t<n>). Sealed
+// blocks are appended to 4 KB segment files named by their first block number;
+// the block being filled lives in RAM and is saved with the header in a small
+// `state` file, so an append never rewrites more than one segment block. When
+// the store is full the oldest segment file is deleted. Timestamps are epoch
+// seconds and never decrease.
+class HistoryStore {
+public:
+    static bool begin(uint8_t tank = 0);
+    static bool append(uint32_t timestamp, float distanceCm, uint8_t tank = 0);
+    // Copies up to `max` samples from the cursor onwards into `out`, oldest first,
+    // and advances the cursor. A cursor that has been overwritten skips to the
+    // oldest block still stored. Returns 0 once the newest sample has been read.
+    static size_t read(HistoryCursor& cursor, HistorySample* out, size_t max, uint8_t tank = 0);
+    // Moves the cursor `count` samples forward, reading only block headers for whole blocks
+    static void skip(HistoryCursor& cursor, uint32_t count, uint8_t tank = 0);
+    // Cursor at the first sample at or after `timestamp`, found with the sparse time index
+    static HistoryCursor seek(uint32_t timestamp, uint8_t tank = 0);
+    // Samples with from <= timestamp <= to, oldest first, at most `max`
+    static size_t readRange(uint32_t from, uint32_t to, HistorySample* out, size_t max, uint8_t tank = 0);
+    // Copies the newest `count` samples into `out`, oldest first; returns how many were copied
+    static size_t readLast(HistorySample* out, size_t count, uint8_t tank = 0);
+    static void clear(uint8_t tank = 0);
+
+    static uint32_t sampleCount(uint8_t tank = 0);
+    static uint32_t lastTimestamp(uint8_t tank = 0);
+    static uint32_t bytesUsed(uint8_t tank = 0);
+};
@@ -0,0 +1,144 @@
+#include "JobQueue.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+namespace {
+    const uint8_t QUEUE_DEPTH = 8;
+    const uint8_t STATUS_SLOTS = 16;        // recent jobs kept for /api/jobs
+    const uint32_t WORKER_STACK = 6144;     // bytes; config commits build Strings
+    const UBaseType_t WORKER_PRIORITY = 1;  // same as loopTask
+
+    struct Job {
+        JobId id;
+        JobFunction work;
+    };
+
+    struct JobRecord {
+        JobId id;
+        const char* name;
+        JobStatus status;
+        unsigned long submittedAt;
+        unsigned long finishedAt;
+    };
+
+    QueueHandle_t queue = nullptr;
+    portMUX_TYPE jobsMux = portMUX_INITIALIZER_UNLOCKED;
+    JobRecord records[STATUS_SLOTS];
+    JobId nextId = 1;
+
+    // Caller holds jobsMux
+    JobRecord* findRecord(JobId id) {
+        if (id == JobQueue::INVALID_JOB) return nullptr;
+        JobRecord& r = records[id % STATUS_SLOTS];
+        return r.id == id ? &r : nullptr;
+    }
+
+    void setStatus(JobId id, JobStatus status) {
+        portENTER_CRITICAL(&jobsMux);
+        JobRecord* r = findRecord(id);
+        if (r) {
+            r->status = status;
+            if (status == JobStatus::DONE || status == JobStatus::FAILED) r->finishedAt = millis();
+        }
+        portEXIT_CRITICAL(&jobsMux);
+    }
+
+    String recordJson(const JobRecord& r) {
+        String json = "{\"id\":" + String(r.id);
+        json += ",\"name\":\"" + String(r.name) + "\"";
+        json += ",\"status\":\"" + String(JobQueue::statusName(r.status)) + "\"";
+        json += ",\"age_ms\":" + String(millis() - r.submittedAt);
+        if (r.finishedAt) json += ",\"duration_ms\":" + String(r.finishedAt - r.submittedAt);
+        json += "}";
+        return json;
+    }
+
+    void workerTask(void*) {
+        for (;;) {
+            Job* job = nullptr;
+            if (xQueueReceive(queue, &job, portMAX_DELAY) != pdTRUE || !job) continue;
+            setStatus(job->id, JobStatus::RUNNING);
+            bool ok = job->work();
+            setStatus(job->id, ok ? JobStatus::DONE : JobStatus::FAILED);
+            delete job;
+        }
+    }
+}
+
+void JobQueue::begin() {
+    if (queue) return;
+    queue = xQueueCreate(QUEUE_DEPTH, sizeof(Job*));
+    xTaskCreate(workerTask, "jobs", WORKER_STACK, nullptr, WORKER_PRIORITY, nullptr);
+}
+
+JobId JobQueue::submit(const char* name, JobFunction work) {
+    if (!queue) return INVALID_JOB;
+    Job* job = new Job();
+    job->work = work;
+
+    portENTER_CRITICAL(&jobsMux);
+    JobId id = nextId++;
+    if (nextId == INVALID_JOB) nextId = 1;
+    job->id = id;
+    JobRecord& r = records[id % STATUS_SLOTS];
+    r.id = id;
+    r.name = name;
+    r.status = JobStatus::QUEUED;
+    r.submittedAt = millis();
+    r.finishedAt = 0;
+    portEXIT_CRITICAL(&jobsMux);
+
+    // The worker owns the job once it is queued
+    if (xQueueSend(queue, &job, 0) != pdTRUE) {
+        setStatus(id, JobStatus::FAILED);
+        Serial.printf("[JOBS] Queue full, dropped job '%s'\n", name);
+        delete job;
+        return INVALID_JOB;
+    }
+    return id;
+}
+
+JobStatus JobQueue::status(JobId id) {
+    portENTER_CRITICAL(&jobsMux);
+    JobRecord* r = findRecord(id);
+    JobStatus s = r ? r->status : JobStatus::UNKNOWN;
+    portEXIT_CRITICAL(&jobsMux);
+    return s;
+}
+
+const char* JobQueue::statusName(JobStatus status) {
+    switch (status) {
+        case JobStatus::QUEUED:  return "queued";
+        case JobStatus::RUNNING: return "running";
+        case JobStatus::DONE:    return "done";
+        case JobStatus::FAILED:  return "failed";
+        default:                 return "unknown";
+    }
+}
+
+String JobQueue::toJson(JobId id) {
+    portENTER_CRITICAL(&jobsMux);
+    JobRecord* found = findRecord(id);
+    JobRecord r = found ? *found : JobRecord();
+    portEXIT_CRITICAL(&jobsMux);
+    return found ? recordJson(r) : String();
+}
+
+String JobQueue::listJson() {
+    JobRecord snapshot[STATUS_SLOTS];
+    portENTER_CRITICAL(&jobsMux);
+    memcpy(snapshot, records, sizeof(records));
+    portEXIT_CRITICAL(&jobsMux);
+
+    String json = "[";
+    bool first = true;
+    for (uint8_t i = 0; i < STATUS_SLOTS; ++i) {
+        if (snapshot[i].id == INVALID_JOB) continue;
+        if (!first) json += ",";
+        json += recordJson(snapshot[i]);
+        first = false;
+    }
+    json += "]";
+    return json;
+}
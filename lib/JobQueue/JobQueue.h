@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+typedef uint32_t JobId;
+typedef std::function<bool()> JobFunction; // returns false on failure
+
+enum class JobStatus : uint8_t {
+    QUEUED,
+    RUNNING,
+    DONE,
+    FAILED,
+    UNKNOWN // never submitted, or evicted from the status table
+};
+
+// Runs slow work (NVS commits, restarts, file I/O) on a dedicated worker task so
+// web handlers can respond immediately. Jobs execute one at a time in submit order.
+class JobQueue {
+public:
+    static const JobId INVALID_JOB = 0;
+
+    static void begin();
+    // Returns INVALID_JOB if the queue is full. name must be a string literal.
+    static JobId submit(const char* name, JobFunction work);
+    static JobStatus status(JobId id);
+    static const char* statusName(JobStatus status);
+
+    static String toJson(JobId id); // empty string if unknown
+    static String listJson();
+};
@@ -1,20 +1,51 @@
 #include "LogManager.h"
 #include <LittleFS.h>
+#include "HistoryStore.h"
 
-void LogManager::initLogFile() {
-    if (!LittleFS.exists("/level_log.csv")) {
-        File f = LittleFS.open("/level_log.csv", "w");
-        if (f) {
-            f.println("timestamp,distance_cm,percent,level_cm,level_in,liters,gallons");
-            f.close();
+volatile uint32_t LogManager::_generation = 0;
+
+namespace {
+    const char* LEGACY_LOG_PATH = "/level_log.csv";
+
+    // Moves rows from the old seven-column CSV log into the history store
+    void importLegacyLog() {
+        File f = LittleFS.open(LEGACY_LOG_PATH, "r");
+        if (!f) return;
+        uint32_t imported = 0;
+        f.readStringUntil('\n'); // Skip header
+        while (f.available()) {
+            String line = f.readStringUntil('\n');
+            unsigned long timestamp;
+            float distance;
+            if (sscanf(line.c_str(), "%lu,%f", &timestamp, &distance) == 2 &&
+                HistoryStore::append(timestamp, distance)) {
+                imported++;
+            }
         }
+        f.close();
+        LittleFS.remove(LEGACY_LOG_PATH);
+        Serial.printf("[HISTORY] Imported %u rows from %s\n", (unsigned)imported, LEGACY_LOG_PATH);
     }
 }
 
-void LogManager::logLevelReading(unsigned long timestamp, float distance, float percent, float levelCm, float levelIn, float liters, float gallons) {
-    File f = LittleFS.open("/level_log.csv", "a");
-    if (f) {
-        f.printf("%lu,%.2f,%.1f,%.2f,%.2f,%.2f,%.2f\n", timestamp, distance, percent, levelCm, levelIn, liters, gallons);
-        f.close();
+void LogManager::initLogFile() {
+    if (!HistoryStore::begin()) {
+        Serial.println("[HISTORY] Failed to open history store");
+        return;
+    }
+    if (LittleFS.exists(LEGACY_LOG_PATH)) {
+        importLegacyLog();
     }
-} 
\ No newline at end of file
+}
+
+void LogManager::logLevelReading(unsigned long timestamp, float distance, uint8_t tank) {
+    // Additional tanks get their store on first use
+    if (tank > 0 && !HistoryStore::begin(tank)) return;
+    if (HistoryStore::append(timestamp, distance, tank)) {
+        _generation++;
+    }
+}
+
+uint32_t LogManager::generation() {
+    return _generation;
+}
@@ -3,6 +3,13 @@
 
 class LogManager {
 public:
+    // Opens the history store, importing a legacy /level_log.csv once
     static void initLogFile();
-    static void logLevelReading(unsigned long timestamp, float distance, float percent, float levelCm, float levelIn, float liters, float gallons);
-}; 
\ No newline at end of file
+    // Only the distance is stored; level, percent and volume are derived when the history is read
+    static void logLevelReading(unsigned long timestamp, float distance, uint8_t tank = 0);
+    // Incremented on every append, so readers can tell when the log changed
+    static uint32_t generation();
+
+private:
+    static volatile uint32_t _generation;
+};
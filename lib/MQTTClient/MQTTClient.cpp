@@ -3,6 +3,10 @@
 #include <WiFi.h>
 
 namespace {
+    // Attempts run on the loop task, so a missing broker must fail fast
+    const int32_t CONNECT_TIMEOUT_MS = 1500;
+    const uint16_t SOCKET_TIMEOUT_S = 2; // CONNACK and other broker replies
+
     WiFiClient wifiClient;
     PubSubClient mqttClient(wifiClient);
 }
@@ -17,18 +21,46 @@ bool MQTTClient::connect(const Config& config) {
     _user = config.mqttUser;
     _password = config.mqttPassword;
     _clientId = "ESP32-" + String((uint32_t)ESP.getEfuseMac(), HEX);
+    _address = IPAddress();
+    _retryMs = RETRY_MIN;
 
-    mqttClient.setServer(_server.c_str(), _port);
+    mqttClient.setBufferSize(1024); // room for batched and JSON payloads
+    mqttClient.setSocketTimeout(SOCKET_TIMEOUT_S);
 
     if (mqttClient.connected())
         return true;
 
-    // Try to connect (short-circuit if no server)
-    return (!_server.isEmpty() && mqttClient.connect(
-        _clientId.c_str(),
-        _user.isEmpty() ? nullptr : _user.c_str(),
-        _password.isEmpty() ? nullptr : _password.c_str()
-    ));
+    return attemptConnect();
+}
+
+bool MQTTClient::attemptConnect() {
+    _lastAttempt = millis();
+    if (_server.isEmpty()) return false;
+
+    // DNS blocks too, so the name is resolved once and again only after a failure
+    if ((uint32_t)_address == 0) {
+        IPAddress resolved;
+        if (resolved.fromString(_server) || WiFi.hostByName(_server.c_str(), resolved)) {
+            _address = resolved;
+            mqttClient.setServer(_address, _port);
+        }
+    }
+
+    // PubSubClient reuses an already open socket, which lets the TCP connect be bounded
+    bool ok = (uint32_t)_address != 0 &&
+              (wifiClient.connected() || wifiClient.connect(_address, _port, CONNECT_TIMEOUT_MS)) &&
+              mqttClient.connect(
+                  _clientId.c_str(),
+                  _user.isEmpty() ? nullptr : _user.c_str(),
+                  _password.isEmpty() ? nullptr : _password.c_str());
+    if (ok) {
+        _retryMs = RETRY_MIN;
+    } else {
+        wifiClient.stop();
+        _address = IPAddress();
+        _retryMs = _retryMs * 2 > RETRY_MAX ? RETRY_MAX : _retryMs * 2;
+    }
+    return ok;
 }
 
 bool MQTTClient::publish(const String& topic, const String& payload) {
@@ -36,7 +68,15 @@ bool MQTTClient::publish(const String& topic, const String& payload) {
 }
 
 void MQTTClient::loop() {
-    mqttClient.loop();
+    if (mqttClient.connected()) {
+        mqttClient.loop();
+    } else if (!_server.isEmpty() && millis() - _lastAttempt >= _retryMs) {
+        if (attemptConnect()) Serial.println("[MQTT] Reconnected to MQTT broker.");
+    }
+}
+
+void MQTTClient::disconnect() {
+    mqttClient.disconnect();
 }
 
 bool MQTTClient::isConnected() const {
@@ -1,5 +1,6 @@
 #pragma once
 #include <WString.h>
+#include <IPAddress.h>
 #include "ConfigManager.h"
 
 class MQTTClient {
@@ -7,7 +8,10 @@ public:
     MQTTClient();
     bool connect(const Config& config);
     bool publish(const String& topic, const String& payload);
+    // Services the connection and retries a dropped one, backing off from
+    // RETRY_MIN to RETRY_MAX ms while the broker stays unreachable
     void loop();
+    void disconnect();
     bool isConnected() const;
 private:
     String _server;
@@ -15,4 +19,12 @@ private:
     String _user;
     String _password;
     String _clientId;
+    IPAddress _address;               // resolved broker, cleared after a failed attempt
+    unsigned long _lastAttempt = 0;
+    unsigned long _retryMs = RETRY_MIN;
+
+    static const unsigned long RETRY_MIN = 5000;
+    static const unsigned long RETRY_MAX = 300000;
+
+    bool attemptConnect();
 };
@@ -0,0 +1,67 @@
+#include "Metrics.h"
+#include <Arduino.h>
+#include <string.h>
+
+namespace {
+    struct Metric {
+        const char* name;
+        int32_t value;
+    };
+
+    const uint8_t MAX_METRICS = 64;
+
+    portMUX_TYPE metricsMux = portMUX_INITIALIZER_UNLOCKED;
+    Metric metrics[MAX_METRICS];
+    uint8_t metricCount = 0;
+
+    // Caller holds metricsMux
+    Metric* find(const char* name, bool create) {
+        for (uint8_t i = 0; i < metricCount; ++i) {
+            if (metrics[i].name == name || strcmp(metrics[i].name, name) == 0) return &metrics[i];
+        }
+        if (!create || metricCount >= MAX_METRICS) return nullptr;
+        Metric* m = &metrics[metricCount++];
+        m->name = name;
+        m->value = 0;
+        return m;
+    }
+}
+
+void Metrics::set(const char* name, int32_t value) {
+    portENTER_CRITICAL(&metricsMux);
+    Metric* m = find(name, true);
+    if (m) m->value = value;
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+void Metrics::increment(const char* name, int32_t delta) {
+    portENTER_CRITICAL(&metricsMux);
+    Metric* m = find(name, true);
+    if (m) m->value += delta;
+    portEXIT_CRITICAL(&metricsMux);
+}
+
+int32_t Metrics::get(const char* name) {
+    portENTER_CRITICAL(&metricsMux);
+    Metric* m = find(name, false);
+    int32_t value = m ? m->value : 0;
+    portEXIT_CRITICAL(&metricsMux);
+    return value;
+}
+
+String Metrics::toJson() {
+    Metric copy[MAX_METRICS];
+    portENTER_CRITICAL(&metricsMux);
+    uint8_t count = metricCount;
+    memcpy(copy, metrics, count * sizeof(Metric));
+    portEXIT_CRITICAL(&metricsMux);
+
+    String json = "{";
+    json += "\"uptime_s\":" + String(millis() / 1000UL);
+    json += ",\"free_heap\":" + String(ESP.getFreeHeap());
+    for (uint8_t i = 0; i < count; ++i) {
+        json += ",\"" + String(copy[i].name) + "\":" + String(copy[i].value);
+    }
+    json += "}";
+    return json;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+#include <WString.h>
+
+// Process-wide named counters and gauges, exported as JSON at /api/metrics.
+// Names must be string literals (only the pointer is stored).
+class Metrics {
+public:
+    static void set(const char* name, int32_t value);
+    static void increment(const char* name, int32_t delta = 1);
+    static int32_t get(const char* name);
+    static String toJson();
+};
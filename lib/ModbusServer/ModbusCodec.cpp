@@ -0,0 +1,88 @@
+#include "ModbusCodec.h"
+
+namespace {
+    const size_t MBAP_SIZE = 7;        // transaction, protocol, length, unit
+    const uint16_t MAX_READ_REGISTERS = 125;
+    const uint16_t MAX_READ_BITS = 2000;
+
+    uint16_t word(const uint8_t* p) {
+        return (uint16_t)((p[0] << 8) | p[1]);
+    }
+
+    void putWord(uint8_t* p, uint16_t value) {
+        p[0] = (uint8_t)(value >> 8);
+        p[1] = (uint8_t)value;
+    }
+
+    // Copies transaction id, protocol and unit, and sets the length for `pduLength` bytes of PDU
+    size_t header(const uint8_t* request, uint8_t* out, size_t pduLength) {
+        out[0] = request[0];
+        out[1] = request[1];
+        out[2] = 0;
+        out[3] = 0;
+        putWord(out + 4, (uint16_t)(pduLength + 1));
+        out[6] = request[6];
+        return MBAP_SIZE + pduLength;
+    }
+
+    size_t exception(const uint8_t* request, uint8_t* out, uint8_t code) {
+        out[MBAP_SIZE] = request[MBAP_SIZE] | 0x80;
+        out[MBAP_SIZE + 1] = code;
+        return header(request, out, 2);
+    }
+}
+
+namespace ModbusCodec {
+
+int frameLength(const uint8_t* buf, size_t len) {
+    if (len < MBAP_SIZE) return 0;
+    uint16_t length = word(buf + 4);
+    if (word(buf + 2) != 0 || length < 2 || MBAP_SIZE - 1 + length > MODBUS_MAX_ADU) return -1;
+    size_t total = MBAP_SIZE - 1 + length;
+    return len < total ? 0 : (int)total;
+}
+
+size_t respond(const uint8_t* request, size_t len, const ModbusImage& image, uint8_t* out) {
+    uint8_t function = request[MBAP_SIZE];
+    const uint8_t* pdu = request + MBAP_SIZE + 1;
+    if (function != 0x02 && function != 0x03 && function != 0x04) return exception(request, out, ILLEGAL_FUNCTION);
+    if (len != MBAP_SIZE + 5) return exception(request, out, ILLEGAL_DATA_VALUE);
+
+    uint16_t start = word(pdu);
+    uint16_t quantity = word(pdu + 2);
+    uint8_t* data = out + MBAP_SIZE + 2;
+    out[MBAP_SIZE] = function;
+
+    if (function == 0x02) {
+        if (quantity == 0 || quantity > MAX_READ_BITS) return exception(request, out, ILLEGAL_DATA_VALUE);
+        if ((uint32_t)start + quantity > MODBUS_BITS) return exception(request, out, ILLEGAL_DATA_ADDRESS);
+        uint8_t bytes = (uint8_t)((quantity + 7) / 8);
+        out[MBAP_SIZE + 1] = bytes;
+        for (uint8_t i = 0; i < bytes; ++i) data[i] = 0;
+        for (uint16_t i = 0; i < quantity; ++i) {
+            if (bit(image, start + i)) data[i / 8] |= (uint8_t)(1 << (i % 8));
+        }
+        return header(request, out, 2 + bytes);
+    }
+
+    if (quantity == 0 || quantity > MAX_READ_REGISTERS) return exception(request, out, ILLEGAL_DATA_VALUE);
+    if ((uint32_t)start + quantity > MODBUS_REGISTERS) return exception(request, out, ILLEGAL_DATA_ADDRESS);
+    out[MBAP_SIZE + 1] = (uint8_t)(quantity * 2);
+    for (uint16_t i = 0; i < quantity; ++i) putWord(data + i * 2, image.registers[start + i]);
+    return header(request, out, 2 + quantity * 2);
+}
+
+void setBit(ModbusImage& image, uint16_t address, bool value) {
+    uint8_t mask = (uint8_t)(1 << (address % 8));
+    if (value) {
+        image.bits[address / 8] |= mask;
+    } else {
+        image.bits[address / 8] &= (uint8_t)~mask;
+    }
+}
+
+bool bit(const ModbusImage& image, uint16_t address) {
+    return (image.bits[address / 8] >> (address % 8)) & 1;
+}
+
+}
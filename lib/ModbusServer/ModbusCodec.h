@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Platform-independent part of the Modbus TCP server: framing and the read
+// functions over a fixed register image. No Arduino dependencies so it can be
+// exercised on a host; nothing here allocates.
+//
+// Supported functions: 02 Read Discrete Inputs, 03 Read Holding Registers and
+// 04 Read Input Registers (03 and 04 read the same image). Everything is read
+// only; other functions get exception 01.
+
+static const uint16_t MODBUS_BLOCK = 16;                   // registers (and inputs) per tank
+static const uint16_t MODBUS_REGISTERS = MODBUS_BLOCK * 4;
+static const uint16_t MODBUS_BITS = MODBUS_BLOCK * 4;
+static const size_t MODBUS_MAX_ADU = 260;                  // MBAP header + largest PDU
+
+// Register offsets within a tank's block; signed values are two's complement
+enum ModbusRegister : uint16_t {
+    MB_PERCENT_X10 = 0,      // int16, % full x10
+    MB_LEVEL_CM_X10 = 1,     // int16, water height x10
+    MB_DISTANCE_CM_X10 = 2,  // int16, sensor distance x10, -10 on sensor error
+    MB_LITERS_X10_HI = 3,    // uint32 litres x10, high word first
+    MB_LITERS_X10_LO = 4,
+    MB_STATUS = 5,           // LevelStatus
+    MB_ALERT_BITS = 6,       // the block's discrete inputs as one word
+    MB_SAMPLE_AGE_S = 7,     // seconds since the sample, saturating; 0xFFFF if never sampled
+    MB_SEQUENCE_HI = 8,      // uint32 sample sequence, high word first
+    MB_SEQUENCE_LO = 9
+};
+
+// Discrete input offsets within a tank's block
+enum ModbusBit : uint16_t {
+    MB_BIT_LOW = 0,
+    MB_BIT_FULL = 1,
+    MB_BIT_SENSOR_ERROR = 2,
+    MB_BIT_RANGE_ERROR = 3,
+    MB_BIT_VOLUME_VALID = 4
+};
+
+struct ModbusImage {
+    uint16_t registers[MODBUS_REGISTERS];
+    uint8_t bits[MODBUS_BITS / 8];
+};
+
+namespace ModbusCodec {
+    // Exception codes
+    static const uint8_t ILLEGAL_FUNCTION = 0x01;
+    static const uint8_t ILLEGAL_DATA_ADDRESS = 0x02;
+    static const uint8_t ILLEGAL_DATA_VALUE = 0x03;
+
+    // Length of the complete ADU at the start of `buf`: 0 if more bytes are
+    // needed, -1 if the header is not Modbus TCP (the connection should be dropped)
+    int frameLength(const uint8_t* buf, size_t len);
+
+    // Answers one complete request ADU into `out` (MODBUS_MAX_ADU bytes);
+    // returns the response length
+    size_t respond(const uint8_t* request, size_t len, const ModbusImage& image, uint8_t* out);
+
+    void setBit(ModbusImage& image, uint16_t address, bool value);
+    bool bit(const ModbusImage& image, uint16_t address);
+}
@@ -0,0 +1,153 @@
+#include "ModbusServer.h"
+#include <AsyncTCP.h>
+#include "ModbusCodec.h"
+#include "Telemetry.h"
+#include "Metrics.h"
+
+namespace {
+    const uint32_t IDLE_TIMEOUT_S = 60;  // pollers that go quiet are dropped
+    const uint32_t IMAGE_MAX_AGE = 1000; // ms; keeps the sample age register current
+
+    struct Connection {
+        AsyncClient* client;
+        uint8_t rx[MODBUS_MAX_ADU];
+        size_t rxLength;
+    };
+
+    // Only touched from the AsyncTCP task, apart from begin()/end()
+    AsyncServer* server = nullptr;
+    Connection connections[ModbusServer::MAX_CLIENTS];
+    uint8_t tx[MODBUS_MAX_ADU];
+    ModbusImage image;
+    uint32_t imageSequence = 0;
+    unsigned long imageBuiltAt = 0;
+    bool imageValid = false;
+
+    int16_t scaled(float value) {
+        float v = value * 10.0f;
+        if (v > 32767.0f) return 32767;
+        if (v < -32768.0f) return -32768;
+        return (int16_t)(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+
+    void fillBlock(uint8_t tank, const Telemetry& t, unsigned long now) {
+        uint16_t* r = image.registers + tank * MODBUS_BLOCK;
+        uint16_t base = tank * MODBUS_BLOCK;
+        uint32_t liters = t.volumeValid && t.liters > 0 ? (uint32_t)(t.liters * 10.0f + 0.5f) : 0;
+        // Never sampled (sequence 0): as old as the register can say
+        unsigned long age = t.sequence ? (now - t.sampledAt) / 1000 : 0xFFFF;
+
+        ModbusCodec::setBit(image, base + MB_BIT_LOW, t.status == LevelStatus::LOW_LEVEL);
+        ModbusCodec::setBit(image, base + MB_BIT_FULL, t.status == LevelStatus::FULL);
+        ModbusCodec::setBit(image, base + MB_BIT_SENSOR_ERROR, t.status == LevelStatus::SENSOR_ERROR);
+        ModbusCodec::setBit(image, base + MB_BIT_RANGE_ERROR, t.status == LevelStatus::RANGE_ERROR);
+        ModbusCodec::setBit(image, base + MB_BIT_VOLUME_VALID, t.volumeValid);
+
+        r[MB_PERCENT_X10] = (uint16_t)scaled(t.percent);
+        r[MB_LEVEL_CM_X10] = (uint16_t)scaled(t.levelCm);
+        r[MB_DISTANCE_CM_X10] = (uint16_t)scaled(t.distanceCm);
+        r[MB_LITERS_X10_HI] = (uint16_t)(liters >> 16);
+        r[MB_LITERS_X10_LO] = (uint16_t)liters;
+        r[MB_STATUS] = (uint16_t)t.status;
+        r[MB_ALERT_BITS] = image.bits[base / 8] | (image.bits[base / 8 + 1] << 8);
+        r[MB_SAMPLE_AGE_S] = age > 0xFFFF ? 0xFFFF : (uint16_t)age;
+        r[MB_SEQUENCE_HI] = (uint16_t)(t.sequence >> 16);
+        r[MB_SEQUENCE_LO] = (uint16_t)t.sequence;
+    }
+
+    // Rebuilt when a new sample arrives, or once a second for the age register.
+    // Blocks of unused tanks read as a sensor error.
+    void refreshImage() {
+        unsigned long now = millis();
+        uint32_t sequence = TelemetryStore::sequence();
+        if (imageValid && sequence == imageSequence && now - imageBuiltAt < IMAGE_MAX_AGE) return;
+        memset(&image, 0, sizeof(image));
+        for (uint8_t tank = 0; tank < MAX_TANKS; ++tank) fillBlock(tank, TelemetryStore::latest(tank), now);
+        imageSequence = sequence;
+        imageBuiltAt = now;
+        imageValid = true;
+    }
+
+    void release(Connection& c) {
+        c.client = nullptr;
+        c.rxLength = 0;
+    }
+
+    void onData(Connection& c, const uint8_t* data, size_t len) {
+        while (len > 0) {
+            size_t room = MODBUS_MAX_ADU - c.rxLength;
+            size_t take = len < room ? len : room;
+            memcpy(c.rx + c.rxLength, data, take);
+            c.rxLength += take;
+            data += take;
+            len -= take;
+
+            for (;;) {
+                int frame = ModbusCodec::frameLength(c.rx, c.rxLength);
+                if (frame < 0) {
+                    Metrics::increment("modbus_bad_frames");
+                    c.client->close();
+                    return;
+                }
+                if (frame == 0) break;
+                refreshImage();
+                size_t out = ModbusCodec::respond(c.rx, frame, image, tx);
+                c.client->write((const char*)tx, out);
+                Metrics::increment("modbus_requests");
+                memmove(c.rx, c.rx + frame, c.rxLength - frame);
+                c.rxLength -= frame;
+            }
+        }
+    }
+
+    void onClient(void*, AsyncClient* client) {
+        Connection* slot = nullptr;
+        for (uint8_t i = 0; i < ModbusServer::MAX_CLIENTS; ++i) {
+            if (!connections[i].client) {
+                slot = &connections[i];
+                break;
+            }
+        }
+        if (!slot) {
+            Metrics::increment("modbus_rejected");
+            client->onDisconnect([](void*, AsyncClient* c) { delete c; });
+            client->close(true);
+            return;
+        }
+        slot->client = client;
+        slot->rxLength = 0;
+        client->setNoDelay(true);
+        client->setRxTimeout(IDLE_TIMEOUT_S);
+        client->onData([](void* arg, AsyncClient*, void* data, size_t len) {
+            onData(*(Connection*)arg, (const uint8_t*)data, len);
+        }, slot);
+        client->onDisconnect([](void* arg, AsyncClient* c) {
+            release(*(Connection*)arg);
+            delete c;
+        }, slot);
+    }
+}
+
+void ModbusServer::begin() {
+    if (server) return;
+    server = new AsyncServer(PORT);
+    server->onClient(onClient, nullptr);
+    server->setNoDelay(true);
+    server->begin();
+    Serial.println("[MODBUS] Listening on port " + String(PORT));
+}
+
+void ModbusServer::end() {
+    if (!server) return;
+    for (uint8_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (connections[i].client) connections[i].client->close(true);
+    }
+    server->end();
+    delete server;
+    server = nullptr;
+    Serial.println("[MODBUS] Stopped");
+}
+
+bool ModbusServer::isRunning() {
+    return server != nullptr;
+}
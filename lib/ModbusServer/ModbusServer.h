@@ -0,0 +1,17 @@
+#pragma once
+#include <Arduino.h>
+
+// Read-only Modbus TCP slave on port 502 for SCADA polling, alongside the web
+// server on the AsyncTCP task. Each tank has a 16 register block (tank n at
+// address n * 16, see ModbusCodec.h for the layout) built from the latest
+// telemetry snapshot. Connections use fixed slots with their own receive
+// buffers, so serving a request allocates nothing.
+class ModbusServer {
+public:
+    static const uint16_t PORT = 502;
+    static const uint8_t MAX_CLIENTS = 4;
+
+    static void begin();
+    static void end();
+    static bool isRunning();
+};
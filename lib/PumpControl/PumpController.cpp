@@ -0,0 +1,232 @@
+#include "PumpController.h"
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "Metrics.h"
+
+namespace {
+    // Output-capable GPIOs left free by the board's fixed wiring: not the flash pins
+    // (6-11), the input-only pins (34-39), UART0 (1, 3), strapping pin 12, the primary
+    // sensor (17, 5), the displays (19, 21, 22, 23), the LED (2) or the reset button (0)
+    const int RELAY_PINS[] = {4, 13, 14, 15, 16, 18, 25, 26, 27, 32, 33};
+
+    const uint32_t TASK_STACK = 3072;
+    const UBaseType_t TASK_PRIORITY = 5;      // above loopTask (1), the job worker (1) and AsyncTCP (3)
+    const uint32_t TICK_MS = 1000;            // timeouts are re-checked this often without samples
+    const uint64_t WATCHDOG_US = 5000000;     // relay forced off if the task stalls this long
+    const uint32_t MIN_SAMPLE_TIMEOUT = 30000;
+
+    struct Sample {
+        float percent;
+        bool valid;
+        uint32_t takenUs;
+    };
+
+    struct Settings {
+        bool enabled;
+        int pin;
+        bool activeLow;
+        PumpSettings logic;
+    };
+
+    QueueHandle_t queue = nullptr;
+    esp_timer_handle_t watchdog = nullptr;
+
+    portMUX_TYPE pumpMux = portMUX_INITIALIZER_UNLOCKED;
+    Settings pending;            // written by configure(), taken by the task
+    bool pendingChanged = false;
+    bool clearRequested = false;
+    PumpState shared;            // the task's state as of its last pass
+    bool sharedEnabled = false;
+    uint32_t latencyLast = 0;
+    uint32_t latencyMax = 0;
+    uint32_t latencyAvg = 0;
+
+    // Read by the watchdog callback as well as the task
+    volatile int relayPin = -1;
+    volatile bool relayActiveLow = false;
+    volatile bool watchdogTripped = false;
+
+    void writeRelay(bool on) {
+        int pin = relayPin;
+        if (pin < 0) return;
+        digitalWrite(pin, on != relayActiveLow ? HIGH : LOW);
+    }
+
+    void selectPin(int pin, bool activeLow) {
+        writeRelay(false);
+        relayPin = -1;
+        relayActiveLow = activeLow;
+        if (pin >= 0) pinMode(pin, OUTPUT);
+        relayPin = pin;
+        writeRelay(false);
+    }
+
+    // Runs on the esp_timer task, independent of the control task
+    void watchdogExpired(void*) {
+        writeRelay(false);
+        watchdogTripped = true;
+    }
+
+    Settings settingsFrom(const Config& config) {
+        Settings s;
+        s.enabled = config.pumpEnabled;
+        s.pin = PumpController::pinProblem(config, config.pumpPin) ? -1 : config.pumpPin; // never a pin in use
+        s.activeLow = config.pumpActiveLow;
+        s.logic.startPercent = config.pumpStartPercent;
+        s.logic.stopPercent = config.pumpStopPercent;
+        s.logic.minOnMs = (uint32_t)config.pumpMinOnTime * 1000;
+        s.logic.minOffMs = (uint32_t)config.pumpMinOffTime * 1000;
+        s.logic.dryRunMs = (uint32_t)config.pumpDryRunTime * 1000;
+        s.logic.dryRunRise = config.pumpDryRunRise;
+        s.logic.maxRunMs = (uint32_t)config.pumpMaxRunTime * 60000;
+        // Tolerate a few missed samples at the slowest rate the sampler may run at
+        uint32_t interval = config.adaptiveSampling ? config.sampleMaxInterval : config.sensorReadInterval * 1000;
+        s.logic.sampleTimeoutMs = interval * 3 > MIN_SAMPLE_TIMEOUT ? interval * 3 : MIN_SAMPLE_TIMEOUT;
+        return s;
+    }
+
+    void controlTask(void*) {
+        Settings active;
+        active.enabled = false;
+        active.pin = -1;
+        active.activeLow = false;
+        PumpState state;
+        PumpLogic::reset(state, millis());
+
+        for (;;) {
+            Sample sample;
+            bool fresh = xQueueReceive(queue, &sample, pdMS_TO_TICKS(TICK_MS)) == pdTRUE;
+            esp_timer_stop(watchdog);
+            esp_timer_start_once(watchdog, WATCHDOG_US);
+
+            Settings next;
+            portENTER_CRITICAL(&pumpMux);
+            bool changed = pendingChanged;
+            if (changed) next = pending;
+            pendingChanged = false;
+            bool clear = clearRequested;
+            clearRequested = false;
+            portEXIT_CRITICAL(&pumpMux);
+
+            uint32_t now = millis();
+            if (changed) {
+                if (next.pin != active.pin || next.activeLow != active.activeLow) selectPin(next.pin, next.activeLow);
+                if (!next.enabled && active.enabled) PumpLogic::reset(state, now);
+                active = next;
+            }
+            if (watchdogTripped) {
+                watchdogTripped = false;
+                PumpLogic::trip(state, now, PumpFault::WATCHDOG);
+                Metrics::increment("pump_watchdog_trips");
+            }
+            if (clear) PumpLogic::clearFault(state);
+
+            bool wasOn = state.on;
+            PumpFault lastFault = state.fault;
+            if (active.enabled && active.pin >= 0) {
+                if (fresh) {
+                    PumpLogic::update(state, active.logic, now, sample.percent, sample.valid);
+                } else {
+                    PumpLogic::tick(state, active.logic, now);
+                }
+            }
+            writeRelay(state.on);
+            uint32_t latency = fresh ? (uint32_t)micros() - sample.takenUs : 0;
+
+            portENTER_CRITICAL(&pumpMux);
+            shared = state;
+            sharedEnabled = active.enabled && active.pin >= 0;
+            if (fresh) {
+                latencyLast = latency;
+                if (latency > latencyMax) latencyMax = latency;
+                latencyAvg = latencyAvg ? (latencyAvg * 7 + latency) / 8 : latency;
+            }
+            uint32_t worst = latencyMax;
+            portEXIT_CRITICAL(&pumpMux);
+
+            if (fresh) {
+                Metrics::set("pump_latency_us", latency);
+                Metrics::set("pump_latency_max_us", worst);
+            }
+
+            if (state.on != wasOn) {
+                Metrics::set("pump_on", state.on ? 1 : 0);
+                Serial.printf("[PUMP] Relay %s at %.1f%%\n", state.on ? "on" : "off", state.percent);
+            }
+            if (state.fault != lastFault && state.fault != PumpFault::NONE) {
+                Metrics::increment("pump_faults");
+                Serial.println("[PUMP] Fault: " + String(PumpLogic::faultName(state.fault)));
+            }
+        }
+    }
+}
+
+const char* PumpController::pinProblem(const Config& config, int pin) {
+    if (pin == -1) return nullptr;
+    bool usable = false;
+    for (int candidate : RELAY_PINS) usable = usable || candidate == pin;
+    if (!usable) return "GPIO cannot drive a relay on this board";
+    for (uint8_t i = 1; i < config.tankCount && i < MAX_TANKS; ++i) {
+        const TankConfig& tank = config.extraTanks[i - 1];
+        if (tank.triggerPin == pin || tank.echoPin == pin) return "GPIO is used by a tank sensor";
+    }
+    return nullptr;
+}
+
+void PumpController::begin(const Config& config) {
+    if (queue) return;
+    Settings s = settingsFrom(config);
+    selectPin(s.pin, s.activeLow); // relay off before anything else runs
+    queue = xQueueCreate(1, sizeof(Sample));
+    esp_timer_create_args_t args = {};
+    args.callback = watchdogExpired;
+    args.name = "pump_wdt";
+    esp_timer_create(&args, &watchdog);
+    configure(config);
+    xTaskCreate(controlTask, "pump", TASK_STACK, nullptr, TASK_PRIORITY, nullptr);
+}
+
+void PumpController::configure(const Config& config) {
+    Settings s = settingsFrom(config);
+    portENTER_CRITICAL(&pumpMux);
+    pending = s;
+    pendingChanged = true;
+    portEXIT_CRITICAL(&pumpMux);
+}
+
+void PumpController::feed(float percent, bool valid, uint32_t sampledAtUs) {
+    if (!queue) return;
+    Sample sample;
+    sample.percent = percent;
+    sample.valid = valid;
+    sample.takenUs = sampledAtUs;
+    xQueueOverwrite(queue, &sample);
+}
+
+void PumpController::clearFault() {
+    portENTER_CRITICAL(&pumpMux);
+    clearRequested = true;
+    portEXIT_CRITICAL(&pumpMux);
+}
+
+String PumpController::toJson() {
+    portENTER_CRITICAL(&pumpMux);
+    PumpState s = shared;
+    bool enabled = sharedEnabled;
+    uint32_t last = latencyLast;
+    uint32_t max = latencyMax;
+    uint32_t avg = latencyAvg;
+    portEXIT_CRITICAL(&pumpMux);
+
+    String json = "{\"enabled\":" + String(enabled ? "true" : "false");
+    json += ",\"on\":" + String(s.on ? "true" : "false");
+    json += ",\"fault\":\"" + String(PumpLogic::faultName(s.fault)) + "\"";
+    json += ",\"level_percent\":" + String(s.percent, 1);
+    json += ",\"runs\":" + String(s.runs);
+    json += ",\"state_ms\":" + String(millis() - s.changedAt);
+    json += ",\"latency_us\":{\"last\":" + String(last) + ",\"avg\":" + String(avg) + ",\"max\":" + String(max) + "}";
+    json += "}";
+    return json;
+}
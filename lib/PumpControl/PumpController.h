@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+#include "ConfigManager.h"
+#include "PumpLogic.h"
+
+// Drives the pump relay from the primary tank's filtered level (see PumpLogic).
+// The decision runs on its own high-priority task, fed straight from the
+// sampler through a one-slot queue, so a fresh sample reaches the relay without
+// waiting for the rest of loop(). Echo-to-relay latency is measured and
+// exported as metrics. A one-shot esp_timer re-armed on every pass of the task
+// is the hard watchdog: if the task stops running, the timer switches the relay
+// off on its own and latches a WATCHDOG fault.
+class PumpController {
+public:
+    static void begin(const Config& config);
+    // Applies changed pump settings; picked up by the control task within a second
+    static void configure(const Config& config);
+    // Hands the newest primary-tank sample to the control task. Never blocks.
+    // `sampledAtUs` is micros() at the echo; latency is measured from there.
+    static void feed(float percent, bool valid, uint32_t sampledAtUs);
+    static void clearFault();
+    static String toJson();
+    // Why `pin` cannot drive the relay (nullptr if it can; -1 means no relay)
+    static const char* pinProblem(const Config& config, int pin);
+};
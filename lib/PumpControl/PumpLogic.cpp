@@ -0,0 +1,89 @@
+#include "PumpLogic.h"
+
+namespace {
+    void switchRelay(PumpState& state, uint32_t nowMs, bool on) {
+        state.on = on;
+        state.changedAt = nowMs;
+        if (on) {
+            state.runs++;
+            state.checkAt = nowMs;
+            state.checkPercent = state.percent;
+        }
+    }
+}
+
+namespace PumpLogic {
+
+void reset(PumpState& state, uint32_t nowMs) {
+    state.on = false;
+    state.fault = PumpFault::NONE;
+    state.haveSample = false;
+    state.percent = 0.0f;
+    state.sampleAt = nowMs;
+    state.changedAt = nowMs;
+    state.checkPercent = 0.0f;
+    state.checkAt = nowMs;
+    state.runs = 0;
+}
+
+bool update(PumpState& state, const PumpSettings& settings, uint32_t nowMs, float percent, bool valid) {
+    if (valid) {
+        state.haveSample = true;
+        state.percent = percent;
+        state.sampleAt = nowMs;
+    }
+    return tick(state, settings, nowMs);
+}
+
+bool tick(PumpState& state, const PumpSettings& settings, uint32_t nowMs) {
+    bool stale = !state.haveSample || nowMs - state.sampleAt > settings.sampleTimeoutMs;
+    uint32_t inState = nowMs - state.changedAt;
+
+    if (state.on) {
+        if (stale) {
+            trip(state, nowMs, PumpFault::SENSOR);
+        } else if (settings.maxRunMs && inState >= settings.maxRunMs) {
+            trip(state, nowMs, PumpFault::MAX_RUN);
+        } else if (settings.dryRunMs && nowMs - state.checkAt >= settings.dryRunMs) {
+            if (state.percent - state.checkPercent < settings.dryRunRise) {
+                trip(state, nowMs, PumpFault::DRY_RUN);
+            } else {
+                state.checkAt = nowMs;
+                state.checkPercent = state.percent;
+            }
+        }
+        if (state.on && state.percent >= settings.stopPercent && inState >= settings.minOnMs) {
+            switchRelay(state, nowMs, false);
+        }
+        return state.on;
+    }
+
+    if (state.fault == PumpFault::SENSOR && !stale) state.fault = PumpFault::NONE;
+    if (state.fault != PumpFault::NONE || stale) return false;
+    if (state.percent <= settings.startPercent && inState >= settings.minOffMs) {
+        switchRelay(state, nowMs, true);
+    }
+    return state.on;
+}
+
+void trip(PumpState& state, uint32_t nowMs, PumpFault fault) {
+    state.fault = fault;
+    if (state.on) switchRelay(state, nowMs, false);
+}
+
+void clearFault(PumpState& state) {
+    state.fault = PumpFault::NONE;
+}
+
+const char* faultName(PumpFault fault) {
+    switch (fault) {
+        case PumpFault::NONE: return "NONE";
+        case PumpFault::SENSOR: return "SENSOR";
+        case PumpFault::DRY_RUN: return "DRY_RUN";
+        case PumpFault::MAX_RUN: return "MAX_RUN";
+        case PumpFault::WATCHDOG: return "WATCHDOG";
+    }
+    return "UNKNOWN";
+}
+
+}
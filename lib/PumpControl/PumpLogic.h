@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+
+// Platform-independent part of the pump controller: the fill decision for one
+// relay. No Arduino dependencies so it can be exercised on a host against a
+// modelled tank.
+//
+// The pump fills the tank: it starts at or below `startPercent` and stops at or
+// above `stopPercent`, each only once the minimum on/off time has passed so the
+// relay cannot chatter. Safety stops ignore the minimum on time: no valid sample
+// for `sampleTimeoutMs`, a run longer than `maxRunMs`, or a level that has not
+// risen by `dryRunRise` within `dryRunMs` of pumping (the pump is running dry or
+// the supply is gone). Dry-run and run-time faults latch until cleared; a sensor
+// fault clears itself once samples return.
+
+enum class PumpFault : uint8_t {
+    NONE,
+    SENSOR,   // no valid sample recently
+    DRY_RUN,  // level not rising while pumping
+    MAX_RUN,  // single run exceeded its limit
+    WATCHDOG  // controller stopped servicing the relay (set by the glue)
+};
+
+struct PumpSettings {
+    float startPercent = 20.0f;
+    float stopPercent = 90.0f;
+    uint32_t minOnMs = 60000;
+    uint32_t minOffMs = 120000;
+    uint32_t dryRunMs = 300000;    // 0 = no dry-run protection
+    float dryRunRise = 1.0f;       // % the level must rise per dryRunMs
+    uint32_t maxRunMs = 3600000;   // 0 = unlimited
+    uint32_t sampleTimeoutMs = 30000;
+};
+
+struct PumpState {
+    bool on;
+    PumpFault fault;
+    bool haveSample;
+    float percent;          // newest valid level
+    uint32_t sampleAt;      // when it was taken
+    uint32_t changedAt;     // last relay change (or reset)
+    float checkPercent;     // dry-run reference level ...
+    uint32_t checkAt;       // ... and when it was taken
+    uint32_t runs;
+};
+
+namespace PumpLogic {
+    // Starts with the relay off; the minimum off time runs from `nowMs`, so a
+    // reboot loop cannot cycle the pump.
+    void reset(PumpState& state, uint32_t nowMs);
+
+    // Feeds one sample (valid = false on a sensor error) and returns whether the relay should be on
+    bool update(PumpState& state, const PumpSettings& settings, uint32_t nowMs, float percent, bool valid);
+    // Re-evaluates without a new sample (timeouts); returns whether the relay should be on
+    bool tick(PumpState& state, const PumpSettings& settings, uint32_t nowMs);
+
+    // Turns the relay off and latches `fault` (used for the hardware watchdog)
+    void trip(PumpState& state, uint32_t nowMs, PumpFault fault);
+    // Clears a latched fault; the minimum off time still applies
+    void clearFault(PumpState& state);
+
+    const char* faultName(PumpFault fault);
+}
@@ -0,0 +1,173 @@
+#include "ResponseArena.h"
+#include "Metrics.h"
+
+namespace {
+    // Admission control keeps at most six requests in flight, so this many descriptors
+    // suffice even when arenas run on heap blocks
+    ResponseArena arenas[ResponseArena::POOL_BLOCKS];
+    uint8_t* pool[ResponseArena::POOL_BLOCKS];
+    uint8_t poolBlocks = 0;
+    bool blockBusy[ResponseArena::POOL_BLOCKS];
+    uint8_t blocksInUse = 0;
+    uint8_t blocksPeak = 0;
+    uint8_t heapBlocksInUse = 0;
+    uint32_t largestBlockLow = UINT32_MAX;
+
+    // A free pool block, else a heap block if the heap can spare one, else nullptr
+    uint8_t* takeBlock() {
+        for (uint8_t i = 0; i < poolBlocks; ++i) {
+            if (blockBusy[i]) continue;
+            blockBusy[i] = true;
+            blocksInUse++;
+            if (blocksInUse > blocksPeak) {
+                blocksPeak = blocksInUse;
+                Metrics::set("arena_blocks_peak", blocksPeak);
+            }
+            Metrics::set("arena_blocks_in_use", blocksInUse);
+            return pool[i];
+        }
+        uint8_t* block = nullptr;
+        if (ESP.getFreeHeap() >= ResponseArena::HEAP_RESERVE + ResponseArena::BLOCK_SIZE &&
+            ESP.getMaxAllocHeap() >= ResponseArena::BLOCK_SIZE) {
+            block = (uint8_t*)malloc(ResponseArena::BLOCK_SIZE);
+        }
+        if (!block) {
+            Metrics::increment("arena_exhausted");
+            return nullptr;
+        }
+        heapBlocksInUse++;
+        Metrics::increment("arena_heap_blocks");
+        Metrics::set("arena_heap_blocks_in_use", heapBlocksInUse);
+        return block;
+    }
+
+    void giveBack(uint8_t* block) {
+        for (uint8_t i = 0; i < poolBlocks; ++i) {
+            if (pool[i] != block) continue;
+            blockBusy[i] = false;
+            blocksInUse--;
+            return;
+        }
+        free(block);
+        heapBlocksInUse--;
+    }
+}
+
+uint8_t ResponseArena::begin() {
+    while (poolBlocks < POOL_BLOCKS) {
+        uint8_t* block = (uint8_t*)malloc(BLOCK_SIZE);
+        if (!block) break;
+        pool[poolBlocks++] = block;
+    }
+    Metrics::set("arena_pool_blocks", poolBlocks);
+    return poolBlocks;
+}
+
+ResponseArena* ResponseArena::acquire() {
+    for (uint8_t i = 0; i < POOL_BLOCKS; ++i) {
+        ResponseArena& a = arenas[i];
+        if (a._inUse) continue;
+        uint8_t* first = takeBlock();
+        if (!first) return nullptr;
+        a._inUse = true;
+        a._blocks[0] = first;
+        a._blockCount = 1;
+        a._used = 0;
+        a._bodyBlock = 0;
+        a._bodyOffset = 0;
+        a._length = 0;
+        a._bodyStarted = false;
+        a._overflowed = false;
+        return &a;
+    }
+    return nullptr;
+}
+
+void ResponseArena::release(ResponseArena* arena) {
+    if (!arena || !arena->_inUse) return;
+    for (uint8_t i = 0; i < arena->_blockCount; ++i) giveBack(arena->_blocks[i]);
+    arena->_blockCount = 0;
+    arena->_inUse = false;
+    Metrics::set("arena_blocks_in_use", blocksInUse);
+    Metrics::set("arena_heap_blocks_in_use", heapBlocksInUse);
+}
+
+bool ResponseArena::grow() {
+    uint8_t* next = _blockCount < MAX_ARENA_BLOCKS ? takeBlock() : nullptr;
+    if (!next) return false;
+    _blocks[_blockCount++] = next;
+    _used = 0;
+    return true;
+}
+
+char* ResponseArena::alloc(size_t size) {
+    if (_bodyStarted || size > BLOCK_SIZE) return nullptr;
+    if (BLOCK_SIZE - _used < size && !grow()) return nullptr;
+    char* p = (char*)block(_blockCount - 1) + _used;
+    _used += (size + 3) & ~(size_t)3;
+    if (_used > BLOCK_SIZE) _used = BLOCK_SIZE;
+    return p;
+}
+
+bool ResponseArena::append(const char* data, size_t length) {
+    if (_overflowed) return false;
+    if (!_bodyStarted) {
+        if (_used == BLOCK_SIZE && !grow()) {
+            _overflowed = true;
+            return false;
+        }
+        _bodyStarted = true;
+        _bodyBlock = _blockCount - 1;
+        _bodyOffset = _used;
+    }
+    while (length > 0) {
+        if (_used == BLOCK_SIZE && !grow()) {
+            _overflowed = true;
+            return false;
+        }
+        size_t room = BLOCK_SIZE - _used;
+        size_t n = length < room ? length : room;
+        memcpy(block(_blockCount - 1) + _used, data, n);
+        _used += n;
+        _length += n;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+bool ResponseArena::append(const char* text) {
+    return append(text, strlen(text));
+}
+
+bool ResponseArena::append(const String& text) {
+    return append(text.c_str(), text.length());
+}
+
+size_t ResponseArena::read(size_t offset, uint8_t* out, size_t max) const {
+    size_t copied = 0;
+    while (copied < max && offset < _length) {
+        // Body position -> block and offset within it
+        size_t position = _bodyOffset + offset;
+        uint8_t i = _bodyBlock + position / BLOCK_SIZE;
+        size_t within = position % BLOCK_SIZE;
+        size_t n = BLOCK_SIZE - within;
+        if (n > _length - offset) n = _length - offset;
+        if (n > max - copied) n = max - copied;
+        memcpy(out + copied, block(i) + within, n);
+        copied += n;
+        offset += n;
+    }
+    return copied;
+}
+
+void ResponseArena::updateHeapStats() {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    if (largest < largestBlockLow) largestBlockLow = largest;
+    Metrics::set("heap_largest_block", largest);
+    Metrics::set("heap_largest_block_low", largestBlockLow);
+    Metrics::set("heap_min_free", ESP.getMinFreeHeap());
+    // Share of free memory not usable for one allocation
+    Metrics::set("heap_fragmentation_pct", freeHeap ? 100 - (int32_t)((uint64_t)largest * 100 / freeHeap) : 0);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+
+// Request-scoped memory for building web responses. A pool of fixed blocks is
+// taken from the heap once when the web server starts (never on battery-mode
+// wakes); an arena takes blocks from it as it grows (bump
+// allocation, nothing is freed piecemeal) and hands them all back in one go
+// when it is released, normally once the response has been sent. Pages built
+// from the pool never touch the heap, so they cannot fragment it over time.
+// When the pool is exhausted (two dashboards at once) an arena carries on with
+// blocks malloc'd for it alone, as long as HEAP_RESERVE stays free; those are
+// freed with the arena.
+//
+// An arena holds scratch allocations first (alloc), then the response body
+// (append); the body runs contiguously across its blocks from the first append.
+// Only used from the AsyncTCP task.
+class ResponseArena {
+public:
+    static const size_t BLOCK_SIZE = 4096;
+    // The dashboard renders to about 17 KB (5 blocks); every other page fits in
+    // one or two. Eight blocks serve a dashboard alongside a settings page, and
+    // arena_blocks_peak shows whether that holds in the field
+    static const uint8_t POOL_BLOCKS = 8;
+    static const uint8_t MAX_ARENA_BLOCKS = 8;     // 32 KB, the largest page an arena can hold
+    static const uint32_t HEAP_RESERVE = 32 * 1024; // left for lwIP, MQTT and the JSON routes
+
+    // Allocates the pool, block by block so it needs no large contiguous region;
+    // returns the number of blocks obtained (also reported as arena_pool_blocks)
+    static uint8_t begin();
+
+    // An arena holding one block, or nullptr when neither the pool nor the heap has one
+    static ResponseArena* acquire();
+    static void release(ResponseArena* arena);
+
+    // `size` contiguous bytes of scratch memory; nullptr once the body has been
+    // started, for sizes over BLOCK_SIZE, or when no block can be had
+    char* alloc(size_t size);
+    // Appends to the body; false (and overflowed() from then on) when no block can be had
+    bool append(const char* data, size_t length);
+    bool append(const char* text);
+    bool append(const String& text);
+
+    size_t length() const { return _length; }
+    bool overflowed() const { return _overflowed; }
+    // Copies up to `max` body bytes from `offset` on; for response fillers
+    size_t read(size_t offset, uint8_t* out, size_t max) const;
+
+    // Publishes free heap, largest free block and fragmentation to Metrics
+    static void updateHeapStats();
+
+private:
+    bool grow();
+    uint8_t* block(uint8_t i) const { return _blocks[i]; }
+
+    uint8_t* _blocks[MAX_ARENA_BLOCKS]; // pool or heap blocks, in order of use
+    uint8_t _blockCount;
+    size_t _used;                 // bytes used in the newest block
+    uint8_t _bodyBlock;           // where the body starts
+    size_t _bodyOffset;
+    size_t _length;
+    bool _bodyStarted;
+    bool _overflowed;
+    bool _inUse;
+};
@@ -0,0 +1,139 @@
+#include "Scheduler.h"
+
+TaskHandle_t Scheduler::_owner = nullptr;
+
+namespace {
+    // Wrap-safe "a is at or before b" for millis() timestamps
+    bool isDue(unsigned long deadline, unsigned long now) {
+        return (long)(deadline - now) <= 0;
+    }
+}
+
+Scheduler::Scheduler() {}
+
+void Scheduler::begin() {
+    _owner = xTaskGetCurrentTaskHandle();
+}
+
+Scheduler::TaskId Scheduler::every(unsigned long intervalMs, TaskCallback callback, bool runImmediately) {
+    if (_taskCount >= MAX_TASKS) return INVALID_TASK;
+    TaskId id = _taskCount++;
+    Task& task = _tasks[id];
+    task.callback = callback;
+    task.intervalMs = intervalMs > 0 ? intervalMs : 1;
+    task.deadline = millis() + (runImmediately ? 0 : task.intervalMs);
+    task.enabled = true;
+    push(id);
+    return id;
+}
+
+void Scheduler::setInterval(TaskId id, unsigned long intervalMs, bool runImmediately) {
+    if (id < 0 || id >= _taskCount) return;
+    Task& task = _tasks[id];
+    task.intervalMs = intervalMs > 0 ? intervalMs : 1;
+    if (!task.enabled) return;
+    remove(id);
+    task.deadline = millis() + (runImmediately ? 0 : task.intervalMs);
+    push(id);
+}
+
+void Scheduler::setEnabled(TaskId id, bool enabled) {
+    if (id < 0 || id >= _taskCount) return;
+    Task& task = _tasks[id];
+    if (task.enabled == enabled) return;
+    task.enabled = enabled;
+    if (enabled) {
+        task.deadline = millis() + task.intervalMs;
+        push(id);
+    } else {
+        remove(id);
+    }
+}
+
+unsigned long Scheduler::interval(TaskId id) const {
+    if (id < 0 || id >= _taskCount) return 0;
+    return _tasks[id].intervalMs;
+}
+
+void Scheduler::runDue() {
+    unsigned long now = millis();
+    // Bounded so a task that keeps rescheduling itself cannot starve loop()
+    for (uint8_t runs = 0; _heapSize > 0 && runs < MAX_TASKS; ++runs) {
+        TaskId id = _heap[0];
+        Task& task = _tasks[id];
+        if (!isDue(task.deadline, now)) break;
+
+        remove(id);
+        task.deadline += task.intervalMs;
+        if (isDue(task.deadline, now)) {
+            task.deadline = now + task.intervalMs; // fell behind: skip missed runs instead of bursting
+        }
+        push(id);
+        task.callback();
+        now = millis();
+    }
+}
+
+unsigned long Scheduler::msUntilNext() const {
+    if (_heapSize == 0) return (unsigned long)-1;
+    unsigned long now = millis();
+    unsigned long deadline = _tasks[_heap[0]].deadline;
+    return isDue(deadline, now) ? 0 : deadline - now;
+}
+
+void Scheduler::waitForNext(unsigned long maxWaitMs) {
+    unsigned long waitMs = std::min(msUntilNext(), maxWaitMs);
+    if (waitMs == 0) return;
+    if (_owner) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+    } else {
+        delay(waitMs);
+    }
+}
+
+void Scheduler::wake() {
+    if (_owner) xTaskNotifyGive(_owner);
+}
+
+bool Scheduler::earlier(TaskId a, TaskId b) const {
+    return (long)(_tasks[a].deadline - _tasks[b].deadline) < 0;
+}
+
+void Scheduler::push(TaskId id) {
+    _heap[_heapSize] = id;
+    siftUp(_heapSize++);
+}
+
+void Scheduler::remove(TaskId id) {
+    for (uint8_t i = 0; i < _heapSize; ++i) {
+        if (_heap[i] != id) continue;
+        _heap[i] = _heap[--_heapSize];
+        if (i < _heapSize) {
+            siftUp(i);
+            siftDown(i);
+        }
+        return;
+    }
+}
+
+void Scheduler::siftUp(uint8_t index) {
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!earlier(_heap[index], _heap[parent])) break;
+        std::swap(_heap[index], _heap[parent]);
+        index = parent;
+    }
+}
+
+void Scheduler::siftDown(uint8_t index) {
+    for (;;) {
+        uint8_t smallest = index;
+        uint8_t left = 2 * index + 1;
+        uint8_t right = left + 1;
+        if (left < _heapSize && earlier(_heap[left], _heap[smallest])) smallest = left;
+        if (right < _heapSize && earlier(_heap[right], _heap[smallest])) smallest = right;
+        if (smallest == index) break;
+        std::swap(_heap[index], _heap[smallest]);
+        index = smallest;
+    }
+}
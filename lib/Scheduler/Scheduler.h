@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+// Deadline-ordered task scheduler for the main loop. Periodic tasks sit in a
+// min-heap keyed on their next deadline; loop() runs whatever is due and then
+// blocks the loop task until the earliest deadline or an external wake().
+// While blocked the CPU idles, which lets power management light-sleep.
+class Scheduler {
+public:
+    typedef std::function<void()> TaskCallback;
+    typedef int8_t TaskId;
+    static const TaskId INVALID_TASK = -1;
+    static const uint8_t MAX_TASKS = 16;
+
+    Scheduler();
+
+    // Must be called from the task that will run runDue()/waitForNext().
+    void begin();
+
+    TaskId every(unsigned long intervalMs, TaskCallback callback, bool runImmediately = false);
+    void setInterval(TaskId id, unsigned long intervalMs, bool runImmediately = false);
+    void setEnabled(TaskId id, bool enabled);
+    unsigned long interval(TaskId id) const;
+
+    void runDue();
+    unsigned long msUntilNext() const;
+    void waitForNext(unsigned long maxWaitMs = 1000);
+
+    // Wakes the scheduler early (safe to call from other tasks).
+    static void wake();
+
+private:
+    struct Task {
+        TaskCallback callback;
+        unsigned long intervalMs = 0;
+        unsigned long deadline = 0;
+        bool enabled = false;
+    };
+
+    Task _tasks[MAX_TASKS];
+    uint8_t _taskCount = 0;
+    TaskId _heap[MAX_TASKS];
+    uint8_t _heapSize = 0;
+
+    static TaskHandle_t _owner;
+
+    bool earlier(TaskId a, TaskId b) const;
+    void push(TaskId id);
+    void remove(TaskId id);
+    void siftUp(uint8_t index);
+    void siftDown(uint8_t index);
+};
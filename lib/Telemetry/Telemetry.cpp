@@ -0,0 +1,155 @@
+#include "Telemetry.h"
+#include <Arduino.h>
+
+namespace {
+    portMUX_TYPE snapshotMux = portMUX_INITIALIZER_UNLOCKED;
+    Telemetry current[MAX_TANKS];
+    uint32_t nextSequence = 1;
+
+    void formatDisplayText(Telemetry& t, const Config& config) {
+        char* buf = t.displayText;
+        const size_t len = sizeof(t.displayText);
+        if (t.status == LevelStatus::SENSOR_ERROR) {
+            snprintf(buf, len, "ERROR");
+            return;
+        }
+        if (t.status == LevelStatus::RANGE_ERROR) {
+            snprintf(buf, len, "RANGE ERR%.2f", t.distanceCm);
+            return;
+        }
+        switch (config.displayMode) {
+            case DisplayMode::LEVEL:
+                if (config.outputUnit == OutputUnit::CM) {
+                    snprintf(buf, len, "%.1f cm", t.levelCm);
+                } else if (config.outputUnit == OutputUnit::IN) {
+                    snprintf(buf, len, "%.1f in", t.levelIn);
+                } else {
+                    snprintf(buf, len, "%.1f %%", t.percent);
+                }
+                break;
+            case DisplayMode::DISTANCE:
+                if (config.outputUnit == OutputUnit::IN) {
+                    snprintf(buf, len, "%.1f in", t.distanceIn);
+                } else if (config.outputUnit == OutputUnit::CM) {
+                    snprintf(buf, len, "%.1f cm", t.distanceCm);
+                } else {
+                    snprintf(buf, len, "%.1f %%", t.distanceCm);
+                }
+                break;
+            case DisplayMode::VOLUME:
+                if (!t.volumeValid) {
+                    snprintf(buf, len, "N/A");
+                } else if (config.volumeUnit == VolumeUnit::GALLONS) {
+                    snprintf(buf, len, "%.1f gal", t.gallons);
+                } else {
+                    snprintf(buf, len, "%.1f L", t.liters);
+                }
+                break;
+            case DisplayMode::TEXT:
+                snprintf(buf, len, "%s", config.deviceName.length() ? config.deviceName.c_str() : "WaterLevel");
+                break;
+            case DisplayMode::STATUS:
+                snprintf(buf, len, "%s", t.statusName());
+                break;
+            case DisplayMode::PERCENT:
+            default:
+                snprintf(buf, len, "%.1f%%", t.percent);
+                break;
+        }
+    }
+}
+
+Telemetry Telemetry::compute(const Config& config, float distanceCm) {
+    Telemetry t;
+    float tankDepth = config.tankDepth > 0 ? config.tankDepth : 100.0f;
+
+    t.distanceCm = distanceCm;
+    t.distanceIn = distanceCm / 2.54f;
+    if (distanceCm >= 0) {
+        t.levelCm = tankDepth - distanceCm;
+        if (t.levelCm < 0) t.levelCm = 0;
+        t.percent = t.levelCm / tankDepth * 100.0f;
+    }
+    t.levelIn = t.levelCm / 2.54f;
+
+    if (config.tankShape == TankShape::RECTANGLE && config.tankWidth > 0 && config.tankLength > 0) {
+        t.liters = (config.tankWidth * config.tankLength * t.levelCm) / 1000.0f;
+        t.volumeValid = true;
+    } else if (config.tankShape == TankShape::CYLINDER && config.tankDiameter > 0) {
+        float radius = config.tankDiameter / 2.0f;
+        float area = 3.14159265f * radius * radius;
+        t.liters = (area * t.levelCm) / 1000.0f; // cm^2 * cm = cm^3, /1000 = L
+        t.volumeValid = true;
+    }
+    t.gallons = t.liters * 0.264172f;
+
+    if (distanceCm < 0) {
+        t.status = LevelStatus::SENSOR_ERROR;
+    } else if (distanceCm > tankDepth) {
+        t.status = LevelStatus::RANGE_ERROR;
+    } else if (t.percent < config.alertLow) {
+        t.status = LevelStatus::LOW_LEVEL;
+    } else if (t.percent >= config.alertHigh) {
+        t.status = LevelStatus::FULL;
+    } else {
+        t.status = LevelStatus::OK;
+    }
+
+    formatDisplayText(t, config);
+
+    switch (config.displayMode) {
+        case DisplayMode::LEVEL:
+        case DisplayMode::VOLUME:
+            t.displayValue = tankDepth - distanceCm;
+            break;
+        case DisplayMode::DISTANCE:
+            t.displayValue = distanceCm;
+            break;
+        case DisplayMode::PERCENT:
+            t.displayValue = t.percent;
+            break;
+        default:
+            t.displayValue = atof(t.displayText);
+            break;
+    }
+
+    t.sampledAt = millis();
+    return t;
+}
+
+bool Telemetry::isError() const {
+    return status == LevelStatus::SENSOR_ERROR || status == LevelStatus::RANGE_ERROR;
+}
+
+const char* Telemetry::statusName() const {
+    switch (status) {
+        case LevelStatus::OK:           return "OK";
+        case LevelStatus::LOW_LEVEL:    return "LOW";
+        case LevelStatus::FULL:         return "FULL";
+        case LevelStatus::SENSOR_ERROR: return "ERROR";
+        case LevelStatus::RANGE_ERROR:  return "RANGE ERR";
+        default:                        return "";
+    }
+}
+
+void TelemetryStore::publish(Telemetry snapshot) {
+    portENTER_CRITICAL(&snapshotMux);
+    snapshot.sequence = nextSequence++;
+    if (snapshot.tank < MAX_TANKS) current[snapshot.tank] = snapshot;
+    portEXIT_CRITICAL(&snapshotMux);
+}
+
+Telemetry TelemetryStore::latest(uint8_t tank) {
+    if (tank >= MAX_TANKS) tank = 0;
+    portENTER_CRITICAL(&snapshotMux);
+    Telemetry snapshot = current[tank];
+    portEXIT_CRITICAL(&snapshotMux);
+    return snapshot;
+}
+
+uint32_t TelemetryStore::sequence() {
+    portENTER_CRITICAL(&snapshotMux);
+    uint32_t sequence = nextSequence - 1;
+    portEXIT_CRITICAL(&snapshotMux);
+    return sequence;
+}
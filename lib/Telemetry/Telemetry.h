@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include "ConfigManager.h"
+
+enum class LevelStatus : uint8_t {
+    OK,
+    LOW_LEVEL,
+    FULL,
+    SENSOR_ERROR, // No echo (timeout or disconnected sensor)
+    RANGE_ERROR   // Distance larger than the configured tank depth
+};
+
+// Everything derived from one sensor sample. Computed once per new sample
+// and shared read-only by the display, web API, MQTT and the level log.
+struct Telemetry {
+    float distanceCm = -1.0f;
+    float distanceIn = 0.0f;
+    float levelCm = 0.0f;
+    float levelIn = 0.0f;
+    float percent = 0.0f;
+    float liters = 0.0f;
+    float gallons = 0.0f;
+    bool volumeValid = false;  // false when tank dimensions are not configured
+    float displayValue = 0.0f; // numeric form for 7-segment displays
+    LevelStatus status = LevelStatus::SENSOR_ERROR;
+    char displayText[48] = "";
+    unsigned long sampledAt = 0; // millis() when the sample was taken
+    uint32_t sequence = 0;       // incremented by TelemetryStore on publish
+    uint8_t tank = 0;            // index of the tank the sample belongs to
+    uint32_t sampleIntervalMs = 0; // effective sampling interval of the tank
+    float ratePerMinute = 0.0f;  // filtered % per minute, when adaptive sampling is on
+
+    static Telemetry compute(const Config& config, float distanceCm);
+
+    bool isError() const;
+    const char* statusName() const;
+};
+
+// Holds the latest published snapshot of each tank. Safe to read from the web server task.
+// Sequence numbers are shared across tanks, so any new sample bumps them.
+class TelemetryStore {
+public:
+    static void publish(Telemetry snapshot);
+    static Telemetry latest(uint8_t tank = 0);
+    // Sequence of the newest snapshot of any tank
+    static uint32_t sequence();
+};
@@ -0,0 +1,53 @@
+#include "TimeSync.h"
+#include <time.h>
+#include <esp_timer.h>
+#include "Metrics.h"
+
+uint32_t TimeSync::_floorEpoch = 0;
+uint32_t TimeSync::_bootEpoch = 0;
+bool TimeSync::_started = false;
+
+namespace {
+    const char* NTP_SERVER_1 = "pool.ntp.org";
+    const char* NTP_SERVER_2 = "time.google.com";
+    // Anything before 2023-11-14 means the clock has never been set
+    const time_t MIN_VALID_EPOCH = 1700000000;
+
+    uint32_t uptimeSeconds() {
+        return (uint32_t)(esp_timer_get_time() / 1000000);
+    }
+}
+
+void TimeSync::begin(uint32_t floorEpoch) {
+    _floorEpoch = floorEpoch;
+}
+
+void TimeSync::startSync() {
+    // Timestamps are stored in UTC; the browser formats them in local time
+    configTime(0, 0, NTP_SERVER_1, NTP_SERVER_2);
+    if (!_started) {
+        Serial.println("[TIME] SNTP started");
+        _started = true;
+    }
+}
+
+void TimeSync::loop() {
+    if (_bootEpoch != 0 || !isSynced()) return;
+    uint32_t epoch = (uint32_t)time(nullptr);
+    _bootEpoch = epoch - uptimeSeconds();
+    Metrics::set("time_boot_epoch", (int32_t)_bootEpoch);
+    Serial.printf("[TIME] Clock synced: %u, boot epoch %u\n", (unsigned)epoch, (unsigned)_bootEpoch);
+}
+
+uint32_t TimeSync::now() {
+    if (isSynced()) return (uint32_t)time(nullptr);
+    return _floorEpoch + uptimeSeconds();
+}
+
+bool TimeSync::isSynced() {
+    return time(nullptr) >= MIN_VALID_EPOCH;
+}
+
+uint32_t TimeSync::bootEpoch() {
+    return _bootEpoch;
+}
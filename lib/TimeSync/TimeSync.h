@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+
+// Wall-clock time for timestamps. SNTP sets the system clock once Wi-Fi is up
+// (the clock then also survives deep sleep). Until then now() counts up from a
+// floor epoch, normally just after the newest stored reading, so timestamps
+// never run backwards across a reboot.
+class TimeSync {
+public:
+    static void begin(uint32_t floorEpoch);
+    // Starts (or restarts) SNTP; call whenever the station connects
+    static void startSync();
+    // Notices the first successful sync and records the boot epoch
+    static void loop();
+
+    // Seconds since the Unix epoch, or the monotonic fallback before the first sync
+    static uint32_t now();
+    static bool isSynced();
+    // Epoch of the last reset, known once synced (0 before)
+    static uint32_t bootEpoch();
+
+private:
+    static uint32_t _floorEpoch;
+    static uint32_t _bootEpoch;
+    static bool _started;
+};
@@ -0,0 +1,79 @@
+#include "AdaptiveRate.h"
+#include <math.h>
+
+namespace {
+    const float MS_PER_MINUTE = 60000.0f;
+    // Within this many percent of a threshold the interval is scaled down further
+    const float ALERT_BAND_PERCENT = 10.0f;
+    const float RATE_SMOOTHING = 0.5f;
+}
+
+AdaptiveRate::AdaptiveRate()
+    : _minInterval(1000), _maxInterval(60000), _alertLow(0.0f), _alertHigh(100.0f), _interval(1000),
+      _anchored(false), _anchorPercent(0.0f), _anchorMs(0), _rate(0.0f) {}
+
+void AdaptiveRate::configure(uint32_t minIntervalMs, uint32_t maxIntervalMs, float alertLow, float alertHigh) {
+    _minInterval = minIntervalMs > 0 ? minIntervalMs : 1;
+    _maxInterval = maxIntervalMs > _minInterval ? maxIntervalMs : _minInterval;
+    _alertLow = alertLow;
+    _alertHigh = alertHigh;
+    if (_interval < _minInterval) _interval = _minInterval;
+    if (_interval > _maxInterval) _interval = _maxInterval;
+}
+
+void AdaptiveRate::reset() {
+    _interval = _minInterval;
+    _anchored = false;
+    _rate = 0.0f;
+}
+
+uint32_t AdaptiveRate::update(uint32_t nowMs, float percent, bool valid) {
+    if (!valid) return _interval;
+    if (!_anchored) {
+        _anchored = true;
+        _anchorPercent = percent;
+        _anchorMs = nowMs;
+        return _interval;
+    }
+
+    float moved = percent - _anchorPercent;
+    float minutes = (nowMs - _anchorMs) / MS_PER_MINUTE;
+    if (minutes <= 0.0f) return _interval;
+    if (fabsf(moved) >= NOISE_PERCENT) {
+        _rate = _rate * (1.0f - RATE_SMOOTHING) + (moved / minutes) * RATE_SMOOTHING;
+        _anchorPercent = percent;
+        _anchorMs = nowMs;
+    } else {
+        // Still inside the noise band: the level cannot be moving faster than that band allows
+        float bound = NOISE_PERCENT / minutes;
+        if (fabsf(_rate) > bound) _rate = _rate > 0 ? bound : -bound;
+    }
+
+    uint32_t target = targetInterval(percent);
+    if (target < _interval) {
+        _interval = target; // speed up at once
+    } else {
+        uint32_t doubled = _interval > _maxInterval / 2 ? _maxInterval : _interval * 2;
+        _interval = doubled < target ? doubled : target;
+    }
+    if (_interval < _minInterval) _interval = _minInterval;
+    if (_interval > _maxInterval) _interval = _maxInterval;
+    return _interval;
+}
+
+uint32_t AdaptiveRate::targetInterval(float percent) const {
+    float speed = fabsf(_rate);
+    if (speed <= 0.0f) return _maxInterval;
+
+    float minutes = STEP_PERCENT / speed;
+    // Heading for a threshold: catch the crossing within a few samples
+    bool rising = _rate > 0;
+    float margin = rising ? _alertHigh - percent : percent - _alertLow;
+    if (margin > 0) {
+        float toAlert = margin / speed / SAMPLES_BEFORE_ALERT;
+        if (toAlert < minutes) minutes = toAlert;
+        if (margin < ALERT_BAND_PERCENT) minutes *= margin / ALERT_BAND_PERCENT;
+    }
+    float ms = minutes * MS_PER_MINUTE;
+    return ms >= _maxInterval ? _maxInterval : (uint32_t)ms;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+// Picks the next sampling interval of one tank from how the level is moving.
+// No Arduino dependencies so it can be exercised on a host.
+//
+// The rate of change is measured against an anchor sample and only once the
+// level has moved by more than the sensor noise, so jitter on a still tank
+// reads as zero. A moving level shortens the interval at once, enough that
+// each sample sees about STEP_PERCENT of change; approaching an alert
+// threshold shortens it further so the crossing is caught within a few
+// samples. A still level doubles the interval each sample up to the maximum.
+class AdaptiveRate {
+public:
+    static constexpr float NOISE_PERCENT = 0.5f;      // changes smaller than this are jitter
+    static constexpr float STEP_PERCENT = 1.0f;       // target change between two samples
+    static constexpr float SAMPLES_BEFORE_ALERT = 10; // samples between here and an approaching threshold
+
+    AdaptiveRate();
+
+    void configure(uint32_t minIntervalMs, uint32_t maxIntervalMs, float alertLow, float alertHigh);
+    // Starts over at the fastest rate, e.g. after the sensor was reconfigured
+    void reset();
+
+    // Feeds one filtered sample and returns the interval until the next one.
+    // Failed readings keep the current interval.
+    uint32_t update(uint32_t nowMs, float percent, bool valid);
+
+    uint32_t interval() const { return _interval; }
+    // Filtered rate of change in percent per minute, positive when filling
+    float ratePerMinute() const { return _rate; }
+
+private:
+    uint32_t targetInterval(float percent) const;
+
+    uint32_t _minInterval;
+    uint32_t _maxInterval;
+    float _alertLow;
+    float _alertHigh;
+    uint32_t _interval;
+    bool _anchored;
+    float _anchorPercent;
+    uint32_t _anchorMs;
+    float _rate;
+};
@@ -0,0 +1,168 @@
+#include "SensorArray.h"
+#include <Arduino.h>
+#include "Metrics.h"
+
+namespace {
+    const unsigned long RATE_WINDOW_MS = 5000;
+
+    bool isDue(unsigned long deadline, unsigned long now) {
+        return (long)(now - deadline) >= 0;
+    }
+
+    float median(const float* values, uint8_t n) {
+        float sorted[4];
+        for (uint8_t i = 0; i < n; ++i) {
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > values[i]) {
+                sorted[j] = sorted[j - 1];
+                j--;
+            }
+            sorted[j] = values[i];
+        }
+        return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0f;
+    }
+}
+
+SensorArray::SensorArray(WaterLevelSensor& primary)
+    : _primary(primary), _count(0), _baseInterval(0), _adaptive(false), _minInterval(0), _maxInterval(0), _lastPing(0), _pinged(false), _rateStart(0), _rateCount(0),
+      _samplesPerSecond(0.0f) {
+    _channels[0].sensor = &_primary;
+}
+
+void SensorArray::configure(const Config& config, unsigned long now) {
+    uint8_t count = config.tankCount >= 1 && config.tankCount <= MAX_TANKS ? config.tankCount : 1;
+    unsigned long interval = (unsigned long)(config.sensorReadInterval > 1 ? config.sensorReadInterval : 1) * 1000UL;
+    uint32_t minInterval = config.sampleMinInterval > 0 ? config.sampleMinInterval : 1;
+    uint32_t maxInterval = config.sampleMaxInterval > (int)minInterval ? config.sampleMaxInterval : minInterval;
+    bool reschedule = count != _count || interval != _baseInterval || config.adaptiveSampling != _adaptive ||
+                      minInterval != _minInterval || maxInterval != _maxInterval;
+
+    for (uint8_t i = 1; i < MAX_TANKS; ++i) {
+        Channel& c = _channels[i];
+        const TankConfig& tank = config.extraTanks[i - 1];
+        bool wanted = i < count && tank.triggerPin >= 0 && tank.echoPin >= 0;
+        if (!wanted && !c.sensor) continue;
+        if (wanted && c.sensor && c.triggerPin == tank.triggerPin && c.echoPin == tank.echoPin) continue;
+        if (c.owned) delete c.sensor;
+        c = Channel();
+        if (wanted) {
+            c.sensor = new WaterLevelSensor(tank.triggerPin, tank.echoPin, tank.depth);
+            c.owned = true;
+            c.triggerPin = tank.triggerPin;
+            c.echoPin = tank.echoPin;
+            Serial.printf("[SENSOR] Tank %u on trigger %d / echo %d\n", i, tank.triggerPin, tank.echoPin);
+        }
+        reschedule = true;
+    }
+    _count = count;
+    _baseInterval = interval;
+    _adaptive = config.adaptiveSampling;
+    _minInterval = minInterval;
+    _maxInterval = maxInterval;
+    for (uint8_t i = 0; i < MAX_TANKS; ++i) {
+        _channels[i].rate.configure(minInterval, maxInterval, config.alertLow, config.alertHigh);
+    }
+
+    if (!reschedule) return;
+    // Spread the tanks evenly over one interval so their pings interleave. Adaptive
+    // sampling starts fast and backs off once it has seen the level is still.
+    unsigned long start = _adaptive ? minInterval : interval;
+    for (uint8_t i = 0; i < _count; ++i) {
+        _channels[i].rate.reset();
+        _channels[i].interval = start;
+        _channels[i].nextDue = now + i * (start / _count);
+    }
+}
+
+int SensorArray::poll(unsigned long now) {
+    updateRate(now);
+    if (_pinged && now - _lastPing < SLOT_MS) return -1;
+
+    int due = -1;
+    for (uint8_t i = 0; i < _count; ++i) {
+        if (!isDue(_channels[i].nextDue, now)) continue;
+        if (due < 0 || (long)(_channels[i].nextDue - _channels[due].nextDue) < 0) due = i;
+    }
+    if (due < 0) return -1;
+
+    Channel& c = _channels[due];
+    c.lastSample = now;
+    c.nextDue += c.interval;
+    if (isDue(c.nextDue, now)) c.nextDue = now + c.interval; // fell behind: skip, don't burst
+    if (!c.sensor) {
+        c.echoUs = micros();
+        record(c, -1.0f); // no pins configured
+        return due;
+    }
+    float reading = c.sensor->readDistanceCm();
+    c.echoUs = micros(); // pulseIn returns as the echo ends
+    record(c, reading);
+    _lastPing = millis();
+    _pinged = true;
+    _rateCount++;
+    return due;
+}
+
+unsigned long SensorArray::msUntilDue(unsigned long now) const {
+    unsigned long wait = (unsigned long)-1;
+    for (uint8_t i = 0; i < _count; ++i) {
+        unsigned long until = isDue(_channels[i].nextDue, now) ? 0 : _channels[i].nextDue - now;
+        if (until < wait) wait = until;
+    }
+    if (_pinged && now - _lastPing < SLOT_MS) {
+        unsigned long slot = SLOT_MS - (now - _lastPing);
+        if (slot > wait) wait = slot;
+    }
+    return wait;
+}
+
+void SensorArray::adapt(uint8_t tank, float percent, bool valid, unsigned long now) {
+    if (!_adaptive || tank >= _count) return;
+    Channel& c = _channels[tank];
+    c.interval = c.rate.update(now, percent, valid);
+    c.nextDue = c.lastSample + c.interval;
+}
+
+unsigned long SensorArray::interval(uint8_t tank) const {
+    return tank < _count ? _channels[tank].interval : 0;
+}
+
+float SensorArray::ratePerMinute(uint8_t tank) const {
+    return _adaptive && tank < _count ? _channels[tank].rate.ratePerMinute() : 0.0f;
+}
+
+float SensorArray::distance(uint8_t tank) const {
+    return tank < _count ? _channels[tank].filtered : -1.0f;
+}
+
+uint32_t SensorArray::sampledAtUs(uint8_t tank) const {
+    return tank < _count ? _channels[tank].echoUs : 0;
+}
+
+// Median of the last few good readings; a single missed echo is ignored, a run of them is an error
+void SensorArray::record(Channel& channel, float reading) {
+    if (reading < 0) {
+        if (channel.errors < ERROR_THRESHOLD) channel.errors++;
+        if (channel.errors >= ERROR_THRESHOLD || channel.filled == 0) {
+            channel.filled = 0;
+            channel.next = 0;
+            channel.filtered = -1.0f;
+        }
+        return;
+    }
+    channel.errors = 0;
+    channel.window[channel.next] = reading;
+    channel.next = (channel.next + 1) % WINDOW;
+    if (channel.filled < WINDOW) channel.filled++;
+    channel.filtered = median(channel.window, channel.filled);
+}
+
+void SensorArray::updateRate(unsigned long now) {
+    if (_rateStart == 0) _rateStart = now;
+    unsigned long elapsed = now - _rateStart;
+    if (elapsed < RATE_WINDOW_MS) return;
+    _samplesPerSecond = _rateCount * 1000.0f / elapsed;
+    Metrics::set("sensor_samples_per_sec_x100", (int32_t)(_samplesPerSecond * 100.0f));
+    _rateStart = now;
+    _rateCount = 0;
+}
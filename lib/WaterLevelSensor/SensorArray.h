@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include "ConfigManager.h"
+#include "WaterLevelSensor.h"
+#include "AdaptiveRate.h"
+
+// Drives up to MAX_TANKS ultrasonic sensors, one per tank. Pings are time-sliced:
+// each tank is sampled once per read interval, with the tanks' slots spread
+// evenly across it and never closer than SLOT_MS, so a transducer never hears
+// the echo of its neighbour. Each tank keeps its own median filter. With
+// adaptive sampling each tank's interval follows its own level dynamics
+// (see AdaptiveRate) instead of the fixed read interval.
+class SensorArray {
+public:
+    // Longest echo (30 ms timeout) plus ring-down of the previous transducer
+    static const unsigned long SLOT_MS = 60;
+    // Consecutive failed pings before a tank reports a sensor error
+    static const uint8_t ERROR_THRESHOLD = 3;
+
+    explicit SensorArray(WaterLevelSensor& primary);
+
+    // Creates sensors for tanks whose pins changed and re-spreads the schedule.
+    // Filter state survives for tanks whose pins did not change.
+    void configure(const Config& config, unsigned long now);
+    uint8_t count() const { return _count; }
+
+    // Pings the tank that is due, if any; returns its index, or -1 if none is due yet
+    int poll(unsigned long now);
+    // Time until poll() has work, for the scheduler
+    unsigned long msUntilDue(unsigned long now) const;
+
+    // Feeds the tank's derived level back after a sample so adaptive sampling can
+    // pick its next interval. No-op when adaptive sampling is off.
+    void adapt(uint8_t tank, float percent, bool valid, unsigned long now);
+    // Current sampling interval of `tank` in ms
+    unsigned long interval(uint8_t tank) const;
+    // Filtered rate of change of `tank` in percent per minute (adaptive sampling only)
+    float ratePerMinute(uint8_t tank) const;
+
+    // Filtered distance of `tank` in cm, -1 while the sensor is failing
+    float distance(uint8_t tank) const;
+    // micros() when the newest echo of `tank` came back, for end-to-end latency
+    uint32_t sampledAtUs(uint8_t tank) const;
+    // Pings per second across all tanks over the last few seconds
+    float samplesPerSecond() const { return _samplesPerSecond; }
+
+private:
+    static const uint8_t WINDOW = 3;
+
+    struct Channel {
+        WaterLevelSensor* sensor = nullptr;
+        bool owned = false;
+        int triggerPin = -1;
+        int echoPin = -1;
+        unsigned long interval = 1000;
+        unsigned long nextDue = 0;
+        unsigned long lastSample = 0;
+        uint32_t echoUs = 0;
+        AdaptiveRate rate;
+        float window[WINDOW];
+        uint8_t filled = 0;
+        uint8_t next = 0;
+        uint8_t errors = 0;
+        float filtered = -1.0f;
+    };
+
+    void record(Channel& channel, float reading);
+    void updateRate(unsigned long now);
+
+    WaterLevelSensor& _primary;
+    Channel _channels[MAX_TANKS];
+    uint8_t _count;
+    unsigned long _baseInterval;
+    bool _adaptive;
+    uint32_t _minInterval;
+    uint32_t _maxInterval;
+    unsigned long _lastPing;
+    bool _pinged;
+    unsigned long _rateStart;
+    uint32_t _rateCount;
+    float _samplesPerSecond;
+};
@@ -1,42 +1,284 @@
 #include "WiFiManager.h"
 #include <WiFi.h>
+#include <Preferences.h>
+#include <esp_sleep.h>
+#include <time.h>
+#include "Metrics.h"
+
+#define CACHE_NAMESPACE "wificache"
+
+namespace {
+    const uint32_t CACHE_MAGIC = 0x57464332; // "WFC2"
+    const uint32_t LEASE_REUSE_MAX_S = 30 * 60;       // well inside common lease times; then DHCP again
+    const unsigned long FAST_CONNECT_TIMEOUT = 3000;  // ms before falling back to a full scan
+    const unsigned long FULL_CONNECT_TIMEOUT = 15000; // ms
+    const unsigned long BACKOFF_MIN = 1000;           // ms
+    const unsigned long BACKOFF_MAX = 60000;          // ms
+
+    struct WiFiCache {
+        uint32_t magic;
+        uint32_t ssidHash;
+        uint8_t bssid[6];
+        int32_t channel;
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint32_t leaseAt; // system clock when the address came from DHCP
+    };
+
+    // RTC copy survives deep sleep (and restarts); NVS copy survives power cycles
+    RTC_DATA_ATTR WiFiCache rtcCache;
+    WiFiCache cache;
+    bool cacheFromRtc = false;
+    bool leaseReused = false; // the current attempt applied the cached address
+
+    // The system clock keeps running through deep sleep; an SNTP sync in between
+    // makes the lease look old, which only costs one DHCP exchange
+    bool leaseReusable() {
+        if (!cacheFromRtc || cache.ip == 0) return false;
+        if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER) return false;
+        uint32_t age = (uint32_t)time(nullptr) - cache.leaseAt;
+        return age < LEASE_REUSE_MAX_S;
+    }
+
+    volatile bool gotIpEvent = false;
+    volatile bool disconnectedEvent = false;
+
+    uint32_t hashSsid(const String& ssid) {
+        uint32_t h = 2166136261u; // FNV-1a
+        for (unsigned int i = 0; i < ssid.length(); ++i) {
+            h = (h ^ (uint8_t)ssid[i]) * 16777619u;
+        }
+        return h;
+    }
+
+    bool loadCache(const String& ssid) {
+        uint32_t hash = hashSsid(ssid);
+        if (rtcCache.magic == CACHE_MAGIC && rtcCache.ssidHash == hash) {
+            cache = rtcCache;
+            cacheFromRtc = true;
+            return true;
+        }
+        cacheFromRtc = false;
+        Preferences prefs;
+        if (!prefs.begin(CACHE_NAMESPACE, true)) return false;
+        size_t len = prefs.getBytes("cache", &cache, sizeof(cache));
+        prefs.end();
+        return len == sizeof(cache) && cache.magic == CACHE_MAGIC && cache.ssidHash == hash;
+    }
+
+    void storeCache(const String& ssid) {
+        WiFiCache fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        fresh.magic = CACHE_MAGIC;
+        fresh.ssidHash = hashSsid(ssid);
+        memcpy(fresh.bssid, WiFi.BSSID(), sizeof(fresh.bssid));
+        fresh.channel = WiFi.channel();
+        fresh.ip = (uint32_t)WiFi.localIP();
+        fresh.gateway = (uint32_t)WiFi.gatewayIP();
+        fresh.subnet = (uint32_t)WiFi.subnetMask();
+        fresh.dns = (uint32_t)WiFi.dnsIP();
+        // A reused address keeps the age of the lease it came from
+        fresh.leaseAt = leaseReused ? cache.leaseAt : (uint32_t)time(nullptr);
+        rtcCache = fresh;
+
+        // Only touch flash when the AP or channel actually changed
+        bool sameAp = cache.magic == CACHE_MAGIC && cache.ssidHash == fresh.ssidHash &&
+                      cache.channel == fresh.channel && memcmp(cache.bssid, fresh.bssid, sizeof(fresh.bssid)) == 0;
+        cache = fresh;
+        if (sameAp) return;
+        Preferences prefs;
+        if (prefs.begin(CACHE_NAMESPACE, false)) {
+            prefs.putBytes("cache", &fresh, sizeof(fresh));
+            prefs.end();
+        }
+    }
+
+    void invalidateCache() {
+        rtcCache.magic = 0;
+        cache.magic = 0;
+        cacheFromRtc = false;
+    }
+}
 
 WiFiManager::WiFiManager() {}
 
-bool WiFiManager::connect(const Config& config) const {
-    if (config.wifiSsid.isEmpty() || config.wifiPassword.isEmpty())
-        return false;
+void WiFiManager::begin(const Config& config) {
+    _ssid = config.wifiSsid;
+    _password = config.wifiPassword;
+    _hostname = config.hostname;
+    _everConnected = false;
+    _backoffMs = BACKOFF_MIN;
 
+    if (!_eventsRegistered) {
+        WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t) { gotIpEvent = true; }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+        WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t) { disconnectedEvent = true; }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+        _eventsRegistered = true;
+    }
+
+    if (_state != State::IDLE) {
+        // Re-association with new settings: restart the interface so the hostname applies
+        WiFi.disconnect(true);
+        _state = State::IDLE;
+    }
+
+    if (_ssid.isEmpty() || _password.isEmpty()) {
+        _state = State::IDLE;
+        notify(WiFiLinkEvent::FAILED);
+        return;
+    }
+
+    WiFi.persistent(false);       // credentials live in our own config blob
+    WiFi.setAutoReconnect(false); // reconnection is supervised by loop()
     WiFi.mode(WIFI_STA);
+    if (!_hostname.isEmpty()) {
+        WiFi.setHostname(_hostname.c_str());
+    }
+
     // Handle static IP or DHCP
+    _staticIp = false;
     if (!config.staticIp.isEmpty() && !config.gateway.isEmpty() && !config.subnet.isEmpty()) {
         IPAddress ip, gw, sn;
-        ip.fromString(config.staticIp);
-        gw.fromString(config.gateway);
-        sn.fromString(config.subnet);
-        WiFi.config(ip, gw, sn);
-        if (!config.hostname.isEmpty()) {
-            WiFi.setHostname(config.hostname.c_str());
+        if (ip.fromString(config.staticIp) && gw.fromString(config.gateway) && sn.fromString(config.subnet) &&
+            ip[0] == gw[0] && ip[1] == gw[1] && ip[2] == gw[2]) {
+            WiFi.config(ip, gw, sn);
+            _staticIp = true;
+            Serial.printf("[WIFI] Using static IP: %s\n", config.staticIp.c_str());
         }
+    }
+    if (!_staticIp) {
+        WiFi.config(0U, 0U, 0U); // Force DHCP, in case a static IP was set before
+        Serial.println("[WIFI] Using DHCP (no valid static IP config)");
+    }
+
+    startAttempt(loadCache(_ssid));
+}
+
+bool WiFiManager::connect(const Config& config, unsigned long timeoutMs) {
+    // Blocking callers handle failure themselves, so no AP fallback via the callback
+    WiFiLinkCallback callback = _callback;
+    _callback = nullptr;
+    begin(config);
+    unsigned long start = millis();
+    while (_state != State::CONNECTED && _state != State::IDLE && millis() - start < timeoutMs) {
+        delay(20);
+        loop();
+    }
+    _callback = callback;
+    return isConnected();
+}
+
+void WiFiManager::startAttempt(bool fast) {
+    gotIpEvent = false;
+    disconnectedEvent = false;
+    _attemptStart = millis();
+    Metrics::increment("wifi_attempts");
+
+    if (fast) {
+        // A lease is only reused on a timer wake from deep sleep and for a bounded time,
+        // so battery mode still renews it with the router
+        leaseReused = !_staticIp && leaseReusable();
+        if (leaseReused) {
+            WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+        } else if (!_staticIp) {
+            WiFi.config(0U, 0U, 0U); // DHCP, in case an earlier attempt applied the cached address
+        }
+        WiFi.begin(_ssid.c_str(), _password.c_str(), cache.channel, cache.bssid);
+        _state = State::CONNECTING_FAST;
     } else {
-        // Use DHCP (do not call WiFi.config)
-        if (!config.hostname.isEmpty()) {
-            WiFi.setHostname(config.hostname.c_str());
+        leaseReused = false;
+        if (!_staticIp) {
+            WiFi.config(0U, 0U, 0U); // DHCP
+        }
+        WiFi.begin(_ssid.c_str(), _password.c_str());
+        _state = State::CONNECTING;
+    }
+}
+
+void WiFiManager::loop() {
+    unsigned long now = millis();
+    switch (_state) {
+        case State::CONNECTING_FAST:
+        case State::CONNECTING: {
+            if (gotIpEvent || WiFi.status() == WL_CONNECTED) {
+                handleConnected(now);
+                break;
+            }
+            unsigned long timeout = _state == State::CONNECTING_FAST ? FAST_CONNECT_TIMEOUT : FULL_CONNECT_TIMEOUT;
+            // Disconnect events during a fast attempt mean the cached AP is gone
+            bool failed = now - _attemptStart > timeout || (_state == State::CONNECTING_FAST && disconnectedEvent);
+            if (failed) handleAttemptFailed(now);
+            break;
         }
+        case State::CONNECTED:
+            if (disconnectedEvent || WiFi.status() != WL_CONNECTED) {
+                disconnectedEvent = false;
+                _linkLostAt = now;
+                Metrics::increment("wifi_disconnects");
+                notify(WiFiLinkEvent::DISCONNECTED);
+                WiFi.disconnect();
+                startAttempt(cache.magic == CACHE_MAGIC);
+            }
+            break;
+        case State::WAIT_RETRY:
+            if ((long)(now - _retryAt) >= 0) {
+                startAttempt(cache.magic == CACHE_MAGIC);
+            }
+            break;
+        case State::IDLE:
+        case State::AP:
+            break;
     }
-    WiFi.begin(config.wifiSsid.c_str(), config.wifiPassword.c_str());
+}
 
-    unsigned long startAttemptTime = millis();
-    const unsigned long timeout = 15000; // 15 seconds
+void WiFiManager::handleConnected(unsigned long now) {
+    bool fast = _state == State::CONNECTING_FAST;
+    _state = State::CONNECTED;
+    gotIpEvent = false;
+    disconnectedEvent = false;
+    _backoffMs = BACKOFF_MIN;
 
-    while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < timeout) {
-        delay(200);
+    Metrics::set("wifi_connect_ms", now - _attemptStart);
+    Metrics::increment(fast ? "wifi_fast_connects" : "wifi_full_connects");
+    if (_everConnected) {
+        Metrics::set("wifi_reconnect_ms", now - _linkLostAt);
+        Metrics::increment("wifi_reconnects");
     }
+    _everConnected = true;
+    storeCache(_ssid);
+    notify(WiFiLinkEvent::CONNECTED);
+}
 
-    return WiFi.status() == WL_CONNECTED;
+void WiFiManager::handleAttemptFailed(unsigned long now) {
+    WiFi.disconnect();
+    if (_state == State::CONNECTING_FAST) {
+        Metrics::increment("wifi_fast_misses");
+        invalidateCache();
+        startAttempt(false);
+        return;
+    }
+    if (!_everConnected) {
+        // Keep the old behaviour of falling back to AP mode when the first connect fails
+        _state = State::IDLE;
+        notify(WiFiLinkEvent::FAILED);
+        return;
+    }
+    _state = State::WAIT_RETRY;
+    _retryAt = now + _backoffMs;
+    _backoffMs = _backoffMs * 2 > BACKOFF_MAX ? BACKOFF_MAX : _backoffMs * 2;
 }
 
-void WiFiManager::startAP(const char* apSsid) const {
+void WiFiManager::notify(WiFiLinkEvent event) {
+    if (_callback) _callback(event);
+}
+
+void WiFiManager::setCallback(WiFiLinkCallback cb) {
+    _callback = cb;
+}
+
+void WiFiManager::startAP(const char* apSsid) {
+    _state = State::AP;
     WiFi.mode(WIFI_AP);
     WiFi.softAP(apSsid);
 }
@@ -44,3 +286,7 @@ void WiFiManager::startAP(const char* apSsid) const {
 bool WiFiManager::isConnected() const {
     return WiFi.status() == WL_CONNECTED;
 }
+
+bool WiFiManager::isConnecting() const {
+    return _state == State::CONNECTING_FAST || _state == State::CONNECTING;
+}
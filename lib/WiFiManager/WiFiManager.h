@@ -2,10 +2,53 @@
 #include <WString.h>
 #include "ConfigManager.h"
 
+enum class WiFiLinkEvent : uint8_t {
+    CONNECTED,
+    DISCONNECTED,  // link lost; the manager keeps retrying with backoff
+    FAILED         // never connected since begin(); caller may fall back to AP mode
+};
+
+typedef void (*WiFiLinkCallback)(WiFiLinkEvent event);
+
 class WiFiManager {
 public:
     WiFiManager();
-    bool connect(const Config& config) const;
-    void startAP(const char* apSsid = "WaterLevelSetup") const;
+
+    // Starts association without blocking. The last good BSSID/channel (and, on a timer
+    // wake within 30 minutes of the last DHCP exchange, its lease) are tried first; a
+    // full scan is the fallback.
+    // Calling it again with new settings drops the current link (or AP) and re-associates.
+    void begin(const Config& config);
+    // Blocking variant of begin() for callers that cannot continue offline (battery mode).
+    bool connect(const Config& config, unsigned long timeoutMs = 15000);
+    // Drives the connection state machine. Call periodically from the main loop;
+    // link callbacks are invoked from here.
+    void loop();
+
+    void setCallback(WiFiLinkCallback cb);
+    void startAP(const char* apSsid = "WaterLevelSetup");
     bool isConnected() const;
+    // An association attempt is in progress and loop() should be called often
+    bool isConnecting() const;
+
+private:
+    enum class State : uint8_t { IDLE, CONNECTING_FAST, CONNECTING, CONNECTED, WAIT_RETRY, AP };
+
+    State _state = State::IDLE;
+    String _ssid;
+    String _password;
+    String _hostname;
+    bool _staticIp = false;
+    bool _everConnected = false;
+    bool _eventsRegistered = false;
+    unsigned long _attemptStart = 0;
+    unsigned long _linkLostAt = 0;
+    unsigned long _retryAt = 0;
+    unsigned long _backoffMs = 0;
+    WiFiLinkCallback _callback = nullptr;
+
+    void startAttempt(bool fast);
+    void handleConnected(unsigned long now);
+    void handleAttemptFailed(unsigned long now);
+    void notify(WiFiLinkEvent event);
 };
@@ -0,0 +1,138 @@
+#include "WiFiScanCache.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string.h>
+
+namespace {
+    const uint8_t MAX_NETWORKS = 20;
+
+    struct ScanEntry {
+        char ssid[33];
+        int8_t rssi;
+        uint8_t channel;
+        bool secure;
+    };
+
+    struct ScanResult {
+        ScanEntry networks[MAX_NETWORKS];
+        uint8_t count;
+        bool valid;
+        unsigned long scannedAt;
+    };
+
+    portMUX_TYPE scanMux = portMUX_INITIALIZER_UNLOCKED;
+    ScanResult cached;
+    volatile bool scanRequested = false;
+    volatile bool scanning = false;
+
+    void appendEscaped(String& out, const char* s) {
+        for (; *s; ++s) {
+            char c = *s;
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if ((uint8_t)c < 0x20) {
+                char buf[7];
+                snprintf(buf, sizeof(buf), "\\u%04x", (uint8_t)c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    // Runs on the loop task once the driver reports a finished scan
+    void harvest(int16_t found) {
+        ScanResult fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        for (int16_t i = 0; i < found && fresh.count < MAX_NETWORKS; ++i) {
+            String ssid = WiFi.SSID(i);
+            if (ssid.isEmpty()) continue; // hidden network
+            // Results arrive strongest first, so the first entry per SSID is the one to keep
+            bool duplicate = false;
+            for (uint8_t j = 0; j < fresh.count && !duplicate; ++j) {
+                duplicate = strcmp(fresh.networks[j].ssid, ssid.c_str()) == 0;
+            }
+            if (duplicate) continue;
+            ScanEntry& e = fresh.networks[fresh.count++];
+            strncpy(e.ssid, ssid.c_str(), sizeof(e.ssid) - 1);
+            e.rssi = (int8_t)WiFi.RSSI(i);
+            e.channel = (uint8_t)WiFi.channel(i);
+            e.secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+        }
+        fresh.valid = true;
+        fresh.scannedAt = millis();
+        WiFi.scanDelete();
+
+        portENTER_CRITICAL(&scanMux);
+        cached = fresh;
+        portEXIT_CRITICAL(&scanMux);
+    }
+}
+
+bool WiFiScanCache::request(unsigned long maxAgeMs) {
+    portENTER_CRITICAL(&scanMux);
+    bool valid = cached.valid;
+    unsigned long age = millis() - cached.scannedAt;
+    portEXIT_CRITICAL(&scanMux);
+    if ((!valid || age > maxAgeMs) && !scanning) {
+        scanRequested = true;
+    }
+    return valid;
+}
+
+void WiFiScanCache::loop() {
+    if (scanning) {
+        int16_t result = WiFi.scanComplete();
+        if (result == WIFI_SCAN_RUNNING) return;
+        scanning = false;
+        if (result >= 0) {
+            harvest(result);
+            Serial.printf("[WIFI] Scan finished: %d networks\n", result);
+        } else {
+            Serial.println("[WIFI] Scan failed.");
+        }
+        return;
+    }
+    if (scanRequested) {
+        scanRequested = false;
+        // async=true returns immediately; completion is picked up on a later loop()
+        if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+            Serial.println("[WIFI] Could not start scan.");
+        } else {
+            scanning = true;
+        }
+    }
+}
+
+bool WiFiScanCache::isScanning() {
+    return scanning || scanRequested;
+}
+
+String WiFiScanCache::toJson() {
+    ScanResult snapshot;
+    portENTER_CRITICAL(&scanMux);
+    snapshot = cached;
+    portEXIT_CRITICAL(&scanMux);
+
+    String json;
+    json.reserve(48 + snapshot.count * 72);
+    json = "{\"scanning\":";
+    json += isScanning() ? "true" : "false";
+    json += ",\"age_ms\":";
+    json += snapshot.valid ? String(millis() - snapshot.scannedAt) : String("null");
+    json += ",\"networks\":[";
+    for (uint8_t i = 0; i < snapshot.count; ++i) {
+        const ScanEntry& e = snapshot.networks[i];
+        if (i > 0) json += ",";
+        json += "{\"ssid\":\"";
+        appendEscaped(json, e.ssid);
+        json += "\",\"rssi\":" + String(e.rssi);
+        json += ",\"channel\":" + String(e.channel);
+        json += ",\"secure\":";
+        json += e.secure ? "true" : "false";
+        json += "}";
+    }
+    json += "]}";
+    return json;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <WString.h>
+
+// Background Wi-Fi scan with a timestamped result cache, so HTTP handlers never
+// wait on the radio. request() is safe to call from any task; loop() must run on
+// the task that owns the Wi-Fi driver (the main loop).
+class WiFiScanCache {
+public:
+    // Queues a scan if the cached result is older than maxAgeMs (or missing).
+    // Returns true if a cached result exists, fresh or not.
+    static bool request(unsigned long maxAgeMs);
+    // Starts queued scans and harvests finished ones.
+    static void loop();
+    static bool isScanning();
+
+    // {"scanning":bool,"age_ms":n,"networks":[{"ssid","rssi","channel","secure"}...]}
+    static String toJson();
+};
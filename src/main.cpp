@@ -1,7 +1,9 @@
 #include <Arduino.h>
 #include "WaterLevelSensor.h"
+#include "SensorArray.h"
 #include "ConfigManager.h"
 #include "WiFiManager.h"
+#include "WiFiScanCache.h"
 #include "MQTTClient.h"
 #include "CustomWebServer.h"
 #include "DisplayManager.h"
@@ -11,6 +13,21 @@
 #include "SevenSegmentDisplayManager.h"
 #include "IDisplayManager.h"
 #include "SSD1306DisplayManager.h"
+#include "Telemetry.h"
+#include "Scheduler.h"
+#include "BatteryMode.h"
+#include "JobQueue.h"
+#include "BootProfiler.h"
+#include "Metrics.h"
+#include "TimeSync.h"
+#include "HistoryStore.h"
+#include "AnomalyDetector.h"
+#include "Forecast.h"
+#include "PumpController.h"
+#include "ModbusServer.h"
+#include "Fleet.h"
+#include "ResponseArena.h"
+#include <esp_pm.h>
 
 // Pin definitions (adjust as needed)
 constexpr int TRIGGER_PIN = 17;
@@ -18,6 +35,7 @@ constexpr int ECHO_PIN = 5;
 constexpr float TANK_HEIGHT_CM = 300.0f; // Set your tank height in cm
 
 WaterLevelSensor sensor(TRIGGER_PIN, ECHO_PIN, TANK_HEIGHT_CM);
+SensorArray sensors(sensor); // tank 0 is `sensor`; additional tanks use the pins in the config
 ConfigManager configManager;
 WiFiManager wifiManager;
 MQTTClient mqttClient;
@@ -38,47 +56,56 @@ DisplayManager display(DATA_PIN, CLK_PIN, CS_PIN, NUM_MATRICES);
 
 enum LedState { LED_OFF, LED_ON, LED_BLINK_SLOW, LED_BLINK_FAST };
 LedState ledState = LED_OFF;
-unsigned long lastLedToggle = 0;
 const unsigned long BLINK_INTERVAL_SLOW = 500;  // ms
 const unsigned long BLINK_INTERVAL_FAST = 150;  // ms
 bool ledOn = false;
 
-volatile bool shouldReboot = false;
-
-float lastDistance = -1.0f;
-
 SevenSegmentDisplayManager sevenSegmentDisplay(DATA_PIN, CLK_PIN, CS_PIN);
 
 SSD1306DisplayManager ssd1306Display(128, 64, 21, 22); // default pins, will re-init if needed
 
 IDisplayManager* displayPtr = nullptr;
 
-void setLedState(LedState state) {
-    ledState = state;
-    if (state == LED_ON) {
-        digitalWrite(LED_PIN, HIGH);
-    } else if (state == LED_OFF) {
-        digitalWrite(LED_PIN, LOW);
-    }
-    // For blinking, let loop() handle toggling
+// Main loop work items, run by deadline instead of polling millis()
+Scheduler scheduler;
+Scheduler::TaskId ledTask = Scheduler::INVALID_TASK;
+Scheduler::TaskId sampleTask = Scheduler::INVALID_TASK;
+Scheduler::TaskId displayFrameTask = Scheduler::INVALID_TASK;
+Scheduler::TaskId wifiTask = Scheduler::INVALID_TASK;
+Scheduler::TaskId batteryModeTask = Scheduler::INVALID_TASK;
+Scheduler::TaskId fleetTask = Scheduler::INVALID_TASK;
+
+const unsigned long PUBLISH_INTERVAL = 10000;       // ms
+const unsigned long MQTT_LOOP_INTERVAL = 250;       // ms, PubSubClient keepalive/receive
+const unsigned long WIFI_LOOP_INTERVAL = 100;       // ms, connection supervision while associating or scanning
+const unsigned long WIFI_IDLE_INTERVAL = 1000;      // ms, otherwise (link loss is flagged by an event)
+const unsigned long MQTT_SKIP_LOG_INTERVAL = 10000; // ms
+const unsigned long SENSOR_STATUS_INTERVAL = 15000; // ms
+const unsigned long LEVEL_LOG_INTERVAL = 60000;     // ms
+const unsigned long HEAP_STATS_INTERVAL = 30000;    // ms
+const unsigned long DISPLAY_FRAME_INTERVAL = 25;    // ms, MD_Parola animation frame, only while animating
+const unsigned long BATTERY_CONFIG_WINDOW = 300000; // ms awake after a cold boot before battery mode sleeps
+const unsigned long CONFIG_FLUSH_INTERVAL = 500;    // ms, write-back check
+const unsigned long CONFIG_WRITE_BACK_DELAY = 2000; // ms without changes before live edits hit NVS
+
+Telemetry telemetry; // Latest snapshot of the primary tank, owned by the loop task
+bool displayNeedsRedraw = true; // set when the display driver is (re)initialised
+uint32_t configGeneration = 0;
+
+void toggleLed() {
+    ledOn = !ledOn;
+    digitalWrite(LED_PIN, ledOn ? HIGH : LOW);
 }
 
-void handleLed() {
-    unsigned long now = millis();
-    if (ledState == LED_BLINK_SLOW) {
-        if (now - lastLedToggle > BLINK_INTERVAL_SLOW) {
-            ledOn = !ledOn;
-            digitalWrite(LED_PIN, ledOn ? HIGH : LOW);
-            lastLedToggle = now;
-        }
-    } else if (ledState == LED_BLINK_FAST) {
-        if (now - lastLedToggle > BLINK_INTERVAL_FAST) {
-            ledOn = !ledOn;
-            digitalWrite(LED_PIN, ledOn ? HIGH : LOW);
-            lastLedToggle = now;
-        }
+void setLedState(LedState state) {
+    ledState = state;
+    if (state == LED_BLINK_SLOW || state == LED_BLINK_FAST) {
+        scheduler.setInterval(ledTask, state == LED_BLINK_SLOW ? BLINK_INTERVAL_SLOW : BLINK_INTERVAL_FAST);
+        scheduler.setEnabled(ledTask, true);
+    } else {
+        scheduler.setEnabled(ledTask, false);
+        digitalWrite(LED_PIN, state == LED_ON ? HIGH : LOW);
     }
-    // LED_ON and LED_OFF are handled immediately in setLedState
 }
 
 String getUniqueAPSSID(const String& prefix = "WL-") {
@@ -93,18 +120,102 @@ void logInfo(const String& msg) {
     Serial.println("[INFO] " + msg);
 }
 
+// Runs the matrix frame task until the text just set has finished animating
+void animateDisplay() {
+    if (config.displayType == DisplayType::MATRIX) scheduler.setEnabled(displayFrameTask, true);
+}
+
 void showLogOnDisplay(const String& log) {
     static unsigned long lastDisplay = 0;
     unsigned long now = millis();
     // Only update if at least 500ms since last update to avoid flicker
     if (now - lastDisplay > 500) {
         display.displayText(log.c_str(), true); // Scroll the log message
+        animateDisplay();
         lastDisplay = now;
     }
 }
 
-// Forward declaration for getDisplayString
-String getDisplayString(const Config& config, float distance, float& percentOut);
+// Selects and starts the display driver for the current config. Called again at runtime
+// when the display type or geometry changes.
+void initDisplay() {
+    if (displayPtr) displayPtr->clear();
+    switch (config.displayType) {
+        case DisplayType::SSD1306:
+            // Re-init with correct size and pins
+            ssd1306Display.~SSD1306DisplayManager();
+            new (&ssd1306Display) SSD1306DisplayManager(config.ssd1306Width, config.ssd1306Height, 21, 22); // SDA=21, SCL=22 (adjust if needed)
+            ssd1306Display.begin();
+            displayPtr = &ssd1306Display;
+            Serial.println("[DISPLAY] SSD1306DisplayManager initialized.");
+            break;
+        case DisplayType::SEVEN_SEGMENT:
+            sevenSegmentDisplay.begin();
+            displayPtr = &sevenSegmentDisplay;
+            Serial.println("[DISPLAY] SevenSegmentDisplayManager initialized.");
+            break;
+        case DisplayType::MATRIX:
+        default: {
+            uint8_t hwType = MD_MAX72XX::FC16_HW;
+            switch (config.displayHardwareType) {
+                case DisplayHardwareType::GENERIC_HW:   hwType = MD_MAX72XX::GENERIC_HW; break;
+                case DisplayHardwareType::PAROLA_HW:    hwType = MD_MAX72XX::PAROLA_HW; break;
+                case DisplayHardwareType::ICSTATION_HW: hwType = MD_MAX72XX::ICSTATION_HW; break;
+                default: break;
+            }
+            display.setHardwareType(hwType);
+            display.begin();
+            display.setBrightness(config.displayBrightness);
+            displayPtr = &display;
+            Serial.println("[DISPLAY] Matrix DisplayManager initialized.");
+            break;
+        }
+    }
+    displayNeedsRedraw = true;
+}
+
+void onWiFiEvent(WiFiLinkEvent event) {
+    switch (event) {
+        case WiFiLinkEvent::CONNECTED: {
+            static bool firstConnect = true;
+            if (firstConnect) {
+                BootProfiler::milestone("boot_wifi_connected_ms");
+                Serial.printf("[BOOT] WiFi up %d ms after reset\n", (int)Metrics::get("boot_wifi_connected_ms"));
+                firstConnect = false;
+            }
+            setLedState(LED_ON); // Connected!
+            TimeSync::startSync();
+            logInfo("WiFi connected!");
+            logInfo("Local IP: " + WiFi.localIP().toString());
+            Serial.println("[WIFI] Connected. IP: " + WiFi.localIP().toString());
+            Serial.println("[MQTT] Connecting to MQTT...");
+            if (mqttClient.connect(config)) {
+                Serial.println("[MQTT] Connected to MQTT broker.");
+            } else {
+                Serial.println("[MQTT] MQTT connection failed (will retry in loop).");
+            }
+            break;
+        }
+        case WiFiLinkEvent::DISCONNECTED:
+            setLedState(LED_BLINK_SLOW); // Reconnecting
+            Serial.println("[WIFI] Connection lost, reconnecting...");
+            break;
+        case WiFiLinkEvent::FAILED: {
+            setLedState(LED_BLINK_FAST); // AP mode, blink fast
+            String apSsid = getUniqueAPSSID();
+            logInfo("WiFi connect failed. Starting AP: " + apSsid);
+            wifiManager.startAP(apSsid.c_str());
+            logInfo("AP mode started. Awaiting configuration.");
+            Serial.println("[WIFI] Started AP mode: " + apSsid);
+            break;
+        }
+    }
+}
+
+// Forward declarations for loop scheduling (defined after setup)
+void sampleSensor();
+void scheduleTasks();
+void enablePowerSaving();
 
 void setup() {
     pinMode(RESET_BUTTON_PIN, INPUT_PULLUP);
@@ -124,12 +235,11 @@ void setup() {
         }
     }
     Serial.begin(9600);
-    Logger::begin();
-    // Logger::setDisplayCallback(showLogOnDisplay); // Disabled: do not print logs on the display
-    delay(100);
 
     Serial.println("[BOOT] Starting Water Level Monitor...");
     pinMode(LED_PIN, OUTPUT);
+    scheduler.begin();
+    ledTask = scheduler.every(BLINK_INTERVAL_SLOW, toggleLed);
     setLedState(LED_BLINK_SLOW); // Start with slow blink (connecting)
 
     Serial.println("[CONFIG] Loading configuration...");
@@ -138,202 +248,277 @@ void setup() {
     } else {
         Serial.println("[CONFIG] Failed to load configuration!");
     }
+    BootProfiler::phase("boot_config_ms");
 
-    // --- DHCP fallback logic ---
-    bool staticOk = false;
-    if (config.staticIp.length() > 0 && config.gateway.length() > 0 && config.subnet.length() > 0) {
-        IPAddress ip, gw, sn;
-        if (ip.fromString(config.staticIp) && gw.fromString(config.gateway) && sn.fromString(config.subnet)) {
-            // Check if all are in the same subnet (simple check: first 3 octets match)
-            if ((ip[0] == gw[0] && ip[1] == gw[1] && ip[2] == gw[2]) &&
-                (ip[0] == sn[0] && ip[1] == sn[1] && ip[2] == sn[2])) {
-                WiFi.config(ip, gw, sn);
-                staticOk = true;
-                Serial.printf("[WIFI] Using static IP: %s\n", config.staticIp.c_str());
-            }
-        }
+    // Battery mode wakes skip the filesystem, Wi-Fi, web server and display entirely;
+    // until the mount below, log lines only go to Serial
+    if (config.batteryMode && BatteryMode::isWakeFromSleep()) {
+        BatteryMode::run(config, sensor, wifiManager, mqttClient); // enters deep sleep, does not return
     }
-    if (!staticOk) {
-        WiFi.config(0U, 0U, 0U); // Force DHCP
-        Serial.println("[WIFI] Using DHCP (no valid static IP config)");
+
+    // Mount the filesystem once, before anything else logs to it
+    if (!LittleFS.begin()) {
+        Serial.println("[FS] LittleFS mount failed!");
     }
+    Logger::begin();
+    LogManager::initLogFile();
+    AnomalyDetector::begin();
+    Forecast::begin();
+    TimeSync::begin(HistoryStore::lastTimestamp() + 1); // until SNTP syncs, count on from the newest reading
+    // Logger::setDisplayCallback(showLogOnDisplay); // Disabled: do not print logs on the display
+    BootProfiler::phase("boot_fs_ms");
+
+    // Start association first; the radio works in the background while the rest boots.
+    // MQTT and the LED follow link events.
+    logInfo("Attempting WiFi connection...");
+    wifiManager.setCallback(onWiFiEvent);
+    wifiManager.begin(config);
+    BootProfiler::phase("boot_wifi_start_ms");
+
+    Serial.println("[DISPLAY] Initializing display...");
+    initDisplay();
+    BootProfiler::phase("boot_display_ms");
 
     Serial.println("[SENSOR] Initializing sensor...");
-    float testDistance = sensor.readDistanceCm();
-    if (testDistance >= 0) {
-        Serial.println("[SENSOR] Sensor connected. Distance: " + String(testDistance, 1) + " cm");
+    sensor.setTankHeightCm(config.tankDepth);
+    sensors.configure(config, millis());
+    for (uint8_t i = 1; i < sensors.count(); ++i) HistoryStore::begin(i);
+    PumpController::begin(config); // relay off until the control task has a sample
+    sampleSensor(); // first reading goes straight to the display, before Wi-Fi is up
+    if (sensors.distance(0) >= 0) {
+        Serial.println("[SENSOR] Sensor connected. Distance: " + String(sensors.distance(0), 1) + " cm");
     } else {
         Serial.println("[SENSOR] Sensor NOT connected! (timeout or error)");
     }
+    BootProfiler::phase("boot_sensor_ms");
+    BootProfiler::milestone("boot_first_reading_ms");
 
-    logInfo("Attempting WiFi connection...");
-    bool wifiOk = wifiManager.connect(config);
-    if (!wifiOk) {
-        setLedState(LED_BLINK_FAST); // AP mode, blink fast
-        String apSsid = getUniqueAPSSID();
-        logInfo("WiFi connect failed. Starting AP: " + apSsid);
-        wifiManager.startAP(apSsid.c_str());
-        logInfo("AP mode started. Awaiting configuration.");
-        Serial.println("[WIFI] Started AP mode: " + apSsid);
-    } else {
-        setLedState(LED_ON); // Connected!
-        logInfo("WiFi connected!");
-        logInfo("Local IP: " + WiFi.localIP().toString());
-        Serial.println("[WIFI] Connected. IP: " + WiFi.localIP().toString());
-    }
+    JobQueue::begin(); // deferred work for web handlers (config commits, reboots)
 
     Serial.println("[WEB] Starting web server...");
+    Serial.printf("[WEB] Page arena: %u x %u bytes\n", ResponseArena::begin(), (unsigned)ResponseArena::BLOCK_SIZE);
     webServer.begin(configManager, sensor);
     Serial.println("[WEB] Web server started.");
+    if (config.modbusEnabled) ModbusServer::begin();
+    Fleet::configure(config);
+    BootProfiler::phase("boot_web_ms");
+
+    scheduleTasks();
+    enablePowerSaving();
+    BootProfiler::phase("boot_tasks_ms");
+    BootProfiler::printSummary();
+}
 
-    if (wifiOk) {
-        Serial.println("[MQTT] Connecting to MQTT...");
-        if (mqttClient.connect(config)) {
-            Serial.println("[MQTT] Connected to MQTT broker.");
-        } else {
-            Serial.println("[MQTT] MQTT connection failed (will retry in loop).");
+void refreshDisplay() {
+    if (config.displayType == DisplayType::SEVEN_SEGMENT) {
+        static float lastValue = NAN;
+        if (telemetry.displayValue != lastValue || displayNeedsRedraw) {
+            displayPtr->displayNumber(telemetry.displayValue);
+            lastValue = telemetry.displayValue;
         }
     } else {
-        Serial.println("[MQTT] Skipping MQTT setup (WiFi not connected).");
+        bool scroll = config.displayScrollEnabled;
+        static String lastDisplayStr;
+        static bool lastScroll = false;
+        if (lastDisplayStr != telemetry.displayText || scroll != lastScroll || displayNeedsRedraw) {
+            displayPtr->displayText(telemetry.displayText, scroll);
+            lastDisplayStr = telemetry.displayText;
+            lastScroll = scroll;
+            animateDisplay();
+        }
     }
+    displayNeedsRedraw = false;
+}
 
-    Serial.println("[DISPLAY] Initializing display...");
-    if (config.displayType == "ssd1306") {
-        // Re-init with correct size and pins
-        new (&ssd1306Display) SSD1306DisplayManager(config.ssd1306Width, config.ssd1306Height, 21, 22); // SDA=21, SCL=22 (adjust if needed)
-        ssd1306Display.begin();
-        displayPtr = &ssd1306Display;
-        Serial.println("[DISPLAY] SSD1306DisplayManager initialized.");
-    } else if (config.displayType == "sevensegment") {
-        sevenSegmentDisplay.begin();
-        displayPtr = &sevenSegmentDisplay;
-        Serial.println("[DISPLAY] SevenSegmentDisplayManager initialized.");
-    } else {
-        uint8_t hwType = MD_MAX72XX::FC16_HW;
-        if (config.displayHardwareType == "GENERIC_HW") hwType = MD_MAX72XX::GENERIC_HW;
-        else if (config.displayHardwareType == "PAROLA_HW") hwType = MD_MAX72XX::PAROLA_HW;
-        else if (config.displayHardwareType == "ICSTATION_HW") hwType = MD_MAX72XX::ICSTATION_HW;
-        display.setHardwareType(hwType);
-        display.begin();
-        display.setBrightness(config.displayBrightness);
-        displayPtr = &display;
-        Serial.println("[DISPLAY] Matrix DisplayManager initialized.");
+// Derives the telemetry snapshot once for the tank's current sample and config.
+// A fresh sample also drives adaptive sampling. The display follows the primary tank.
+void publishTelemetry(uint8_t tank, bool freshSample = false) {
+    Telemetry t = Telemetry::compute(config.forTank(tank), sensors.distance(tank));
+    t.tank = tank;
+    if (freshSample && tank == 0) PumpController::feed(t.percent, !t.isError(), sensors.sampledAtUs(tank)); // before anything slower
+    if (freshSample) sensors.adapt(tank, t.percent, !t.isError(), millis());
+    t.sampleIntervalMs = sensors.interval(tank);
+    t.ratePerMinute = sensors.ratePerMinute(tank);
+    TelemetryStore::publish(t);
+    if (tank != 0) return;
+    telemetry = TelemetryStore::latest();
+    refreshDisplay();
+}
+
+void publishAllTelemetry() {
+    for (uint8_t i = 0; i < sensors.count(); ++i) publishTelemetry(i);
+}
+
+// Pings whichever tank's slot is due, then sleeps until the next slot
+void sampleSensor() {
+    int tank = sensors.poll(millis());
+    if (tank >= 0) publishTelemetry(tank, true);
+    scheduler.setInterval(sampleTask, sensors.msUntilDue(millis()));
+}
+
+// Primary tank on the base topic, additional tanks on <topic>/tank/<n>
+void publishMqtt() {
+    if (!mqttClient.isConnected()) return;
+    for (uint8_t i = 0; i < sensors.count(); ++i) {
+        Telemetry t = TelemetryStore::latest(i);
+        String payload = "{\"display\":\"" + String(t.displayText) + "\",\"percent\":" + String(t.percent, 1) + ",\"distance\":" + String(t.distanceCm, 1) + ",\"status\":\"" + t.statusName() + "\",\"interval_ms\":" + String(t.sampleIntervalMs) + "}";
+        mqttClient.publish(i == 0 ? config.mqttTopic : config.mqttTopic + "/tank/" + String(i), payload);
     }
+    if (config.pumpEnabled) mqttClient.publish(config.mqttTopic + "/pump", PumpController::toJson());
+}
 
-    LittleFS.begin();
-    LogManager::initLogFile();
-    // Create CSV file with header if it doesn't exist
-    if (!LittleFS.exists("/level_log.csv")) {
-        File f = LittleFS.open("/level_log.csv", "w");
-        if (f) {
-            f.println("timestamp,distance_cm,percent,level_cm,level_in,liters,gallons");
-            f.close();
-        }
+void logSensorStatus() {
+    if (telemetry.status != LevelStatus::SENSOR_ERROR) {
+        Serial.println("[SENSOR] Sensor connected. Display: " + String(telemetry.displayText));
+    } else {
+        Serial.println("[SENSOR] Sensor NOT connected! (timeout or error)");
     }
 }
 
-unsigned long lastPublish = 0;
-const unsigned long publishInterval = 10000; // 10 seconds
+void logLevel() {
+    // A sample that fell due meanwhile reaches the pump before the flash writes below
+    if (sensors.msUntilDue(millis()) == 0) sampleSensor();
+    uint32_t now = TimeSync::now();
+    for (uint8_t i = 0; i < sensors.count(); ++i) {
+        LogManager::logLevelReading(now, TelemetryStore::latest(i).distanceCm, i);
+    }
 
-void loop() {
-    handleLed();
-    if (shouldReboot) {
-        delay(500); // Allow time for HTTP response to flush
-        ESP.restart();
+    Telemetry primary = TelemetryStore::latest();
+    AnomalyEvent event;
+    if (!primary.isError() && AnomalyDetector::feed(now, primary.percent, config.anomalySigma, event) &&
+        mqttClient.isConnected()) {
+        mqttClient.publish(config.mqttTopic + "/anomaly", AnomalyDetector::eventJson(event));
     }
-    if (WiFi.status() == WL_CONNECTED) {
-        mqttClient.loop();
-    } else {
-        static unsigned long lastNoMqttLog = 0;
-        unsigned long now = millis();
-        if (now - lastNoMqttLog > 10000) {
-            Serial.println("[MQTT] Skipped: WiFi not connected.");
-            lastNoMqttLog = now;
-        }
+    if (Forecast::update(now, config) && !primary.isError() && mqttClient.isConnected()) {
+        mqttClient.publish(config.mqttTopic + "/forecast", Forecast::summaryJson(now, primary.percent, config.alertLow));
     }
+}
 
-    // Show live water level in selected unit, but only every sensorReadInterval seconds
-    static unsigned long lastSensorRead = 0;
-    unsigned long now = millis();
+bool wifiSettingsChanged(const Config& a, const Config& b) {
+    return a.wifiSsid != b.wifiSsid || a.wifiPassword != b.wifiPassword || a.staticIp != b.staticIp ||
+           a.gateway != b.gateway || a.subnet != b.subnet || a.hostname != b.hostname;
+}
+
+bool mqttSettingsChanged(const Config& a, const Config& b) {
+    return a.mqttServer != b.mqttServer || a.mqttPort != b.mqttPort || a.mqttUser != b.mqttUser ||
+           a.mqttPassword != b.mqttPassword;
+}
+
+bool displayDriverChanged(const Config& a, const Config& b) {
+    return a.displayType != b.displayType || a.displayHardwareType != b.displayHardwareType ||
+           a.ssd1306Width != b.ssd1306Width || a.ssd1306Height != b.ssd1306Height;
+}
+
+// Re-reads config only when the web server saved a new one, and reconfigures just the
+// subsystems whose settings changed
+void applyConfigChanges() {
+    uint32_t generation = ConfigManager::generation();
+    if (generation == configGeneration) return;
+    configGeneration = generation;
+    Config previous = config;
     configManager.load(config);
-    sensor.setTankHeightCm(config.tankDepth);
-    float percent = 0.0f;
-    String displayStr = getDisplayString(config, lastDistance, percent);
-    if (config.displayType == "sevensegment") {
-        static float lastValue = NAN;
-        float value = 0.0f;
-        if (config.displayMode == "level" || config.displayMode == "volume") {
-            value = config.tankDepth - lastDistance;
-        } else if (config.displayMode == "distance") {
-            value = lastDistance;
-        } else if (config.displayMode == "percent") {
-            value = percent;
-        } else {
-            value = displayStr.toFloat();
-        }
-        if (value != lastValue) {
-            displayPtr->displayNumber(value);
-            lastValue = value;
-        }
-    } else {
-        bool scroll = config.displayScrollEnabled;
-        static String lastDisplayStr;
-        static bool lastScroll = false;
-        if (config.displayScrollEnabled != lastScroll) {
-            lastDisplayStr = "";
-            lastScroll = config.displayScrollEnabled;
-        }
-        if (displayStr != lastDisplayStr || scroll != lastScroll) {
-            displayPtr->displayText(displayStr.c_str(), scroll);
-            lastDisplayStr = displayStr;
-            lastScroll = scroll;
+
+    if (wifiSettingsChanged(previous, config)) {
+        Serial.println("[WIFI] Settings changed, re-associating...");
+        mqttClient.disconnect();
+        setLedState(LED_BLINK_SLOW);
+        wifiManager.begin(config); // MQTT reconnects from the CONNECTED event
+    } else if (mqttSettingsChanged(previous, config)) {
+        Serial.println("[MQTT] Settings changed, reconnecting...");
+        mqttClient.disconnect();
+        if (wifiManager.isConnected() && !mqttClient.connect(config)) {
+            Serial.println("[MQTT] MQTT connection failed (will retry in loop).");
         }
-        if (config.displayType == "matrix") display.update();
     }
 
-    // MQTT publish (every publishInterval)
-    static unsigned long lastPublish = 0;
-    if (now - lastPublish > publishInterval) {
-        lastPublish = now;
-        if (mqttClient.isConnected()) {
-            String payload = "{\"display\":\"" + displayStr + "\",\"percent\":" + String(percent, 1) + ",\"distance\":" + String(lastDistance, 1) + "}";
-            mqttClient.publish(config.mqttTopic, payload);
-        }
+    if (displayDriverChanged(previous, config)) {
+        Serial.println("[DISPLAY] Display settings changed, switching driver...");
+        initDisplay();
+        scheduler.setEnabled(displayFrameTask, false); // restarted by the next redraw
+    } else if (config.displayBrightness != previous.displayBrightness && config.displayType == DisplayType::MATRIX) {
+        display.setBrightness(config.displayBrightness);
     }
 
-    // Periodically log sensor connection status
-    static unsigned long lastSensorStatus = 0;
-    if (now - lastSensorStatus > 15000) {
-        lastSensorStatus = now;
-        if (lastDistance >= 0) {
-            Serial.println("[SENSOR] Sensor connected. Display: " + displayStr);
+    sensor.setTankHeightCm(config.tankDepth);
+    sensors.configure(config, millis());
+    scheduler.setInterval(sampleTask, sensors.msUntilDue(millis()));
+    scheduler.setEnabled(batteryModeTask, config.batteryMode);
+    PumpController::configure(config);
+    Fleet::configure(config);
+    scheduler.setInterval(fleetTask, config.fleetInterval * 1000UL);
+    scheduler.setEnabled(fleetTask, config.fleetBroadcast);
+    if (config.modbusEnabled != previous.modbusEnabled) {
+        if (config.modbusEnabled) {
+            ModbusServer::begin();
         } else {
-            Serial.println("[SENSOR] Sensor NOT connected! (timeout or error)");
+            ModbusServer::end();
         }
     }
+    publishAllTelemetry();
+}
 
-    // Periodic water level logging
-    static unsigned long lastLog = 0;
-    const unsigned long logInterval = 60000; // 60 seconds
-    if (now - lastLog > logInterval) {
-        lastLog = now;
-        float tankDepth = config.tankDepth;
-        float distance = lastDistance;
-        float levelCm = tankDepth - distance;
-        if (levelCm < 0) levelCm = 0;
-        float levelIn = levelCm / 2.54f;
-        float liters = 0.0f;
-        float gallons = 0.0f;
-        if (config.tankShape == "rectangle" && config.tankWidth > 0 && config.tankLength > 0) {
-            liters = (config.tankWidth * config.tankLength * levelCm) / 1000.0f;
-        } else if (config.tankShape == "cylinder" && config.tankDiameter > 0) {
-            float radius = config.tankDiameter / 2.0f;
-            float area = 3.14159265f * radius * radius;
-            liters = (area * levelCm) / 1000.0f;
-        }
-        gallons = liters * 0.264172f;
-        float percent = (distance < 0 || tankDepth <= 0) ? 0.0f : ((tankDepth - distance) / tankDepth * 100.0f);
-        if (percent < 0) percent = 0;
-        LogManager::logLevelReading(millis()/1000UL, distance, percent, levelCm, levelIn, liters, gallons);
+void scheduleTasks() {
+    configGeneration = ConfigManager::generation();
+    ConfigManager::setChangeCallback(Scheduler::wake);
+    sensor.setTankHeightCm(config.tankDepth);
+
+    wifiTask = scheduler.every(WIFI_LOOP_INTERVAL, []() {
+        wifiManager.loop();
+        WiFiScanCache::loop();
+        TimeSync::loop();
+        unsigned long interval = wifiManager.isConnecting() || WiFiScanCache::isScanning() ? WIFI_LOOP_INTERVAL : WIFI_IDLE_INTERVAL;
+        if (interval != scheduler.interval(wifiTask)) scheduler.setInterval(wifiTask, interval);
+    });
+    sampleTask = scheduler.every(sensors.msUntilDue(millis()), sampleSensor); // setup() took the first sample
+    displayFrameTask = scheduler.every(DISPLAY_FRAME_INTERVAL, []() {
+        if (!display.update()) scheduler.setEnabled(displayFrameTask, false);
+    });
+    animateDisplay(); // the first reading was put on the display during setup()
+    scheduler.every(MQTT_LOOP_INTERVAL, []() {
+        if (WiFi.status() == WL_CONNECTED) mqttClient.loop();
+    });
+    scheduler.every(MQTT_SKIP_LOG_INTERVAL, []() {
+        if (WiFi.status() != WL_CONNECTED) Serial.println("[MQTT] Skipped: WiFi not connected.");
+    });
+    scheduler.every(CONFIG_FLUSH_INTERVAL, []() { configManager.flushIfIdle(CONFIG_WRITE_BACK_DELAY); });
+    scheduler.every(PUBLISH_INTERVAL, publishMqtt);
+    scheduler.every(SENSOR_STATUS_INTERVAL, logSensorStatus);
+    scheduler.every(LEVEL_LOG_INTERVAL, logLevel);
+    scheduler.every(HEAP_STATS_INTERVAL, ResponseArena::updateHeapStats);
+    fleetTask = scheduler.every(config.fleetInterval * 1000UL, []() {
+        if (WiFi.status() == WL_CONNECTED) Fleet::broadcast(config, sensors.count());
+    });
+    scheduler.setEnabled(fleetTask, config.fleetBroadcast);
+
+    // After a cold boot the web UI stays up for a while so battery mode can be reconfigured
+    batteryModeTask = scheduler.every(BATTERY_CONFIG_WINDOW, []() {
+        Serial.println("[BATTERY] Configuration window closed, entering battery mode.");
+        configManager.flush();
+        BatteryMode::run(config, sensor, wifiManager, mqttClient);
+    });
+    scheduler.setEnabled(batteryModeTask, config.batteryMode);
+}
+
+// Lets the idle task drop the CPU clock (and light-sleep where the SDK supports it)
+// while loop() is blocked waiting for the next deadline.
+void enablePowerSaving() {
+#if CONFIG_PM_ENABLE
+    esp_pm_config_esp32_t pm;
+    pm.max_freq_mhz = 240;
+    pm.min_freq_mhz = 80;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    pm.light_sleep_enable = true;
+#else
+    pm.light_sleep_enable = false;
+#endif
+    if (esp_pm_configure(&pm) != ESP_OK) {
+        Serial.println("[POWER] Power management not available.");
     }
+#endif
+}
+
+void loop() {
+    applyConfigChanges();
+    scheduler.runDue();
+    scheduler.waitForNext();
 }
@@ -0,0 +1,156 @@
+#include <unity.h>
+#include <math.h>
+#include "AnomalyLogic.h"
+
+static const uint32_t DAY0 = 1750032000; // UTC midnight
+static const float SIGMA = 2.0f;
+
+struct Events {
+    int high = 0;
+    int low = 0;
+    int minimumFlow = 0;
+    AnomalyEvent last;
+};
+
+static AnomalyState state;
+static float level;
+
+static void feedSample(uint32_t timestamp, Events& events) {
+    AnomalyEvent event;
+    if (!AnomalyLogic::feed(state, timestamp, level, SIGMA, event)) return;
+    events.last = event;
+    if (event.type == AnomalyType::HIGH_CONSUMPTION) events.high++;
+    if (event.type == AnomalyType::LOW_CONSUMPTION) events.low++;
+    if (event.type == AnomalyType::MINIMUM_FLOW) events.minimumFlow++;
+}
+
+// A synthetic day: refilled overnight, 1.5 %/h drawn every hour except a quiet
+// 03:00, plus `leak` %/h on top of every hour
+static void feedDay(uint32_t dayStart, float leak, uint16_t samplesPerHour, Events& events) {
+    level = 90.0f;
+    for (uint8_t h = 0; h < 24; ++h) {
+        float consumption = (h == 3 ? 0.0f : 1.5f) + leak;
+        for (uint16_t k = 0; k < samplesPerHour; ++k) {
+            feedSample(dayStart + h * 3600 + k * (3600 / samplesPerHour), events);
+            level -= consumption / samplesPerHour;
+        }
+    }
+}
+
+void setUp(void) {
+    AnomalyLogic::reset(state);
+    level = 90.0f;
+}
+
+void tearDown(void) {}
+
+void test_welford_matches_the_sample_statistics() {
+    WelfordStat stat = {0, 0.0f, 0.0f};
+    const float values[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    for (float v : values) AnomalyLogic::add(stat, v);
+    TEST_ASSERT_EQUAL(8, stat.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 5.0f, stat.mean);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, sqrtf(32.0f / 7.0f), AnomalyLogic::stddev(stat));
+}
+
+void test_welford_saturates_and_follows_a_lasting_change() {
+    WelfordStat stat = {0, 0.0f, 0.0f};
+    for (int i = 0; i < 200; ++i) AnomalyLogic::add(stat, (i % 2) ? 0.0f : 2.0f);
+    TEST_ASSERT_EQUAL(ANOMALY_MAX_COUNT, stat.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 1.0f, stat.mean);
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 1.0f, AnomalyLogic::stddev(stat));
+
+    for (int i = 0; i < 300; ++i) AnomalyLogic::add(stat, 5.0f);
+    TEST_ASSERT_EQUAL(ANOMALY_MAX_COUNT, stat.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 5.0f, stat.mean);
+    // The old spread decays instead of accumulating
+    TEST_ASSERT_LESS_THAN(0.5f, AnomalyLogic::stddev(stat));
+    TEST_ASSERT_TRUE(stat.m2 >= 0.0f);
+}
+
+void test_noise_band_anchors_drops_and_ignores_refills() {
+    AnomalyEvent event;
+    const float readings[] = {
+        50.0f, 49.7f, 50.2f, // jitter inside the band
+        49.4f,               // 0.6 below the anchor: consumption
+        49.6f, 49.2f,        // jitter around the new anchor
+        52.0f,               // refill moves the anchor up without counting
+        51.0f                // 1.0 below the refilled anchor
+    };
+    for (uint8_t i = 0; i < sizeof(readings) / sizeof(readings[0]); ++i) {
+        TEST_ASSERT_FALSE(AnomalyLogic::feed(state, DAY0 + i * 60, readings[i], SIGMA, event));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.6f, state.hourConsumption);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 51.0f, state.anchor);
+    TEST_ASSERT_EQUAL(8, state.hourSamples);
+}
+
+void test_short_hours_are_not_evaluated() {
+    Events events;
+    feedDay(DAY0, 0.0f, ANOMALY_MIN_HOUR_SAMPLES / 2, events);
+    feedSample(DAY0 + 24 * 3600, events);
+    for (uint8_t h = 0; h < ANOMALY_HOURS; ++h) TEST_ASSERT_EQUAL(0, state.hourly[h].count);
+    TEST_ASSERT_EQUAL(0, state.minimumFlow.count);
+
+    // A full hour is folded into its hour-of-day
+    setUp();
+    for (uint16_t k = 0; k < ANOMALY_MIN_HOUR_SAMPLES; ++k) feedSample(DAY0 + 5 * 3600 + k * 60, events);
+    feedSample(DAY0 + 6 * 3600, events);
+    TEST_ASSERT_EQUAL(1, state.hourly[5].count);
+    TEST_ASSERT_EQUAL(1, state.dayHours);
+}
+
+void test_steady_days_raise_nothing() {
+    Events events;
+    for (uint32_t d = 0; d < 10; ++d) feedDay(DAY0 + d * 86400, 0.0f, 60, events);
+    TEST_ASSERT_EQUAL(0, events.high + events.low + events.minimumFlow);
+    TEST_ASSERT_EQUAL(9, state.minimumFlow.count); // the tenth day is still open
+    // The quiet hour only sees the drop left over from 02:00 below the noise band
+    TEST_ASSERT_LESS_THAN(1.0f, state.minimumFlow.mean);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 1.5f, state.hourly[12].mean);
+}
+
+void test_minimum_flow_wins_when_the_day_closes() {
+    Events events;
+    for (uint32_t d = 0; d < 10; ++d) feedDay(DAY0 + d * 86400, 0.0f, 60, events);
+    Events leak;
+    feedDay(DAY0 + 10 * 86400, 1.5f, 60, leak);
+    TEST_ASSERT_GREATER_THAN(0, leak.high);       // hourly events through the day
+    TEST_ASSERT_EQUAL(0, leak.minimumFlow);
+
+    // The first sample of the next day closes hour 23 and the day; both are anomalous
+    Events close;
+    level = 90.0f;
+    feedSample(DAY0 + 11 * 86400, close);
+    TEST_ASSERT_EQUAL(1, close.minimumFlow);
+    TEST_ASSERT_EQUAL(0, close.high);
+    TEST_ASSERT_TRUE(close.last.type == AnomalyType::MINIMUM_FLOW);
+    TEST_ASSERT_EQUAL(DAY0 + 11 * 86400, close.last.timestamp);
+    TEST_ASSERT_FLOAT_WITHIN(0.3f, 1.5f, close.last.value);
+    TEST_ASSERT_GREATER_OR_EQUAL(SIGMA, close.last.deviation);
+}
+
+void test_zero_sigma_disables_events() {
+    Events events;
+    for (uint32_t d = 0; d < 10; ++d) feedDay(DAY0 + d * 86400, 0.0f, 60, events);
+    AnomalyEvent event;
+    level = 90.0f;
+    for (uint16_t k = 0; k < 60; ++k) {
+        TEST_ASSERT_FALSE(AnomalyLogic::feed(state, DAY0 + 10 * 86400 + k * 60, level, 0.0f, event));
+        level -= 0.2f;
+    }
+    TEST_ASSERT_FALSE(AnomalyLogic::feed(state, DAY0 + 10 * 86400 + 3600, level, 0.0f, event));
+    TEST_ASSERT_EQUAL(11, state.hourly[0].count); // still learned
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_welford_matches_the_sample_statistics);
+    RUN_TEST(test_welford_saturates_and_follows_a_lasting_change);
+    RUN_TEST(test_noise_band_anchors_drops_and_ignores_refills);
+    RUN_TEST(test_short_hours_are_not_evaluated);
+    RUN_TEST(test_steady_days_raise_nothing);
+    RUN_TEST(test_minimum_flow_wins_when_the_day_closes);
+    RUN_TEST(test_zero_sigma_disables_events);
+    return UNITY_END();
+}
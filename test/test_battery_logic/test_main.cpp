@@ -0,0 +1,112 @@
+#include <unity.h>
+#include "BatteryLogic.h"
+
+static BatteryState state;
+
+static void appendSamples(uint32_t firstTimestamp, uint32_t step, uint16_t n) {
+    for (uint16_t i = 0; i < n; ++i) {
+        BatterySample s = { firstTimestamp + i * step, 100.0f + i };
+        BatteryLogic::append(state, s);
+    }
+}
+
+void setUp(void) {
+    BatteryLogic::reset(state);
+}
+
+void tearDown(void) {}
+
+void test_reset_state_is_valid() {
+    TEST_ASSERT_TRUE(BatteryLogic::isValid(state));
+    state.magic = 0;
+    TEST_ASSERT_FALSE(BatteryLogic::isValid(state));
+    BatteryLogic::reset(state);
+    state.published = 1; // more than buffered
+    TEST_ASSERT_FALSE(BatteryLogic::isValid(state));
+}
+
+void test_buffer_keeps_the_newest_samples() {
+    appendSamples(0, 60, BATTERY_BUFFER_CAPACITY + 10);
+    TEST_ASSERT_EQUAL(BATTERY_BUFFER_CAPACITY, state.count);
+    TEST_ASSERT_EQUAL(10 * 60, BatteryLogic::at(state, 0).timestamp);
+    TEST_ASSERT_EQUAL((BATTERY_BUFFER_CAPACITY + 9) * 60, BatteryLogic::at(state, BATTERY_BUFFER_CAPACITY - 1).timestamp);
+    BatteryLogic::clear(state);
+    TEST_ASSERT_EQUAL(0, state.count);
+}
+
+void test_filtered_distance_is_the_median_of_valid_readings() {
+    float odd[] = {52.0f, -1.0f, 50.0f, 300.0f, 51.0f};
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 51.5f, BatteryLogic::filteredDistance(odd, 5));
+    float single[] = {-1.0f, 42.0f, -1.0f};
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 42.0f, BatteryLogic::filteredDistance(single, 3));
+    float none[] = {-1.0f, -1.0f};
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -1.0f, BatteryLogic::filteredDistance(none, 2));
+}
+
+void test_decide_uploads_every_n_wakes_and_on_alerts() {
+    appendSamples(0, 60, 1);
+    state.wakeCount = 3;
+    TEST_ASSERT_EQUAL(WakeAction::SLEEP, BatteryLogic::decide(state, 4, false));
+    TEST_ASSERT_EQUAL(WakeAction::UPLOAD, BatteryLogic::decide(state, 4, true));
+    state.wakeCount = 4;
+    TEST_ASSERT_EQUAL(WakeAction::UPLOAD, BatteryLogic::decide(state, 4, false));
+    state.wakeCount = 5;
+    TEST_ASSERT_EQUAL(WakeAction::UPLOAD, BatteryLogic::decide(state, 1, false));
+}
+
+void test_decide_uploads_before_unsent_samples_are_lost() {
+    state.wakeCount = 1;
+    appendSamples(0, 60, BATTERY_BUFFER_CAPACITY);
+    TEST_ASSERT_EQUAL(WakeAction::UPLOAD, BatteryLogic::decide(state, 1000, false));
+    // Samples held for the clock have been sent already: no reason to wake the radio
+    BatteryLogic::markPublished(state);
+    TEST_ASSERT_EQUAL(WakeAction::SLEEP, BatteryLogic::decide(state, 1000, false));
+    appendSamples(BATTERY_BUFFER_CAPACITY * 60, 60, BATTERY_BUFFER_CAPACITY - 1);
+    TEST_ASSERT_EQUAL(1, state.published);
+    TEST_ASSERT_EQUAL(WakeAction::SLEEP, BatteryLogic::decide(state, 1000, false));
+    appendSamples(0, 60, 1);
+    TEST_ASSERT_EQUAL(0, state.published);
+    TEST_ASSERT_EQUAL(WakeAction::UPLOAD, BatteryLogic::decide(state, 1000, false));
+}
+
+void test_rebase_moves_relative_samples_onto_the_clock() {
+    appendSamples(0, 600, 5); // relative: 0, 600 ... 2400
+    TEST_ASSERT_TRUE(BatteryLogic::hasRelative(state));
+    // The clock synced when the relative clock read 3000
+    BatteryLogic::rebase(state, 3000, 1750003000);
+    TEST_ASSERT_FALSE(BatteryLogic::hasRelative(state));
+    for (uint16_t i = 0; i < 5; ++i) {
+        TEST_ASSERT_EQUAL(1750000000 + i * 600, BatteryLogic::at(state, i).timestamp);
+    }
+}
+
+void test_rebase_leaves_epoch_samples_alone() {
+    appendSamples(100, 60, 3);
+    appendSamples(1750000000, 60, 3);
+    BatteryLogic::rebase(state, 400, 1749999900);
+    TEST_ASSERT_EQUAL(1749999600, BatteryLogic::at(state, 0).timestamp);
+    TEST_ASSERT_EQUAL(1749999720, BatteryLogic::at(state, 2).timestamp);
+    TEST_ASSERT_EQUAL(1750000000, BatteryLogic::at(state, 3).timestamp);
+    TEST_ASSERT_EQUAL(1750000120, BatteryLogic::at(state, 5).timestamp);
+}
+
+void test_rebase_across_the_ring_wrap() {
+    appendSamples(0, 60, BATTERY_BUFFER_CAPACITY + 3);
+    uint32_t newest = BatteryLogic::at(state, BATTERY_BUFFER_CAPACITY - 1).timestamp;
+    BatteryLogic::rebase(state, newest, 1760000000);
+    TEST_ASSERT_EQUAL(1760000000, BatteryLogic::at(state, BATTERY_BUFFER_CAPACITY - 1).timestamp);
+    TEST_ASSERT_EQUAL(1760000000 - (BATTERY_BUFFER_CAPACITY - 1) * 60, BatteryLogic::at(state, 0).timestamp);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_reset_state_is_valid);
+    RUN_TEST(test_buffer_keeps_the_newest_samples);
+    RUN_TEST(test_filtered_distance_is_the_median_of_valid_readings);
+    RUN_TEST(test_decide_uploads_every_n_wakes_and_on_alerts);
+    RUN_TEST(test_decide_uploads_before_unsent_samples_are_lost);
+    RUN_TEST(test_rebase_moves_relative_samples_onto_the_clock);
+    RUN_TEST(test_rebase_leaves_epoch_samples_alone);
+    RUN_TEST(test_rebase_across_the_ring_wrap);
+    return UNITY_END();
+}
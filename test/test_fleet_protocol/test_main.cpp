@@ -0,0 +1,143 @@
+#include <unity.h>
+#include <string.h>
+#include "FleetProtocol.h"
+
+static FleetReading reading(uint32_t device, uint8_t tank, uint32_t sequence) {
+    FleetReading r;
+    memset(&r, 0, sizeof(r));
+    r.deviceId = device;
+    r.tank = tank;
+    r.sequence = sequence;
+    r.status = 1;
+    r.volumeValid = true;
+    r.percent = 42.5f;
+    r.distanceCm = 87.3f;
+    r.liters = 1234.5f;
+    strcpy(r.name, "Cistern");
+    return r;
+}
+
+static FleetTable table;
+
+void setUp(void) {
+    FleetProtocol::reset(table);
+}
+
+void tearDown(void) {}
+
+void test_round_trip() {
+    uint8_t datagram[FLEET_DATAGRAM_SIZE];
+    FleetReading in = reading(0xA1B2C3D4, 2, 77);
+    TEST_ASSERT_EQUAL(FLEET_DATAGRAM_SIZE, FleetProtocol::encode(in, datagram));
+    TEST_ASSERT_EQUAL_MEMORY("WLF", datagram, 3);
+    FleetReading out;
+    TEST_ASSERT_TRUE(FleetProtocol::decode(datagram, sizeof(datagram), out));
+    TEST_ASSERT_EQUAL_HEX32(0xA1B2C3D4, out.deviceId);
+    TEST_ASSERT_EQUAL(77, out.sequence);
+    TEST_ASSERT_EQUAL(2, out.tank);
+    TEST_ASSERT_EQUAL(1, out.status);
+    TEST_ASSERT_TRUE(out.volumeValid);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 42.5f, out.percent);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 87.3f, out.distanceCm);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 1234.5f, out.liters);
+    TEST_ASSERT_EQUAL_STRING("Cistern", out.name);
+}
+
+void test_sensor_error_and_full_length_name() {
+    uint8_t datagram[FLEET_DATAGRAM_SIZE];
+    FleetReading in = reading(1, 0, 1);
+    in.distanceCm = -1.0f;
+    in.volumeValid = false;
+    strcpy(in.name, "0123456789abcdef");
+    FleetProtocol::encode(in, datagram);
+    FleetReading out;
+    TEST_ASSERT_TRUE(FleetProtocol::decode(datagram, sizeof(datagram), out));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -1.0f, out.distanceCm);
+    TEST_ASSERT_FALSE(out.volumeValid);
+    TEST_ASSERT_EQUAL_STRING("0123456789abcdef", out.name);
+}
+
+void test_decode_rejects_foreign_datagrams() {
+    uint8_t datagram[FLEET_DATAGRAM_SIZE];
+    FleetReading out;
+    FleetProtocol::encode(reading(1, 0, 1), datagram);
+    TEST_ASSERT_FALSE(FleetProtocol::decode(datagram, FLEET_DATAGRAM_SIZE - 1, out));
+    datagram[3] = FLEET_VERSION + 1;
+    TEST_ASSERT_FALSE(FleetProtocol::decode(datagram, sizeof(datagram), out));
+    FleetProtocol::encode(reading(1, 0, 1), datagram);
+    datagram[0] = 'X';
+    TEST_ASSERT_FALSE(FleetProtocol::decode(datagram, sizeof(datagram), out));
+}
+
+void test_decode_keeps_names_printable() {
+    uint8_t datagram[FLEET_DATAGRAM_SIZE];
+    FleetProtocol::encode(reading(1, 0, 1), datagram);
+    const uint8_t name[] = {'A', '"', '\n', 0xC3, 0xBC, '<', 0x7F, 'z', 0, 'h', 'i'};
+    memset(datagram + 24, 0, FLEET_NAME_LENGTH);
+    memcpy(datagram + 24, name, sizeof(name));
+    FleetReading out;
+    TEST_ASSERT_TRUE(FleetProtocol::decode(datagram, sizeof(datagram), out));
+    TEST_ASSERT_EQUAL_STRING("A\"?\?\?<?z", out.name); // stops at the first NUL
+}
+
+void test_update_inserts_refreshes_and_ignores_duplicates() {
+    TEST_ASSERT_TRUE(FleetProtocol::update(table, reading(1, 0, 10), 0x0A000001, 1000));
+    TEST_ASSERT_TRUE(FleetProtocol::update(table, reading(1, 1, 10), 0x0A000001, 1000));
+    TEST_ASSERT_TRUE(FleetProtocol::update(table, reading(2, 0, 5), 0x0A000002, 1000));
+    TEST_ASSERT_EQUAL(3, table.count);
+
+    TEST_ASSERT_FALSE(FleetProtocol::update(table, reading(1, 0, 10), 0x0A000001, 1500)); // multicast duplicate
+    TEST_ASSERT_EQUAL(1000, table.peers[0].lastSeen);
+
+    FleetReading next = reading(1, 0, 11);
+    next.percent = 50.0f;
+    TEST_ASSERT_TRUE(FleetProtocol::update(table, next, 0x0A000001, 2000));
+    TEST_ASSERT_EQUAL(3, table.count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, table.peers[0].reading.percent);
+    TEST_ASSERT_EQUAL(2000, table.peers[0].lastSeen);
+    TEST_ASSERT_EQUAL(2, table.peers[0].received);
+}
+
+void test_full_table_replaces_least_recent() {
+    for (uint8_t i = 0; i < FLEET_MAX_PEERS; ++i) {
+        FleetProtocol::update(table, reading(100 + i, 0, 1), 0, 1000 + i);
+    }
+    FleetProtocol::update(table, reading(100, 0, 2), 0, 5000); // the oldest one speaks again
+    TEST_ASSERT_TRUE(FleetProtocol::update(table, reading(999, 0, 1), 0, 6000));
+    TEST_ASSERT_EQUAL(FLEET_MAX_PEERS, table.count);
+    bool found101 = false;
+    bool found999 = false;
+    for (uint8_t i = 0; i < table.count; ++i) {
+        if (table.peers[i].reading.deviceId == 101) found101 = true;
+        if (table.peers[i].reading.deviceId == 999) {
+            found999 = true;
+            TEST_ASSERT_EQUAL(1, table.peers[i].received);
+        }
+    }
+    TEST_ASSERT_FALSE(found101);
+    TEST_ASSERT_TRUE(found999);
+}
+
+void test_expire_drops_silent_peers_in_order() {
+    FleetProtocol::update(table, reading(1, 0, 1), 0, 1000);
+    FleetProtocol::update(table, reading(2, 0, 1), 0, 200000);
+    FleetProtocol::update(table, reading(3, 0, 1), 0, 2000);
+    FleetProtocol::update(table, reading(4, 0, 1), 0, 250000);
+    TEST_ASSERT_EQUAL(2, FleetProtocol::expire(table, 302500, 300000));
+    TEST_ASSERT_EQUAL(2, table.count);
+    TEST_ASSERT_EQUAL(2, table.peers[0].reading.deviceId);
+    TEST_ASSERT_EQUAL(4, table.peers[1].reading.deviceId);
+    TEST_ASSERT_EQUAL(0, FleetProtocol::expire(table, 302500, 300000));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_sensor_error_and_full_length_name);
+    RUN_TEST(test_decode_rejects_foreign_datagrams);
+    RUN_TEST(test_decode_keeps_names_printable);
+    RUN_TEST(test_update_inserts_refreshes_and_ignores_duplicates);
+    RUN_TEST(test_full_table_replaces_least_recent);
+    RUN_TEST(test_expire_drops_silent_peers_in_order);
+    return UNITY_END();
+}
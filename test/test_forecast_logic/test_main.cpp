@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <string.h>
+#include "ForecastLogic.h"
+
+static const uint32_t HOUR0 = 1750032000 / 3600; // UTC midnight, so slot == hour of day
+
+static ForecastState state;
+
+// Synthetic daily profile in % of the tank per hour: quiet nights, a morning and an evening peak
+static float profile(uint8_t hourOfDay) {
+    if (hourOfDay < 6) return 0.2f;
+    if (hourOfDay < 9) return 3.0f;
+    if (hourOfDay >= 18 && hourOfDay < 21) return 2.5f;
+    return 1.0f;
+}
+
+static float profileMean() {
+    float sum = 0.0f;
+    for (uint8_t h = 0; h < FORECAST_SEASON; ++h) sum += profile(h);
+    return sum / FORECAST_SEASON;
+}
+
+static void feedDays(uint32_t firstHour, uint16_t days) {
+    for (uint32_t i = 0; i < (uint32_t)days * FORECAST_SEASON; ++i) {
+        uint32_t hour = firstHour + i;
+        ForecastLogic::update(state, hour, profile(hour % FORECAST_SEASON));
+    }
+}
+
+void setUp(void) {
+    ForecastLogic::reset(state);
+}
+
+void tearDown(void) {}
+
+void test_first_day_seeds_level_and_season() {
+    for (uint8_t h = 0; h < FORECAST_SEASON - 1; ++h) ForecastLogic::update(state, HOUR0 + h, profile(h));
+    TEST_ASSERT_FALSE(ForecastLogic::isReady(state));
+    ForecastLogic::update(state, HOUR0 + FORECAST_SEASON - 1, profile(FORECAST_SEASON - 1));
+    TEST_ASSERT_TRUE(ForecastLogic::isReady(state));
+
+    float mean = profileMean();
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, mean, state.level);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, state.trend);
+    for (uint8_t h = 0; h < FORECAST_SEASON; ++h) {
+        TEST_ASSERT_FLOAT_WITHIN(0.0001f, profile(h) - mean, state.season[h]);
+    }
+    // The next hours repeat the seeded day
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, profile(0), ForecastLogic::consumptionAhead(state, 1));
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, profile(7), ForecastLogic::consumptionAhead(state, 8));
+}
+
+void test_update_ignores_repeated_and_older_hours() {
+    feedDays(HOUR0, 2);
+    ForecastState before;
+    memcpy(&before, &state, sizeof(state));
+    ForecastLogic::update(state, state.lastHour, 50.0f);
+    ForecastLogic::update(state, state.lastHour - 5, 50.0f);
+    TEST_ASSERT_EQUAL_MEMORY(&before, &state, sizeof(state));
+
+    // A gap is skipped, not filled
+    ForecastLogic::update(state, before.lastHour + 3, profile((before.lastHour + 3) % FORECAST_SEASON));
+    TEST_ASSERT_EQUAL(before.lastHour + 3, state.lastHour);
+    TEST_ASSERT_EQUAL(before.hoursSeen + 1, state.hoursSeen);
+}
+
+void test_steady_profile_is_forecast_back() {
+    feedDays(HOUR0, 7);
+    for (uint16_t ahead = 1; ahead <= FORECAST_SEASON; ++ahead) {
+        uint8_t hourOfDay = (state.lastHour + ahead) % FORECAST_SEASON;
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, profile(hourOfDay), ForecastLogic::consumptionAhead(state, ahead));
+    }
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 0.0f, state.trend);
+}
+
+void test_hours_until_interpolates_within_the_hour() {
+    feedDays(HOUR0, 7);
+    // Walk the forecast by hand from 40 % down to a 25 % floor
+    float percent = 40.0f;
+    float floor = 25.0f;
+    float expected = -1.0f;
+    for (uint16_t h = 1; h <= FORECAST_HORIZON; ++h) {
+        float used = ForecastLogic::consumptionAhead(state, h);
+        if (percent - used <= floor) {
+            expected = (h - 1) + (percent - floor) / used;
+            break;
+        }
+        percent -= used;
+    }
+    TEST_ASSERT_GREATER_THAN(0.0f, expected);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, expected, ForecastLogic::hoursUntil(state, 40.0f, 25.0f, FORECAST_HORIZON));
+    // The last update was 23:00, so the next hours are the quiet night at 0.2 %/h
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0.5f, ForecastLogic::hoursUntil(state, 25.1f, 25.0f, FORECAST_HORIZON));
+}
+
+void test_hours_until_is_negative_beyond_the_horizon() {
+    feedDays(HOUR0, 7);
+    // About 1.4 %/h on average: 40 % lasts more than a day
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, -1.0f, ForecastLogic::hoursUntil(state, 40.0f, 0.0f, 12));
+    TEST_ASSERT_GREATER_THAN(12.0f, ForecastLogic::hoursUntil(state, 40.0f, 0.0f, FORECAST_HORIZON));
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.0f, ForecastLogic::hoursUntil(state, 20.0f, 25.0f, FORECAST_HORIZON));
+}
+
+void test_consumption_counts_drops_beyond_the_noise() {
+    const float readings[] = {50.0f, 49.8f, 49.4f, 49.6f, 60.0f, 59.0f, 58.9f};
+    // 0.6 to 49.4, the refill to 60 does not count, then 1.0 to 59.0
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.6f, ForecastLogic::consumption(readings, 7, 0.5f));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 0.0f, ForecastLogic::consumption(readings, 0, 0.5f));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_first_day_seeds_level_and_season);
+    RUN_TEST(test_update_ignores_repeated_and_older_hours);
+    RUN_TEST(test_steady_profile_is_forecast_back);
+    RUN_TEST(test_hours_until_interpolates_within_the_hour);
+    RUN_TEST(test_hours_until_is_negative_beyond_the_horizon);
+    RUN_TEST(test_consumption_counts_drops_beyond_the_noise);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "HistoryCodec.h"
+
+// Encodes `n` samples into as many blocks as they need
+static std::vector<HistoryBlock> encodeAll(const std::vector<HistorySample>& samples) {
+    std::vector<HistoryBlock> blocks(1);
+    HistoryEncoder encoder;
+    encoder.begin(&blocks.back());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (encoder.append(samples[i].timestamp, samples[i].distanceCm)) continue;
+        blocks.push_back(HistoryBlock());
+        encoder.begin(&blocks.back());
+        encoder.append(samples[i].timestamp, samples[i].distanceCm);
+    }
+    return blocks;
+}
+
+static std::vector<HistorySample> decodeAll(const std::vector<HistoryBlock>& blocks) {
+    std::vector<HistorySample> out;
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        HistoryDecoder decoder(blocks[b]);
+        HistorySample sample;
+        while (decoder.next(sample)) out.push_back(sample);
+    }
+    return out;
+}
+
+// A tank filling and draining, logged once a minute with some jitter and a few sensor errors
+static std::vector<HistorySample> tankSeries(size_t n) {
+    std::vector<HistorySample> samples(n);
+    uint32_t t = 1700000000;
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < n; ++i) {
+        seed = seed * 1103515245 + 12345;
+        t += 60 + (seed >> 28) % 3 - 1;
+        float level = 100.0f + 80.0f * (float)((i % 720) < 360 ? (i % 720) : 720 - (i % 720)) / 360.0f;
+        samples[i].timestamp = t;
+        samples[i].distanceCm = i % 997 == 0 ? -1.0f : HistoryCodec::dequantize(HistoryCodec::quantize(level));
+    }
+    return samples;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_round_trip_is_exact() {
+    std::vector<HistorySample> samples = tankSeries(20000);
+    std::vector<HistorySample> back = decodeAll(encodeAll(samples));
+    TEST_ASSERT_EQUAL(samples.size(), back.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        TEST_ASSERT_EQUAL_UINT32(samples[i].timestamp, back[i].timestamp);
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, samples[i].distanceCm, back[i].distanceCm);
+    }
+}
+
+void test_steady_log_is_about_a_byte_per_sample() {
+    std::vector<HistorySample> samples = tankSeries(20000);
+    std::vector<HistoryBlock> blocks = encodeAll(samples);
+    size_t bytes = blocks.size() * HISTORY_BLOCK_SIZE;
+    TEST_ASSERT_LESS_THAN(2 * samples.size(), bytes);
+}
+
+void test_large_steps_use_the_wide_buckets() {
+    HistoryBlock block;
+    HistoryEncoder encoder;
+    encoder.begin(&block);
+    const uint32_t times[] = {10, 20, 5000000, 5000001, 4000000000u, 3};
+    const float distances[] = {0.0f, 400.0f, -1.0f, 3000.5f, 12.3f, 12.3f};
+    for (int i = 0; i < 6; ++i) TEST_ASSERT_TRUE(encoder.append(times[i], distances[i]));
+    HistoryDecoder decoder(block);
+    HistorySample sample;
+    for (int i = 0; i < 6; ++i) {
+        TEST_ASSERT_TRUE(decoder.next(sample));
+        TEST_ASSERT_EQUAL_UINT32(times[i], sample.timestamp);
+        TEST_ASSERT_FLOAT_WITHIN(0.05f, distances[i], sample.distanceCm);
+    }
+    TEST_ASSERT_FALSE(decoder.next(sample));
+}
+
+void test_resume_continues_a_partial_block() {
+    std::vector<HistorySample> samples = tankSeries(50);
+    HistoryBlock block;
+    HistoryEncoder encoder;
+    encoder.begin(&block);
+    for (int i = 0; i < 30; ++i) encoder.append(samples[i].timestamp, samples[i].distanceCm);
+
+    HistoryBlock copy = block; // as read back from flash after a reboot
+    HistoryEncoder resumed;
+    TEST_ASSERT_TRUE(resumed.resume(&copy));
+    for (int i = 30; i < 50; ++i) resumed.append(samples[i].timestamp, samples[i].distanceCm);
+    std::vector<HistoryBlock> blocks(1, copy);
+    std::vector<HistorySample> back = decodeAll(blocks);
+    TEST_ASSERT_EQUAL(50, back.size());
+    for (int i = 0; i < 50; ++i) TEST_ASSERT_EQUAL_UINT32(samples[i].timestamp, back[i].timestamp);
+}
+
+void test_corrupt_blocks_are_rejected() {
+    HistoryBlock block;
+    HistoryEncoder encoder;
+    encoder.begin(&block);
+    encoder.append(100, 50.0f);
+    encoder.append(160, 51.0f);
+    TEST_ASSERT_TRUE(HistoryCodec::isValid(block));
+    block.bitLength = HISTORY_PAYLOAD_SIZE * 8 + 1;
+    TEST_ASSERT_FALSE(HistoryCodec::isValid(block));
+    TEST_ASSERT_FALSE(encoder.resume(&block));
+    TEST_ASSERT_EQUAL(0, block.count);
+}
+
+// Decode speed of the history read path, reported rather than asserted
+void test_decode_benchmark() {
+    std::vector<HistoryBlock> blocks = encodeAll(tankSeries(100000));
+    auto start = std::chrono::steady_clock::now();
+    size_t decoded = 0;
+    float sum = 0;
+    for (int round = 0; round < 10; ++round) {
+        for (size_t b = 0; b < blocks.size(); ++b) {
+            HistoryDecoder decoder(blocks[b]);
+            HistorySample sample;
+            while (decoder.next(sample)) {
+                sum += sample.distanceCm;
+                decoded++;
+            }
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    char message[80];
+    snprintf(message, sizeof(message), "%.1f ns per decoded sample (%u blocks)", ns / decoded, (unsigned)blocks.size());
+    TEST_MESSAGE(message);
+    TEST_ASSERT_EQUAL(1000000, decoded);
+    TEST_ASSERT_TRUE(sum != 0);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_is_exact);
+    RUN_TEST(test_steady_log_is_about_a_byte_per_sample);
+    RUN_TEST(test_large_steps_use_the_wide_buckets);
+    RUN_TEST(test_resume_continues_a_partial_block);
+    RUN_TEST(test_corrupt_blocks_are_rejected);
+    RUN_TEST(test_decode_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+#include <unity.h>
+#include <string.h>
+#include "ModbusCodec.h"
+
+static ModbusImage image;
+static uint8_t out[MODBUS_MAX_ADU];
+
+// Request ADU: transaction 0x1234, unit 1, `function`, start, quantity
+static size_t request(uint8_t* buf, uint8_t function, uint16_t start, uint16_t quantity) {
+    const uint8_t adu[] = {0x12, 0x34, 0x00, 0x00, 0x00, 0x06, 0x01, function,
+                           (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(quantity >> 8), (uint8_t)quantity};
+    memcpy(buf, adu, sizeof(adu));
+    return sizeof(adu);
+}
+
+static void assertException(size_t n, uint8_t function, uint8_t code) {
+    TEST_ASSERT_EQUAL(9, n);
+    TEST_ASSERT_EQUAL_HEX8(0x12, out[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x34, out[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, out[5]); // unit + 2 PDU bytes
+    TEST_ASSERT_EQUAL_HEX8(function | 0x80, out[7]);
+    TEST_ASSERT_EQUAL_HEX8(code, out[8]);
+}
+
+void setUp(void) {
+    memset(&image, 0, sizeof(image));
+    for (uint16_t i = 0; i < MODBUS_REGISTERS; ++i) image.registers[i] = (uint16_t)(0x0100 + i);
+}
+
+void tearDown(void) {}
+
+void test_frame_length_waits_for_whole_frame() {
+    uint8_t buf[32];
+    size_t n = request(buf, 0x03, 0, 2);
+    for (size_t i = 0; i < n; ++i) TEST_ASSERT_EQUAL(0, ModbusCodec::frameLength(buf, i));
+    TEST_ASSERT_EQUAL(12, ModbusCodec::frameLength(buf, n));
+    // A second pipelined request behind the first does not change the first's length
+    request(buf + n, 0x04, 0, 1);
+    TEST_ASSERT_EQUAL(12, ModbusCodec::frameLength(buf, 2 * n));
+}
+
+void test_frame_length_rejects_foreign_headers() {
+    uint8_t buf[16];
+    size_t n = request(buf, 0x03, 0, 1);
+    buf[2] = 0x01; // protocol id must be 0
+    TEST_ASSERT_EQUAL(-1, ModbusCodec::frameLength(buf, n));
+    request(buf, 0x03, 0, 1);
+    buf[4] = 0x01; // longer than any ADU
+    TEST_ASSERT_EQUAL(-1, ModbusCodec::frameLength(buf, n));
+    request(buf, 0x03, 0, 1);
+    buf[5] = 0x01; // unit id only, no function
+    TEST_ASSERT_EQUAL(-1, ModbusCodec::frameLength(buf, n));
+}
+
+void test_read_holding_registers() {
+    uint8_t req[16];
+    size_t n = ModbusCodec::respond(req, request(req, 0x03, 16 + MB_PERCENT_X10, 3), image, out);
+    TEST_ASSERT_EQUAL(9 + 6, n);
+    TEST_ASSERT_EQUAL_HEX8(0x00, out[4]);
+    TEST_ASSERT_EQUAL_HEX8(0x09, out[5]); // unit + function + count + 6
+    TEST_ASSERT_EQUAL_HEX8(0x01, out[6]);
+    TEST_ASSERT_EQUAL_HEX8(0x03, out[7]);
+    TEST_ASSERT_EQUAL(6, out[8]);
+    const uint8_t expected[] = {0x01, 0x10, 0x01, 0x11, 0x01, 0x12};
+    TEST_ASSERT_EQUAL_MEMORY(expected, out + 9, sizeof(expected));
+}
+
+void test_read_input_registers_reads_the_same_image() {
+    uint8_t req[16];
+    size_t n = ModbusCodec::respond(req, request(req, 0x04, MODBUS_REGISTERS - 1, 1), image, out);
+    TEST_ASSERT_EQUAL(11, n);
+    TEST_ASSERT_EQUAL_HEX8(0x04, out[7]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, out[9]);
+    TEST_ASSERT_EQUAL_HEX8(0x3F, out[10]);
+}
+
+void test_read_discrete_inputs_packs_lsb_first() {
+    ModbusCodec::setBit(image, 16 + MB_BIT_FULL, true);
+    ModbusCodec::setBit(image, 16 + MB_BIT_VOLUME_VALID, true);
+    ModbusCodec::setBit(image, 16 + 8, true);
+    uint8_t req[16];
+    size_t n = ModbusCodec::respond(req, request(req, 0x02, 16, 9), image, out);
+    TEST_ASSERT_EQUAL(11, n);
+    TEST_ASSERT_EQUAL_HEX8(0x02, out[7]);
+    TEST_ASSERT_EQUAL(2, out[8]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, out[9]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, out[10]);
+    ModbusCodec::setBit(image, 16 + MB_BIT_FULL, false);
+    TEST_ASSERT_FALSE(ModbusCodec::bit(image, 16 + MB_BIT_FULL));
+}
+
+void test_illegal_function() {
+    uint8_t req[16];
+    assertException(ModbusCodec::respond(req, request(req, 0x06, 0, 1), image, out), 0x06, ModbusCodec::ILLEGAL_FUNCTION);
+}
+
+void test_illegal_address_past_the_image() {
+    uint8_t req[16];
+    assertException(ModbusCodec::respond(req, request(req, 0x03, MODBUS_REGISTERS - 1, 2), image, out), 0x03,
+                    ModbusCodec::ILLEGAL_DATA_ADDRESS);
+    assertException(ModbusCodec::respond(req, request(req, 0x02, MODBUS_BITS, 1), image, out), 0x02,
+                    ModbusCodec::ILLEGAL_DATA_ADDRESS);
+}
+
+void test_illegal_quantity() {
+    uint8_t req[16];
+    assertException(ModbusCodec::respond(req, request(req, 0x04, 0, 0), image, out), 0x04,
+                    ModbusCodec::ILLEGAL_DATA_VALUE);
+    assertException(ModbusCodec::respond(req, request(req, 0x03, 0, 126), image, out), 0x03,
+                    ModbusCodec::ILLEGAL_DATA_VALUE);
+}
+
+// A request arriving in two TCP segments, reassembled the way the server buffers it
+void test_split_frame() {
+    uint8_t whole[16];
+    size_t n = request(whole, 0x03, 7, 1);
+    uint8_t rx[MODBUS_MAX_ADU];
+    memcpy(rx, whole, 5);
+    size_t rxLength = 5;
+    TEST_ASSERT_EQUAL(0, ModbusCodec::frameLength(rx, rxLength));
+    memcpy(rx + rxLength, whole + 5, 4);
+    rxLength += 4;
+    TEST_ASSERT_EQUAL(0, ModbusCodec::frameLength(rx, rxLength));
+    memcpy(rx + rxLength, whole + 9, n - 9);
+    rxLength += n - 9;
+    int frame = ModbusCodec::frameLength(rx, rxLength);
+    TEST_ASSERT_EQUAL(12, frame);
+    size_t len = ModbusCodec::respond(rx, (size_t)frame, image, out);
+    TEST_ASSERT_EQUAL(11, len);
+    TEST_ASSERT_EQUAL_HEX8(0x01, out[9]);
+    TEST_ASSERT_EQUAL_HEX8(0x07, out[10]);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_length_waits_for_whole_frame);
+    RUN_TEST(test_frame_length_rejects_foreign_headers);
+    RUN_TEST(test_read_holding_registers);
+    RUN_TEST(test_read_input_registers_reads_the_same_image);
+    RUN_TEST(test_read_discrete_inputs_packs_lsb_first);
+    RUN_TEST(test_illegal_function);
+    RUN_TEST(test_illegal_address_past_the_image);
+    RUN_TEST(test_illegal_quantity);
+    RUN_TEST(test_split_frame);
+    return UNITY_END();
+}
@@ -0,0 +1,152 @@
+#include <unity.h>
+#include "PumpLogic.h"
+
+// A tank drained by constant demand and filled by the pump, sampled once a second
+struct ModelTank {
+    float percent;
+    float drainPerSecond;
+    float pumpPerSecond; // 0 models a dry well
+    bool sensorOk;
+
+    ModelTank(float start, float drain, float fill)
+        : percent(start), drainPerSecond(drain), pumpPerSecond(fill), sensorOk(true) {}
+
+    void step(bool pumpOn) {
+        percent += (pumpOn ? pumpPerSecond : 0.0f) - drainPerSecond;
+        if (percent < 0) percent = 0;
+        if (percent > 100) percent = 100;
+    }
+};
+
+struct Run {
+    PumpState state;
+    PumpSettings settings;
+    uint32_t now = 1000;
+    uint32_t onSeconds = 0;
+    uint32_t switches = 0;
+    float lowest = 100;
+    float highest = 0;
+
+    Run() { PumpLogic::reset(state, now); }
+
+    void simulate(ModelTank& tank, uint32_t seconds) {
+        for (uint32_t i = 0; i < seconds; ++i) {
+            now += 1000;
+            bool was = state.on;
+            bool on = PumpLogic::update(state, settings, now, tank.percent, tank.sensorOk);
+            if (on != was) switches++;
+            if (on) onSeconds++;
+            tank.step(on);
+            if (tank.percent < lowest) lowest = tank.percent;
+            if (tank.percent > highest) highest = tank.percent;
+        }
+    }
+};
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_fill_cycles_between_start_and_stop() {
+    Run run;
+    ModelTank tank(50.0f, 0.01f, 0.05f);
+    run.simulate(tank, 6 * 3600);
+    TEST_ASSERT_EQUAL(PumpFault::NONE, run.state.fault);
+    TEST_ASSERT_TRUE(run.state.runs >= 2);
+    // Never runs far outside the band: one sample of overshoot at most
+    TEST_ASSERT_TRUE(run.lowest >= run.settings.startPercent - 0.1f);
+    TEST_ASSERT_TRUE(run.highest <= run.settings.stopPercent + 0.1f);
+    TEST_ASSERT_EQUAL(run.state.runs * 2 - (run.state.on ? 1 : 0), run.switches);
+}
+
+void test_minimum_off_time_after_reset() {
+    Run run;
+    ModelTank tank(10.0f, 0.0f, 0.05f);
+    run.simulate(tank, run.settings.minOffMs / 1000 - 2);
+    TEST_ASSERT_FALSE(run.state.on);
+    run.simulate(tank, 3);
+    TEST_ASSERT_TRUE(run.state.on);
+}
+
+void test_dry_run_latches_until_cleared() {
+    Run run;
+    ModelTank tank(15.0f, 0.0f, 0.0f);
+    run.simulate(tank, run.settings.minOffMs / 1000 + 1);
+    TEST_ASSERT_TRUE(run.state.on);
+    run.simulate(tank, run.settings.dryRunMs / 1000);
+    TEST_ASSERT_FALSE(run.state.on);
+    TEST_ASSERT_EQUAL(PumpFault::DRY_RUN, run.state.fault);
+
+    run.simulate(tank, 3600);
+    TEST_ASSERT_EQUAL(1, run.state.runs); // stays off while latched
+
+    tank.pumpPerSecond = 0.05f; // supply restored
+    PumpLogic::clearFault(run.state);
+    run.simulate(tank, 1);
+    TEST_ASSERT_TRUE(run.state.on);
+    TEST_ASSERT_EQUAL(PumpFault::NONE, run.state.fault);
+}
+
+void test_slow_rise_is_not_a_dry_run() {
+    Run run;
+    run.settings.maxRunMs = 0;
+    // 1.2 % per 5 minutes, just above the 1 % dry-run threshold
+    ModelTank tank(15.0f, 0.0f, 1.2f / 300.0f);
+    run.simulate(tank, 6 * 3600);
+    TEST_ASSERT_EQUAL(PumpFault::NONE, run.state.fault);
+    TEST_ASSERT_TRUE(run.highest >= run.settings.stopPercent);
+}
+
+void test_max_runtime_stops_a_long_run() {
+    Run run;
+    run.settings.maxRunMs = 600000;
+    // Rises fast enough for the dry-run check, but demand keeps it from ever reaching stop
+    ModelTank tank(15.0f, 0.04f, 0.05f);
+    run.simulate(tank, run.settings.minOffMs / 1000 + 1);
+    TEST_ASSERT_TRUE(run.state.on);
+    run.simulate(tank, 600);
+    TEST_ASSERT_FALSE(run.state.on);
+    TEST_ASSERT_EQUAL(PumpFault::MAX_RUN, run.state.fault);
+    TEST_ASSERT_TRUE(run.onSeconds <= 600);
+}
+
+void test_sensor_loss_stops_and_recovers() {
+    Run run;
+    ModelTank tank(15.0f, 0.0f, 0.05f);
+    run.simulate(tank, run.settings.minOffMs / 1000 + 1);
+    TEST_ASSERT_TRUE(run.state.on);
+    tank.sensorOk = false;
+    run.simulate(tank, run.settings.sampleTimeoutMs / 1000 + 1);
+    TEST_ASSERT_FALSE(run.state.on);
+    TEST_ASSERT_EQUAL(PumpFault::SENSOR, run.state.fault);
+
+    // Clears on its own once readings return; the minimum off time still applies
+    tank.sensorOk = true;
+    run.simulate(tank, 1);
+    TEST_ASSERT_EQUAL(PumpFault::NONE, run.state.fault);
+    TEST_ASSERT_FALSE(run.state.on);
+    run.simulate(tank, run.settings.minOffMs / 1000);
+    TEST_ASSERT_TRUE(run.state.on);
+}
+
+void test_watchdog_trip_latches() {
+    Run run;
+    ModelTank tank(15.0f, 0.0f, 0.05f);
+    run.simulate(tank, run.settings.minOffMs / 1000 + 1);
+    PumpLogic::trip(run.state, run.now, PumpFault::WATCHDOG);
+    TEST_ASSERT_FALSE(run.state.on);
+    run.simulate(tank, run.settings.minOffMs / 1000 + 1);
+    TEST_ASSERT_FALSE(run.state.on);
+    TEST_ASSERT_EQUAL_STRING("WATCHDOG", PumpLogic::faultName(run.state.fault));
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fill_cycles_between_start_and_stop);
+    RUN_TEST(test_minimum_off_time_after_reset);
+    RUN_TEST(test_dry_run_latches_until_cleared);
+    RUN_TEST(test_slow_rise_is_not_a_dry_run);
+    RUN_TEST(test_max_runtime_stops_a_long_run);
+    RUN_TEST(test_sensor_loss_stops_and_recovers);
+    RUN_TEST(test_watchdog_trip_latches);
+    return UNITY_END();
+}